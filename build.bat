@@ -1,8 +1,11 @@
-: - -DPRINT_STATE -> print every instruction and memory access
 : - -DDISPLAY_FRAME_TIME -> print frame time 
 : - -DINIT_EEPROM -> don't load an eeprom binary, initialize a new one
+: - -DLCD_DECODE_SCALAR -> decode the LCD without SSE2
+: - -DSCALER_SCALAR -> scale frames without SSE2
 : - -Zi debug symbols
 
 IF NOT EXIST bin mkdir bin
 
-cl /Fe"bin\pokeStroller.exe" /Fobin\ src\walker.c src\win_main.c src\queue.c /link Gdi32.lib User32.lib Ole32.lib Winmm.lib
+cl /Fe"bin\pokeStroller.exe" /Fobin\ src\walker.c src\win_main.c src\tripleBuffer.c src\scaler.c src\lcdDecode.c src\queue.c src\trace.c src\addressSpace.c /link Gdi32.lib User32.lib Ole32.lib Winmm.lib onecore.lib
+cl /Fe"bin\traceDecoder.exe" /Fobin\ src\traceDecoder.c
+cl /Fe"bin\captureExport.exe" /Fobin\ src\captureExport.c src\pngWriter.c src\scaler.c
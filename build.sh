@@ -0,0 +1,24 @@
+#!/bin/sh
+# Builds the POSIX tools with the system C compiler
+# Options (pass them as arguments, they go straight to the compiler):
+# - -DDISPLAY_FRAME_TIME -> print frame time
+# - -DINIT_EEPROM -> don't load an eeprom binary, initialize a new one
+# - -DLCD_DECODE_SCALAR -> decode the LCD without SSE2
+# - -DSCALER_SCALAR -> scale frames without SSE2
+# - -g debug symbols
+
+set -e
+CC=${CC:-cc}
+mkdir -p bin
+
+$CC -O2 "$@" -o bin/pokeStroller-headless src/walker.c src/headless_main.c src/capture.c src/sharedFrame.c src/lcdDecode.c src/queue.c src/trace.c src/addressSpace.c
+$CC -O2 "$@" -o bin/pokeStroller-term src/walker.c src/term_main.c src/lcdDecode.c src/queue.c src/trace.c src/addressSpace.c
+$CC -O2 "$@" -o bin/traceDecoder src/traceDecoder.c
+$CC -O2 "$@" -o bin/captureExport src/captureExport.c src/pngWriter.c src/scaler.c
+$CC -O2 "$@" -o bin/lcdMemViewer src/lcdMemViewer.c src/lcdDecode.c src/pngWriter.c -lpthread
+$CC -O2 "$@" -o bin/shmReader src/shmReader.c src/sharedFrame.c
+if [ -f /usr/include/X11/extensions/XShm.h ]; then
+	$CC -O2 "$@" -o bin/pokeStroller src/walker.c src/x11_main.c src/tripleBuffer.c src/scaler.c src/lcdDecode.c src/queue.c src/trace.c src/addressSpace.c -lX11 -lXext -lpthread
+else
+	echo "No X11/MIT-SHM headers (libx11-dev, libxext-dev), skipping bin/pokeStroller"
+fi
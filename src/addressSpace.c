@@ -0,0 +1,74 @@
+#include <stdio.h>
+#include <stddef.h>
+
+#include "addressSpace.h"
+
+#define MIRROR_COUNT 4
+
+#ifdef _WIN32
+#include <Windows.h>
+
+// Needs Windows 10 1803 or later for placeholders (VirtualAlloc2/MapViewOfFile3), link with onecore.lib
+uint8_t* mapAddressSpace(uint32_t size){
+	size_t reservationSize = ADDRESS_SPACE_SIZE + size;
+	HANDLE section = CreateFileMapping(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, size, NULL);
+	if (!section){
+		return NULL;
+	}
+	uint8_t* base = VirtualAlloc2(NULL, NULL, reservationSize, MEM_RESERVE | MEM_RESERVE_PLACEHOLDER, PAGE_NOACCESS, NULL, 0);
+	if (!base){
+		CloseHandle(section);
+		return NULL;
+	}
+	// Split the placeholder so each mirror gets its own, always cutting from the start or end of the remaining one
+	size_t mirrors[MIRROR_COUNT] = {0, size, ADDRESS_SPACE_SIZE, ADDRESS_SPACE_SIZE - size};
+	for(int i = 0; i < MIRROR_COUNT; i++){
+		VirtualFree(base + mirrors[i], size, MEM_RELEASE | MEM_PRESERVE_PLACEHOLDER);
+	}
+	for(int i = 0; i < MIRROR_COUNT; i++){
+		if (!MapViewOfFile3(section, NULL, base + mirrors[i], 0, size, MEM_REPLACE_PLACEHOLDER, PAGE_READWRITE, NULL, 0)){
+			printf("Can't map memory mirror at %06zx\n", mirrors[i]);
+			CloseHandle(section);
+			return NULL;
+		}
+	}
+	CloseHandle(section); // The views keep the section alive
+	return base;
+}
+
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+uint8_t* mapAddressSpace(uint32_t size){
+	size_t reservationSize = ADDRESS_SPACE_SIZE + size;
+	char name[64];
+	snprintf(name, sizeof(name), "/pokestroller-memory-%d", (int)getpid());
+	int section = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+	if (section < 0){
+		return NULL;
+	}
+	shm_unlink(name); // Only the mappings are needed from here on
+	if (ftruncate(section, size) != 0){
+		close(section);
+		return NULL;
+	}
+	uint8_t* base = mmap(NULL, reservationSize, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if (base == MAP_FAILED){
+		close(section);
+		return NULL;
+	}
+	size_t mirrors[MIRROR_COUNT] = {0, size, ADDRESS_SPACE_SIZE - size, ADDRESS_SPACE_SIZE};
+	for(int i = 0; i < MIRROR_COUNT; i++){
+		if (mmap(base + mirrors[i], size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, section, 0) == MAP_FAILED){
+			printf("Can't map memory mirror at %06zx\n", mirrors[i]);
+			munmap(base, reservationSize);
+			close(section);
+			return NULL;
+		}
+	}
+	close(section); // The mappings keep the memory alive
+	return base;
+}
+#endif
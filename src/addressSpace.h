@@ -0,0 +1,13 @@
+#pragma once
+#include <stdint.h>
+
+#define ADDRESS_SPACE_SIZE (16 * 1024 * 1024) // 24 bit address bus
+#define ADDRESS_MASK 0x00ffffff
+
+// Reserves the whole 24 bit address space plus one extra block for accesses that wrap around 0xFFFFFF.
+// The 'size' bytes of backing memory are mapped at 0x000000, 0xFF0000 and right after each of them, so
+// 0x00XXXX and 0xFFXXXX addresses hit the same byte without masking and multi-byte accesses (or
+// instruction fetches) that run past the end wrap around like on the CPU. The rest of the reservation
+// is left inaccessible, stray accesses fault instead of silently reading garbage.
+// 'size' must be 64KB so it matches the allocation granularity on Windows. Returns NULL on failure.
+uint8_t* mapAddressSpace(uint32_t size);
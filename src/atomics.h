@@ -0,0 +1,19 @@
+#pragma once
+#include <stdint.h>
+
+// Minimal atomics for handing data between the emulation thread and a frontend thread.
+// Loads have acquire semantics and stores have release semantics, atomicFence orders everything around it.
+#ifdef _MSC_VER
+#include <intrin.h>
+typedef volatile long AtomicU32;
+#define atomicLoad(pointer) ((uint32_t)_InterlockedOr((pointer), 0))
+#define atomicStore(pointer, value) _InterlockedExchange((pointer), (long)(value))
+#define atomicExchange(pointer, value) ((uint32_t)_InterlockedExchange((pointer), (long)(value)))
+#define atomicFence() _mm_mfence()
+#else
+typedef uint32_t AtomicU32;
+#define atomicLoad(pointer) __atomic_load_n((pointer), __ATOMIC_ACQUIRE)
+#define atomicStore(pointer, value) __atomic_store_n((pointer), (value), __ATOMIC_RELEASE)
+#define atomicExchange(pointer, value) __atomic_exchange_n((pointer), (value), __ATOMIC_ACQ_REL)
+#define atomicFence() __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#endif
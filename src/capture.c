@@ -0,0 +1,49 @@
+#include <string.h>
+
+#include "capture.h"
+
+static void writePendingRecord(struct Capture* capture){
+	if (!capture->pending){
+		return;
+	}
+	fwrite(&capture->record, sizeof(capture->record), 1, capture->file);
+	fwrite(capture->frame, CAPTURE_FRAME_SIZE, 1, capture->file);
+	capture->header.count += 1;
+	capture->pending = false;
+}
+
+bool openCapture(struct Capture* capture, const char* fileName, const uint32_t palette[4]){
+	memset(capture, 0, sizeof(*capture));
+	capture->file = fopen(fileName, "wb");
+	if (!capture->file){
+		printf("Can't open %s for writing\n", fileName);
+		return false;
+	}
+	capture->header = (struct CaptureFileHeader){.magic = CAPTURE_MAGIC, .version = CAPTURE_VERSION, .recordSize = sizeof(struct CaptureRecord), .width = LCD_WIDTH, .height = LCD_HEIGHT, .cyclesPerSecond = SYSTEM_CLOCK_CYCLES_PER_SECOND};
+	memcpy(capture->header.palette, palette, sizeof(capture->header.palette));
+	fwrite(&capture->header, sizeof(capture->header), 1, capture->file); // Rewritten with the final count on close
+	return true;
+}
+
+void captureFrame(struct Capture* capture, const uint8_t* packedFrame, uint64_t cycle){
+	if (capture->pending && memcmp(capture->frame, packedFrame, CAPTURE_FRAME_SIZE) == 0){
+		capture->record.repeats += 1;
+		return;
+	}
+	writePendingRecord(capture);
+	capture->record = (struct CaptureRecord){cycle, 0, 0};
+	memcpy(capture->frame, packedFrame, CAPTURE_FRAME_SIZE);
+	capture->pending = true;
+}
+
+void closeCapture(struct Capture* capture, uint64_t endCycle){
+	if (!capture->file){
+		return;
+	}
+	writePendingRecord(capture);
+	capture->header.endCycle = endCycle;
+	fseek(capture->file, 0, SEEK_SET);
+	fwrite(&capture->header, sizeof(capture->header), 1, capture->file);
+	fclose(capture->file);
+	capture->file = NULL;
+}
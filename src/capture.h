@@ -0,0 +1,46 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "walker.h"
+
+// Video capture of the LCD. Frames are stored as packed 2bpp palette indices (LCD_FORMAT_PACKED2BPP, 1.5KB) and a
+// frame identical to the previous one only bumps that record's repeat count, so an idle screen costs nothing on disk.
+// Frame i is on screen from its cycle until the next record's cycle (or the header's endCycle for the last one).
+// captureExport turns capture files into GIF, APNG or y4m.
+#define CAPTURE_MAGIC 0x50414357 // "WCAP"
+#define CAPTURE_VERSION 1
+#define CAPTURE_FRAME_SIZE (LCD_WIDTH / 4 * LCD_HEIGHT)
+
+// Capture file layout: CaptureFileHeader followed by CaptureRecords up to the end of the file, each one followed by
+// CAPTURE_FRAME_SIZE bytes. 'count' and 'endCycle' are only filled in by closeCapture, readers can't rely on them
+struct CaptureFileHeader{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t recordSize;
+	uint32_t count;
+	uint16_t width;
+	uint16_t height;
+	uint32_t cyclesPerSecond;
+	uint32_t palette[4]; // Colors of the indices, 0x00RRGGBB
+	uint64_t endCycle;
+};
+
+struct CaptureRecord{
+	uint64_t cycle; // When the frame was first presented
+	uint32_t repeats; // Identical presentations that followed it
+	uint32_t reserved;
+};
+
+struct Capture{
+	FILE* file;
+	struct CaptureFileHeader header;
+	bool pending; // 'record' and 'frame' haven't been written yet, more repeats could come
+	struct CaptureRecord record;
+	uint8_t frame[CAPTURE_FRAME_SIZE];
+};
+
+bool openCapture(struct Capture* capture, const char* fileName, const uint32_t palette[4]);
+void captureFrame(struct Capture* capture, const uint8_t* packedFrame, uint64_t cycle); // Presented frame, in LCD_FORMAT_PACKED2BPP with a tight stride
+void closeCapture(struct Capture* capture, uint64_t endCycle);
@@ -0,0 +1,399 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "capture.h"
+#include "pngWriter.h"
+#include "scaler.h"
+
+// Converts a capture file recorded by the emulator (see capture.h) into an animated GIF, an APNG or a y4m stream.
+// Usage: captureExport capture.bin output.gif|output.png|output.y4m|- [-scale N] [-filter nearest|scale2x|scale3x|lcd] [-fps N]
+// '-' writes y4m to stdout, for piping into ffmpeg: captureExport capture.bin - | ffmpeg -i - walker.mp4
+// GIF frames only cover the area that changed since the previous frame. APNG frames are uncompressed, see pngWriter.h
+
+struct Video_t{
+	struct CaptureFileHeader header;
+	struct CaptureRecord* records;
+	uint8_t* frames; // header.count * CAPTURE_FRAME_SIZE
+	struct Scaler scaler;
+	int width; // Scaled
+	int height;
+	uint32_t* source; // Unpacked frame
+	uint32_t* scaled;
+};
+
+// A frame scaled, one byte per pixel: palette indices, or the gray level of the colors (the palette is gray) if 'colors' is set.
+// The filters compare indices just like colors, except the LCD grid that needs actual colors to blend
+static void expandFrame(struct Video_t* video, uint32_t frame, bool colors, uint8_t* pixels){
+	const uint8_t* packed = video->frames + (size_t)frame * CAPTURE_FRAME_SIZE;
+	for(int i = 0; i < LCD_WIDTH * LCD_HEIGHT; i++){
+		int index = (packed[i / 4] >> (6 - 2 * (i % 4))) & 3;
+		video->source[i] = colors ? video->header.palette[index] : (uint32_t)index;
+	}
+	scaleImage(&video->scaler, video->source, LCD_WIDTH, video->scaled, video->width);
+	for(int i = 0; i < video->width * video->height; i++){
+		pixels[i] = video->scaled[i] & 0xFF;
+	}
+}
+
+static uint64_t frameEnd(const struct Video_t* video, uint32_t frame){
+	return frame + 1 < video->header.count ? video->records[frame + 1].cycle : video->header.endCycle;
+}
+
+// Centiseconds since the first frame, rounded so the delays add up without drifting
+static uint32_t centiseconds(const struct Video_t* video, uint64_t cycle){
+	uint64_t elapsed = cycle - video->records[0].cycle;
+	return (uint32_t)((elapsed * 100 + video->header.cyclesPerSecond / 2) / video->header.cyclesPerSecond);
+}
+
+static void writeLittle16(FILE* output, uint16_t value){
+	fputc(value & 0xFF, output);
+	fputc(value >> 8, output);
+}
+
+// GIF image data: LZW with 2 bit minimum code size, variable width codes up to 12 bits, packed LSB first into sub-blocks
+struct LzwWriter_t{
+	FILE* output;
+	uint8_t block[255];
+	int blockLength;
+	uint32_t bits;
+	int bitCount;
+};
+
+static void lzwWriteCode(struct LzwWriter_t* writer, int code, int codeSize){
+	writer->bits |= (uint32_t)code << writer->bitCount;
+	writer->bitCount += codeSize;
+	while (writer->bitCount >= 8){
+		writer->block[writer->blockLength++] = writer->bits & 0xFF;
+		writer->bits >>= 8;
+		writer->bitCount -= 8;
+		if (writer->blockLength == 255){
+			fputc(255, writer->output);
+			fwrite(writer->block, 1, 255, writer->output);
+			writer->blockLength = 0;
+		}
+	}
+}
+
+static void writeGifImageData(FILE* output, const uint8_t* pixels, int count){
+	enum { MIN_CODE_SIZE = 2, CLEAR = 4, END = 5, MAX_CODES = 4096 };
+	static int16_t children[MAX_CODES][4]; // children[code][pixel] -> code for that string + pixel, -1 if not in the table yet
+	struct LzwWriter_t writer = {.output = output};
+	fputc(MIN_CODE_SIZE, output);
+	memset(children, -1, sizeof(children));
+	int nextCode = END + 1;
+	int codeSize = MIN_CODE_SIZE + 1;
+	lzwWriteCode(&writer, CLEAR, codeSize);
+	int current = pixels[0];
+	for(int i = 1; i < count; i++){
+		int pixel = pixels[i];
+		if (children[current][pixel] >= 0){
+			current = children[current][pixel];
+			continue;
+		}
+		lzwWriteCode(&writer, current, codeSize);
+		if (nextCode < MAX_CODES){
+			children[current][pixel] = nextCode++;
+			if (nextCode > (1 << codeSize) && codeSize < 12){
+				codeSize += 1;
+			}
+		}
+		else{ // Table full, start over
+			lzwWriteCode(&writer, CLEAR, codeSize);
+			memset(children, -1, sizeof(children));
+			nextCode = END + 1;
+			codeSize = MIN_CODE_SIZE + 1;
+		}
+		current = pixel;
+	}
+	lzwWriteCode(&writer, current, codeSize);
+	lzwWriteCode(&writer, END, codeSize);
+	if (writer.bitCount){
+		lzwWriteCode(&writer, 0, 8 - writer.bitCount);
+	}
+	if (writer.blockLength){
+		fputc(writer.blockLength, output);
+		fwrite(writer.block, 1, writer.blockLength, output);
+	}
+	fputc(0, output); // Block terminator
+}
+
+static bool exportGif(struct Video_t* video, FILE* output){
+	fwrite("GIF89a", 1, 6, output);
+	writeLittle16(output, video->width);
+	writeLittle16(output, video->height);
+	fputc(0x80 | 0x01, output); // Global color table of 2^(1+1) colors
+	fputc(0, output);
+	fputc(0, output);
+	for(int i = 0; i < 4; i++){
+		fputc((video->header.palette[i] >> 16) & 0xFF, output);
+		fputc((video->header.palette[i] >> 8) & 0xFF, output);
+		fputc(video->header.palette[i] & 0xFF, output);
+	}
+	fwrite("\x21\xFF\x0BNETSCAPE2.0\x03\x01\x00\x00\x00", 1, 19, output); // Loop forever
+
+	size_t pixelCount = (size_t)video->width * video->height;
+	uint8_t* previous = malloc(pixelCount);
+	uint8_t* current = malloc(pixelCount);
+	uint8_t* area = malloc(pixelCount);
+	for(uint32_t frame = 0; frame < video->header.count; frame++){
+		expandFrame(video, frame, false, current);
+		// Bounding box of what changed, the whole frame the first time
+		int left = 0, top = 0, right = video->width - 1, bottom = video->height - 1;
+		if (frame > 0){
+			left = video->width, top = video->height, right = -1, bottom = -1;
+			for(int y = 0; y < video->height; y++){
+				for(int x = 0; x < video->width; x++){
+					if (current[y * video->width + x] != previous[y * video->width + x]){
+						left = x < left ? x : left;
+						right = x > right ? x : right;
+						top = y < top ? y : top;
+						bottom = y > bottom ? y : bottom;
+					}
+				}
+			}
+			if (right < 0){ // Same picture, different palette index somewhere outside the capture. Keep the timing
+				left = right = top = bottom = 0;
+			}
+		}
+		uint32_t delay = centiseconds(video, frameEnd(video, frame)) - centiseconds(video, video->records[frame].cycle);
+		fwrite("\x21\xF9\x04", 1, 3, output); // Graphic control extension
+		fputc(0x04, output); // Leave the frame in place for the next one to draw over
+		writeLittle16(output, delay > 0xFFFF ? 0xFFFF : delay);
+		fputc(0, output);
+		fputc(0, output);
+
+		int areaWidth = right - left + 1;
+		int areaHeight = bottom - top + 1;
+		for(int y = 0; y < areaHeight; y++){
+			memcpy(area + y * areaWidth, current + (top + y) * video->width + left, areaWidth);
+		}
+		fputc(0x2C, output); // Image descriptor
+		writeLittle16(output, left);
+		writeLittle16(output, top);
+		writeLittle16(output, areaWidth);
+		writeLittle16(output, areaHeight);
+		fputc(0, output);
+		writeGifImageData(output, area, areaWidth * areaHeight);
+
+		uint8_t* swap = previous;
+		previous = current;
+		current = swap;
+	}
+	fputc(0x3B, output);
+	free(previous);
+	free(current);
+	free(area);
+	return true;
+}
+
+static bool exportApng(struct Video_t* video, FILE* output){
+	writePngHeader(output, video->width, video->height, video->header.palette);
+	uint8_t chunk[26];
+	putBig32(chunk, video->header.count);
+	putBig32(chunk + 4, 0); // Loop forever
+	writePngChunk(output, "acTL", chunk, 8);
+
+	int rowBytes = 1 + (video->width + 3) / 4; // Filter byte + 2bpp pixels
+	uint8_t* indices = malloc((size_t)video->width * video->height);
+	uint8_t* raw = malloc((size_t)rowBytes * video->height);
+	uint32_t sequence = 0;
+	for(uint32_t frame = 0; frame < video->header.count; frame++){
+		expandFrame(video, frame, false, indices);
+		memset(raw, 0, (size_t)rowBytes * video->height);
+		for(int y = 0; y < video->height; y++){
+			uint8_t* row = raw + y * rowBytes + 1;
+			for(int x = 0; x < video->width; x++){
+				row[x / 4] |= indices[y * video->width + x] << (6 - 2 * (x % 4));
+			}
+		}
+		uint32_t delay = centiseconds(video, frameEnd(video, frame)) - centiseconds(video, video->records[frame].cycle);
+		putBig32(chunk, sequence++);
+		putBig32(chunk + 4, video->width);
+		putBig32(chunk + 8, video->height);
+		putBig32(chunk + 12, 0);
+		putBig32(chunk + 16, 0);
+		chunk[20] = (delay > 0xFFFF ? 0xFFFF : delay) >> 8;
+		chunk[21] = (delay > 0xFFFF ? 0xFFFF : delay) & 0xFF;
+		chunk[22] = 0;
+		chunk[23] = 100; // Delay in 1/100 s
+		chunk[24] = 0; // No dispose
+		chunk[25] = 0; // Replace
+		writePngChunk(output, "fcTL", chunk, 26);
+
+		uint32_t prefix = frame == 0 ? 0 : 4;
+		uint32_t length;
+		uint8_t* data = storeZlib(raw, (uint32_t)rowBytes * video->height, prefix, &length);
+		if (frame == 0){
+			writePngChunk(output, "IDAT", data, length);
+		}
+		else{
+			putBig32(data, sequence++);
+			writePngChunk(output, "fdAT", data, length);
+		}
+		free(data);
+	}
+	writePngChunk(output, "IEND", NULL, 0);
+	free(indices);
+	free(raw);
+	return true;
+}
+
+// Grayscale y4m at a fixed frame rate, each output frame shows whatever was on screen at its time
+static bool exportY4m(struct Video_t* video, FILE* output, int fps){
+	fprintf(output, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 Cmono\n", video->width, video->height, fps);
+	size_t pixelCount = (size_t)video->width * video->height;
+	uint8_t* luma = malloc(pixelCount);
+	uint64_t start = video->records[0].cycle;
+	uint64_t duration = video->header.endCycle > start ? video->header.endCycle - start : 0;
+	uint64_t outputFrames = duration * fps / video->header.cyclesPerSecond + 1;
+	uint32_t frame = 0;
+	uint32_t expanded = UINT32_MAX;
+	for(uint64_t i = 0; i < outputFrames; i++){
+		uint64_t cycle = start + i * video->header.cyclesPerSecond / fps;
+		while (frame + 1 < video->header.count && video->records[frame + 1].cycle <= cycle){
+			frame += 1;
+		}
+		if (frame != expanded){
+			expandFrame(video, frame, true, luma);
+			expanded = frame;
+		}
+		fputs("FRAME\n", output);
+		fwrite(luma, 1, pixelCount, output);
+	}
+	free(luma);
+	return true;
+}
+
+static bool loadCapture(const char* fileName, struct Video_t* video){
+	FILE* input = fopen(fileName, "rb");
+	if (!input){
+		printf("Can't open %s\n", fileName);
+		return false;
+	}
+	if (fread(&video->header, sizeof(video->header), 1, input) != 1 || video->header.magic != CAPTURE_MAGIC){
+		printf("%s is not a capture file\n", fileName);
+		fclose(input);
+		return false;
+	}
+	if (video->header.version != CAPTURE_VERSION || video->header.recordSize != sizeof(struct CaptureRecord) ||
+		video->header.width != LCD_WIDTH || video->header.height != LCD_HEIGHT){
+		printf("Capture version %u (record size %u) doesn't match this exporter\n", video->header.version, video->header.recordSize);
+		fclose(input);
+		return false;
+	}
+	// count and endCycle are only filled in by closeCapture, a capture that got cut short still has its records
+	uint32_t capacity = video->header.count && video->header.count <= 65536 ? video->header.count : 1024; // Just a hint
+	video->records = malloc(capacity * sizeof(struct CaptureRecord));
+	video->frames = malloc((size_t)capacity * CAPTURE_FRAME_SIZE);
+	uint32_t count = 0;
+	for(;;){
+		if (count == capacity){
+			capacity *= 2;
+			video->records = realloc(video->records, capacity * sizeof(struct CaptureRecord));
+			video->frames = realloc(video->frames, (size_t)capacity * CAPTURE_FRAME_SIZE);
+		}
+		size_t recordRead = fread(&video->records[count], 1, sizeof(struct CaptureRecord), input);
+		if (recordRead == 0){
+			break;
+		}
+		if (recordRead != sizeof(struct CaptureRecord) || fread(video->frames + (size_t)count * CAPTURE_FRAME_SIZE, CAPTURE_FRAME_SIZE, 1, input) != 1){
+			printf("%s is truncated after %u frames\n", fileName, count);
+			break;
+		}
+		count += 1;
+	}
+	fclose(input);
+	if (count == 0){
+		printf("%s has no frames\n", fileName);
+		return false;
+	}
+	if (count != video->header.count || video->header.endCycle < video->records[count - 1].cycle){
+		// Not closed: the end isn't known, the last frame gets the previous one's duration
+		printf("%s wasn't closed properly, recovered %u frames\n", fileName, count);
+		uint64_t last = video->records[count - 1].cycle;
+		video->header.endCycle = count > 1 ? last + (last - video->records[count - 2].cycle) : last;
+	}
+	video->header.count = count;
+	return true;
+}
+
+int main(int argc, char **argv){
+	if (argc < 3){
+		printf("Usage: %s capture.bin output.gif|output.png|output.y4m|- [-scale N] [-filter nearest|scale2x|scale3x|lcd] [-fps N]\n", argv[0]);
+		return 1;
+	}
+	struct Video_t video = {0};
+	int scale = 1;
+	enum ScaleFilter filter = SCALE_NEAREST;
+	int fps = 30;
+	for(int i = 3; i + 1 < argc; i += 2){
+		if (strcmp(argv[i], "-scale") == 0){
+			scale = atoi(argv[i + 1]);
+		}
+		else if (strcmp(argv[i], "-filter") == 0 && !parseScaleFilter(argv[i + 1], &filter)){
+			printf("Unknown filter %s\n", argv[i + 1]);
+			return 1;
+		}
+		else if (strcmp(argv[i], "-fps") == 0){
+			fps = atoi(argv[i + 1]);
+		}
+	}
+	if (scale < 1 || fps < 1){
+		printf("-scale and -fps have to be positive\n");
+		return 1;
+	}
+	if (scale == 1 && filter != SCALE_NEAREST){
+		scale = filter == SCALE_3X ? 3 : 2; // The filter alone picks the scale
+	}
+	const char* outputName = argv[2];
+	size_t nameLength = strlen(outputName);
+	const char* extension = nameLength >= 4 ? outputName + nameLength - 4 : "";
+	bool toStdout = strcmp(outputName, "-") == 0;
+	if (filter == SCALE_LCD_GRID && (strcmp(extension, ".gif") == 0 || strcmp(extension, ".png") == 0)){
+		printf("The lcd filter adds colors, it only works with y4m\n");
+		return 1;
+	}
+	if (!initScaler(&video.scaler, filter, scale, LCD_WIDTH, LCD_HEIGHT, 0)){
+		printf("-scale %d doesn't work with that filter, it has to be a multiple of %d\n", scale, filter == SCALE_3X ? 3 : 2);
+		return 1;
+	}
+	initPngWriter();
+	if (!loadCapture(argv[1], &video)){
+		return 1;
+	}
+	video.scaler.gapColor = video.header.palette[0];
+	video.width = video.header.width * scale;
+	video.height = video.header.height * scale;
+	video.source = malloc(LCD_WIDTH * LCD_HEIGHT * sizeof(uint32_t));
+	video.scaled = malloc((size_t)video.width * video.height * sizeof(uint32_t));
+
+	FILE* output = toStdout ? stdout : fopen(outputName, "wb");
+	if (!output){
+		printf("Can't open %s for writing\n", outputName);
+		return 1;
+	}
+	bool written;
+	if (strcmp(extension, ".gif") == 0){
+		written = exportGif(&video, output);
+	}
+	else if (strcmp(extension, ".png") == 0){
+		written = exportApng(&video, output);
+	}
+	else if (toStdout || strcmp(extension, ".y4m") == 0){
+		written = exportY4m(&video, output, fps);
+	}
+	else{
+		printf("Unknown output format %s, use .gif, .png or .y4m\n", outputName);
+		written = false;
+	}
+	if (!toStdout){
+		fclose(output);
+	}
+	if (written && !toStdout){
+		printf("%u frames (%.1f s) written to %s\n", video.header.count, (double)(video.header.endCycle - video.records[0].cycle) / video.header.cyclesPerSecond, outputName);
+	}
+	return written ? 0 : 1;
+}
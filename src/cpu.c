@@ -0,0 +1,2235 @@
+// CPU core, walker.c includes this file twice to get two versions of the same interpreter:
+// - INSTRUMENTED 0: fast core, no tracing calls, no asserts and no debug hooks.
+// - INSTRUMENTED 1: text/binary tracing, memory access recording (memo.c), asserts and debug hooks compiled in.
+// CORE_FUNCTION is the name of the generated function.
+
+#if INSTRUMENTED
+#define setMemory8(address, value) tracedSetMemory8(address, value)
+#define setMemory16(address, value) tracedSetMemory16(address, value)
+#define setMemory32(address, value) tracedSetMemory32(address, value)
+#define getMemory8(address) tracedGetMemory8(address)
+#define getMemory16(address) tracedGetMemory16(address)
+#define getMemory32(address) tracedGetMemory32(address)
+#define CORE_ASSERT(condition) assert(condition)
+#else
+#define printInstruction(...)
+#define printRegistersState()
+#define printMemory(address, byteCount)
+#define CORE_ASSERT(condition)
+#endif
+
+int CORE_FUNCTION(uint64_t* cycleCount){
+	uint32_t cyclesEllapsed = 2; // States taken by the instruction (see opcodeStates), sleeping counts as a one-word instruction
+	if (!sleep){
+		// Skips, patches, breakpoints and HLE routines registered in hooks.cfg
+		if (pc < ROM_SIZE && (hookBitmap[pc >> 5] & (1u << (pc & 31)))){
+			uint32_t hookCycles = 0;
+			if (runHooks(INSTRUMENTED, &hookCycles)){
+				return advanceClock(cycleCount, hookCycles);
+			}
+		}
+		uint16_t* currentInstruction = (uint16_t*)(memory + pc);
+		// IMPROVEMENT: maybe just use pointers to the ROM, left this way cause it seems cleaner
+		uint16_t ab = (*currentInstruction << 8) | (*currentInstruction >> 8); // 0xbHbL aHaL -> aHaL bHbL
+
+		uint8_t a = ab >> 8;
+		uint8_t aH = (a >> 4) & 0xF; 
+		uint8_t aL = a & 0xF;
+
+		uint8_t b = ab & 0xFF;
+		uint8_t bH = (b >> 4) & 0xF;
+		uint8_t bL = b & 0xF;
+
+		uint16_t cd = (*(currentInstruction + 1) << 8) | (*(currentInstruction + 1) >> 8);
+		uint8_t c = cd >> 8;
+		uint8_t cH = (c >> 4) & 0xF; 
+		uint8_t cL = c & 0xF;
+
+		uint8_t d = cd & 0xFF;
+		uint8_t dH = (d >> 4) & 0xF;
+		uint8_t dL = d & 0xF;
+
+		uint16_t ef = (*(currentInstruction + 2) << 8) | (*(currentInstruction + 2) >> 8);
+		uint8_t e = ef >> 8;
+		uint8_t eH = (e >> 4) & 0xF; 
+		uint8_t eL = e & 0xF;
+
+		uint8_t f = ef & 0xFF;
+		uint8_t fH = (f >> 4) & 0xF;
+		uint8_t fL = f & 0xF;
+
+		uint32_t cdef = cd << 16 | ef;                     
+		cyclesEllapsed = instructionStates(a, b, c);
+
+		switch(aH){
+			case 0x0:{
+				switch(aL){
+					case 0x0:{
+					printInstruction("%04x - NOP\n", pc);
+					}break;
+					case 0x1:{
+						switch(bH){ // NOTE. we're ignoring bL here, might not be necesary
+							case 0x0:{ // Lots of MOV.l type instructions and push.l + pop.l
+								switch(c){
+									case 0x6B:{
+										switch(dH){
+											case 0x0:{ // MOV.l @aa:16, Rd
+												uint32_t address = (ef & 0x0000FFFF) | 0x00FF0000; 
+												uint32_t value = getMemory32(address);
+
+												struct RegRef32 Rd = getRegRef32(dL);
+
+												setFlagsMOV(value, 32);
+												*Rd.ptr = value;
+
+												printInstruction("%04x - MOV.l @%x:16, ER%d\n", pc, address, Rd.idx); 
+												printRegistersState();
+
+											}break;
+
+											case 0x8:{ // MOV.l Rs, @aa:16 
+												uint32_t address = (cdef & 0x0000FFFF) | 0x00FF0000; 
+
+												struct RegRef32 Rs = getRegRef32(dL);
+
+												uint32_t value = *Rs.ptr;
+												setFlagsMOV(value, 32);
+												setMemory32(address, value);
+
+												printInstruction("%04x - MOV.l ER%d,@%x:16 \n", pc, Rs.idx, address); 
+												printMemory(address, 4);
+												printRegistersState();
+
+											}break;
+											default:{
+												return 1;
+											} break;
+										}
+										pc += 4;
+
+
+									}break;
+									case 0x6D:{ // MOV.l @ERs+, ERd --- MOV.l ERs, @-ERd
+										char incOrDec = (dH & 0b1000) ? '-' : '+';
+
+										if (incOrDec == '+'){
+											struct RegRef32 Rs = getRegRef32(dH);
+											struct RegRef32 Rd = getRegRef32(dL);
+
+											uint32_t value = getMemory32(*Rs.ptr);
+
+											*Rs.ptr += 4;
+
+											setFlagsMOV(value, 32);
+											*Rd.ptr = value;
+
+											printInstruction("%04x - MOV.l @ER%d+, ER%d\n", pc, Rs.idx, Rd.idx); 
+
+										} else{
+											struct RegRef32 Rs = getRegRef32(dL);
+											struct RegRef32 Rd = getRegRef32(dH);
+
+											*Rd.ptr -= 4;
+
+											uint32_t value = *Rs.ptr;
+											setMemory32(*Rd.ptr, value);
+											setFlagsMOV(value, 32);
+
+											printInstruction("%04x - MOV.l ER%d, @-ER%d, \n", pc, Rs.idx, Rd.idx); 
+											printMemory(*Rd.ptr, 4);
+
+										}
+										printRegistersState();
+										pc +=2;
+
+
+									} break;
+									case 0x6F:{ 
+										uint16_t disp = ef;
+										bool msbDisp = disp & 0x8000;
+										uint32_t signExtendedDisp = msbDisp ? (0xFFFF0000 | disp) : disp;
+
+										if (!(dH & 0b1000)){ // From memory @(d:16, ERs), ERd
+											struct RegRef32 Rs = getRegRef32(dH);
+											struct RegRef32 Rd = getRegRef32(dL);
+
+											uint32_t value = getMemory32(*Rs.ptr + signExtendedDisp); 
+											*Rd.ptr = value;
+											setFlagsMOV(value, 32);
+
+											printInstruction("%04x - MOV.l @(%d:16, ER%d), ER%d\n", pc, disp, Rs.idx, Rd.idx); 
+
+										} else{ // To memory  ERs, @(d:16,ERd) 
+											struct RegRef32 Rs = getRegRef32(dL);
+											struct RegRef32 Rd = getRegRef32(dH);
+
+											uint32_t value = *Rs.ptr;
+											setFlagsMOV(value, 32);
+
+
+											setMemory32(*Rd.ptr + signExtendedDisp, value);
+											printInstruction("%04x - MOV.l ER%d,@(%d:16, ER%d)\n", pc, Rs.idx, disp, Rd.idx); 
+											printMemory(*Rd.ptr + signExtendedDisp, 4);
+										}
+										printRegistersState();
+										pc+=4;
+									} break;
+									case 0x69:{ 
+										if (!(dH & 0x8)){ // MOV.L @ERs, ERd
+											struct RegRef32 Rs = getRegRef32(dH);
+											struct RegRef32 Rd = getRegRef32(dL);
+
+											uint32_t value = getMemory32(*Rs.ptr);
+
+											setFlagsMOV(value, 32);
+											*Rd.ptr = value;
+
+											printInstruction("%04x - MOV.l @ER%d, ER%d\n", pc, Rs.idx, Rd.idx ); 
+											printRegistersState();
+										} else{ // MOV.l ERs, @ERd 
+											struct RegRef32 Rs = getRegRef32(dL);
+											struct RegRef32 Rd = getRegRef32(dH);
+											uint32_t value = *Rs.ptr;
+											setFlagsMOV(value, 32);
+											setMemory32(*Rd.ptr, value);
+											printInstruction("%04x - MOV.l ER%d, @ER%d, \n", pc, Rs.idx, Rd.idx);
+											printMemory(*Rd.ptr, 4);
+										}
+										pc += 2;
+									}break;
+									case 0x66:{ // AND.L Rs, ERd
+										struct RegRef32 Rs = getRegRef32(dH);
+										struct RegRef32 Rd = getRegRef32(dL);
+
+										uint32_t value = *Rs.ptr;
+										uint32_t newValue = value & *Rd.ptr;
+
+										setFlagsMOV(newValue, 32);
+										*Rd.ptr = newValue;
+
+										printInstruction("%04x - AND.l R%d, ER%d\n", pc, Rs.idx, Rd.idx ); 
+										printRegistersState();
+
+										pc += 2;
+									}break;
+									case 0x64:{ // OR.L Rs, ERd
+										struct RegRef32 Rs = getRegRef32(dH);
+										struct RegRef32 Rd = getRegRef32(dL);
+
+										uint32_t value = *Rs.ptr;
+										uint32_t newValue = value | *Rd.ptr;
+
+										setFlagsMOV(newValue, 32);
+										*Rd.ptr = newValue;
+
+									printInstruction("%04x - OR.l R%d, ER%d\n", pc, Rs.idx, Rd.idx ); 
+										printRegistersState();
+
+										pc += 2;
+									}break;
+									case 0x65:{ // XOR.L Rs, ERd
+										struct RegRef32 Rs = getRegRef32(dH);
+										struct RegRef32 Rd = getRegRef32(dL);
+
+										uint32_t value = *Rs.ptr;
+										uint32_t newValue = value ^ *Rd.ptr;
+
+										setFlagsMOV(newValue, 32);
+										*Rd.ptr = newValue;
+
+										printInstruction("%04x - XOR.l R%d, ER%d\n", pc, Rs.idx, Rd.idx ); 
+										printRegistersState();
+
+										pc += 2;
+									}break;
+									default:{
+										return 1;
+									} break;
+
+
+								}
+
+							}break;
+							case 0x4:{
+								pc+=2;
+								if (bL == 0x0 && cH == 0x6){
+									switch(cL){
+										case 0x9:
+										case 0xB:
+										case 0xD:
+										case 0xF:{
+											uint8_t mostSignificantBit = dH >> 7;
+											if (mostSignificantBit == 0x1){
+												printInstruction("%04x - STC\n", pc);// Unused in the ROM
+											}else{
+												printInstruction("%04x - LDC\n", pc); // Unused in the ROM
+											}
+										}break;
+										default:{
+											return 1;
+										} break;
+
+									}
+								}
+							}break;
+							case 0x8:{
+								sleep = true;
+								printInstruction("%04x - SLEEP\n", pc); 
+							}break;
+							case 0xC:{
+								if (bL == 0x0 && cH == 0x5){
+									switch(cL){
+										case 0x0:{ // MULXS B Rs, Rd
+											struct RegRef8 Rs = getRegRef8(dH);
+											struct RegRef16 Rd = getRegRef16(dL);
+											int8_t lowerBitsRd = *Rd.ptr & 0x00FF;
+											*Rd.ptr = (int16_t)*Rs.ptr * (int16_t)lowerBitsRd; 
+											flags.Z = (*Rd.ptr == 0) ? 1 : 0;
+											flags.N = (*Rd.ptr & 0x8000) ? 1 : 0;
+
+											printInstruction("%04x - MULXS B r%d%c, %c%d\n", pc, Rs.idx, Rs.loOrHiReg, Rd.loOrHiReg, Rd.idx);
+											printRegistersState();
+											pc += 2;
+										} break;
+										case 0x2:{
+											// MULXS W Rs, Rd
+											struct RegRef16 Rs = getRegRef16(dH);
+											struct RegRef32 Rd = getRegRef32(dL);
+											int16_t lowerBitsRd = *Rd.ptr & 0x0000FFFF;
+											*Rd.ptr = (int32_t)*Rs.ptr * (int32_t)lowerBitsRd;
+											flags.Z = (*Rd.ptr == 0) ? 1 : 0;
+											flags.N = (*Rd.ptr & 0x80000000) ? 1 : 0;
+
+											printInstruction("%04x - MULXS W %c%d, er%d\n", pc, Rs.loOrHiReg, Rs.idx, Rd.idx);
+											printRegistersState();
+											pc += 2;
+										}break;
+										default:{
+											return 1;
+										} break;
+
+									}
+								};
+							}break;
+							case 0xD:{
+								if (bL == 0x0 && cH == 0x5){
+									switch(cL){ // TODO replace with if, and see if merging it with C & F makes it more readable
+										case 0x1:{ // DIVXS B Rs, Rd
+											struct RegRef8 Rs = getRegRef8(dH);
+											struct RegRef16 Rd = getRegRef16(dL);
+											int8_t quotient = (int16_t)*Rd.ptr / (int8_t)*Rs.ptr;
+											int8_t remainder = (int16_t)*Rd.ptr % (int8_t)*Rs.ptr; // Following C99 rules for the sign of quotient and remainder, the actual behaviour isnt really documented in the H800 manual
+											*Rd.ptr = (remainder << 8) | quotient;
+
+											flags.Z = (*Rs.ptr == 0) ? 1 : 0;
+											flags.N = (((int16_t)quotient) > 0) ? 0 : 1;
+
+											printInstruction("%04x - DIVXS B r%d%c, %c%d\n", pc, Rs.idx, Rs.loOrHiReg, Rd.loOrHiReg, Rd.idx);
+											printRegistersState();
+											pc += 2;
+										} break;
+										case 0x3:{ // DIVXS W Rs, Rd
+											struct RegRef16 Rs = getRegRef16(dH);
+											struct RegRef32 Rd = getRegRef32(dL);
+											int16_t quotient = (int32_t)*Rd.ptr / (int16_t)*Rs.ptr;
+											int16_t remainder = (int32_t)*Rd.ptr % (int16_t)*Rs.ptr; 
+											*Rd.ptr = (remainder << 16) | quotient;
+
+											flags.Z = (*Rs.ptr == 0) ? 1 : 0;
+											flags.N = (quotient & 0x80000000) ? 1 : 0;
+
+											printInstruction("%04x - DIVXU W %c%d, er%d\n", pc, Rs.loOrHiReg, Rs.idx, Rd.idx);
+											printRegistersState();
+											pc += 2;
+										}break;
+										default:{
+											return 1;
+										} break;
+
+									}
+								};
+							}break;
+							case 0xF:{
+								pc+=2;
+								if (bL == 0x0 && cH == 0x6){
+									switch(cL){ // TODO replace with if, and see if merging it with C & F makes it more readable
+										case 0x4:{
+											printInstruction("%04x - OR\n", pc);
+											return 1; // UNIMPLEMENTED
+										}break;
+										case 0x5:{
+											printInstruction("%04x - XOR\n", pc);
+											return 1; // UNIMPLEMENTED
+										}break;
+										case 0x6:{
+											printInstruction("%04x - AND\n", pc);
+											return 1; // UNIMPLEMENTED
+										}break;
+										default:{
+											return 1;
+										} break;
+
+									}
+								};
+							}break;
+
+							default:{
+								printInstruction("???\n");
+								return 1; // UNIMPLEMENTED
+							}break;
+
+						}
+					}break;
+					case 0x2:{
+						printInstruction("%04x - STC\n", pc); // Unused in the ROM
+						return 1; // UNIMPLEMENTED
+					}break;
+					case 0x3:{ // LDC.B Rs, CCR
+						struct RegRef8 Rs = getRegRef8(bL);
+						uint8_t value = *Rs.ptr;
+						setFlags(value);
+						printInstruction("%04x - LDC.B r%d%c, CCR\n", pc, Rs.idx, Rs.loOrHiReg);
+						printRegistersState();
+					}break;
+					case 0x4:{
+						printInstruction("%04x - ORC\n", pc);
+						return 1; // UNIMPLEMENTED
+					}break;
+					case 0x5:{
+						printInstruction("%04x - XORC\n", pc);
+						return 1; // UNIMPLEMENTED
+					}break;
+					case 0x6:{
+						printInstruction("%04x - ANDC\n", pc);
+						return 1; // UNIMPLEMENTED
+					}break;
+					case 0x7:{ // LDC.B #xx:8, CCR
+						uint8_t value = b;
+						setFlags(value);
+						printInstruction("%04x - LDC.B #%x:8, CCR\n", pc, value);
+						printRegistersState();
+					}break;
+					case 0x8:{ // ADD.B Rs, Rd
+						struct RegRef8 Rs = getRegRef8(bH);
+						struct RegRef8 Rd = getRegRef8(bL);
+
+						setFlagsADD(*Rd.ptr, *Rs.ptr, 8);
+						*Rd.ptr += *Rs.ptr;
+
+						printInstruction("%04x - ADD.b R%d%c,R%d%c\n", pc, Rs.idx, Rs.loOrHiReg, Rd.idx, Rd.loOrHiReg); 
+						printRegistersState();
+					}break;
+					case 0x9:{ // ADD.W Rs, Rd
+					struct RegRef16 Rs = getRegRef16(bH);
+					struct RegRef16 Rd = getRegRef16(bL);
+
+						setFlagsADD(*Rd.ptr, *Rs.ptr, 16);
+
+						*Rd.ptr += *Rs.ptr;
+						printInstruction("%04x - ADD.w %c%d,%c%d\n", pc, Rs.loOrHiReg, Rs.idx, Rd.loOrHiReg,  Rd.idx); 
+						printRegistersState();
+
+					}break;
+					case 0xA:{
+						switch(bH){
+							case 0x0:{ // INC.b Rd
+								struct RegRef8 Rd = getRegRef8(bL);
+								setFlagsINC(*Rd.ptr, 1, 8);
+								*Rd.ptr += 1;
+								printInstruction("%04x - INC.b r%d%c\n", pc, Rd.idx, Rd.loOrHiReg);
+								printRegistersState();
+							}break;
+							case 0x8:
+							case 0x9:
+							case 0xA:
+							case 0xB:
+							case 0xC:
+							case 0xD:
+							case 0xE:
+							case 0xF:{ // ADD.l ERs, ERd
+								struct RegRef32 Rs = getRegRef32(bH);
+								struct RegRef32 Rd = getRegRef32(bL);
+
+								setFlagsADD(*Rd.ptr, *Rs.ptr, 32);
+
+								*Rd.ptr += *Rs.ptr;
+								printInstruction("%04x - ADD.l ER%d, ER%d\n", pc, Rs.idx,  Rd.idx); 
+								printRegistersState();
+							}break;
+							default:{
+								return 1;
+							} break;
+						}
+					}break;
+					case 0xB:{ // ADDS and INC
+						switch(bH){
+							case 0x0:{ // ADDS.l #1, ERd
+								struct RegRef32 Rd = getRegRef32(bL);
+								*Rd.ptr += 1;
+								printInstruction("%04x - ADDS.l #1, ER%d\n", pc, Rd.idx);
+							}break;
+							case 0x8:{ // ADDS.l #2, ERd
+								struct RegRef32 Rd = getRegRef32(bL);
+								*Rd.ptr += 2;
+								printInstruction("%04x - ADDS.l #2, ER%d\n", pc, Rd.idx);
+							}break;
+							case 0x9:{ // ADDS.l #4, ERd
+								struct RegRef32 Rd = getRegRef32(bL);
+								*Rd.ptr += 4;
+								printInstruction("%04x - ADDS.l #4, ER%d\n", pc, Rd.idx);
+							}break;
+							case 0x5:{ // INC.w #1, Rd
+								struct RegRef16 Rd = getRegRef16(bL);
+								setFlagsINC(*Rd.ptr, 1, 16); 
+								*Rd.ptr += 1;
+								printInstruction("%04x - INC.w #1, %c%d\n", pc, Rd.loOrHiReg, Rd.idx);
+							}break;
+							case 0x7:{ // INC.l #1, ERd
+								struct RegRef32 Rd = getRegRef32(bL);
+								setFlagsINC(*Rd.ptr, 1, 32);
+								*Rd.ptr += 1;
+								printInstruction("%04x - INC.l #1, ER%d\n", pc, Rd.idx);
+							} break;
+							case 0xD:{ // INC.w #2, Rd
+								struct RegRef16 Rd = getRegRef16(bL);
+								setFlagsINC(*Rd.ptr, 2, 16);
+								*Rd.ptr += 2;
+								printInstruction("%04x - INC.w #2, %c%d\n", pc, Rd.loOrHiReg, Rd.idx);
+							}break;
+							case 0xF:{ // INC.l #2, ERd
+								struct RegRef32 Rd = getRegRef32(bL);
+								setFlagsINC(*Rd.ptr, 2, 32);
+								*Rd.ptr += 2;
+								printInstruction("%04x - INC.l #2, ER%d\n", pc, Rd.idx);
+							}break;
+							default:{
+								return 1;
+							} break;
+						}
+						printRegistersState();
+					}break;
+					case 0xC:{ // MOV.B Rs, Rd
+						struct RegRef8 Rs = getRegRef8(bH);
+						struct RegRef8 Rd = getRegRef8(bL);
+
+						setFlagsMOV(*Rs.ptr, 8);
+						*Rd.ptr = *Rs.ptr;
+
+						printInstruction("%04x - MOV.b R%d%c,R%d%c\n", pc, Rs.idx, Rs.loOrHiReg, Rd.idx, Rd.loOrHiReg); 
+						printRegistersState();
+
+					}break;
+					case 0xD:{ // MOV.W Rs, Rd
+					struct RegRef16 Rs = getRegRef16(bH);
+					struct RegRef16 Rd = getRegRef16(bL);
+
+						setFlagsMOV(*Rs.ptr, 16);
+
+						*Rd.ptr = *Rs.ptr;
+						printInstruction("%04x - MOV.w %c%d,%c%d\n", pc, Rs.loOrHiReg, Rs.idx, Rd.loOrHiReg,  Rd.idx); 
+						printRegistersState();
+
+					}break;
+					case 0xE:{
+						printInstruction("%04x - ADDX\n", pc);
+						return 1; // UNIMPLEMENTED
+					}break;
+					case 0xF:{
+						switch(bH){
+							case 0x0:{
+								printInstruction("%04x - DAA\n", pc);
+								return 1; // UNIMPLEMENTED
+							}break;
+							case 0x8:
+							case 0x9:
+							case 0xA:
+							case 0xB:
+							case 0xC:
+							case 0xD:
+							case 0xE:
+							case 0xF:{// MOV.l ERs, ERd
+								struct RegRef32 Rs = getRegRef32(bH);
+								struct RegRef32 Rd = getRegRef32(bL);
+
+								setFlagsMOV(*Rs.ptr, 32);
+
+								*Rd.ptr = *Rs.ptr;
+								printInstruction("%04x - MOV.l ER%d, ER%d\n", pc, Rs.idx,  Rd.idx); 
+								printRegistersState();
+							}break;
+							default:{
+								return 1;
+							} break;
+						}
+					}break;
+					default:{
+						return 1;
+					} break;
+
+				}
+			}break;
+			case 0x1:{
+				switch(aL){
+					case 0x0:{
+						switch(bH){
+							case 0x0:{ // SHLL.b Rd
+								struct RegRef8 Rd = getRegRef8(bL);
+								flags.C = *Rd.ptr & 0x80;
+								*Rd.ptr = (*Rd.ptr << 1);
+								setFlagsMOV(*Rd.ptr, 8);
+								printInstruction("%04x - SHLL.b r%d%c\n", pc, Rd.idx, Rd.loOrHiReg);
+							}break;
+							case 0x1:{ // SHLL.w Rd
+								struct RegRef16 Rd = getRegRef16(bL);
+								flags.C = *Rd.ptr & 0x8000;
+								*Rd.ptr = (*Rd.ptr << 1);
+								setFlagsMOV(*Rd.ptr, 16);
+								printInstruction("%04x - SHLL.w %c%d\n", pc, Rd.loOrHiReg, Rd.idx);
+							} break;
+							case 0x3:{ // SHLL.l Rd
+								struct RegRef32 Rd = getRegRef32(bL);
+								flags.C = *Rd.ptr & 0x80000000;
+								*Rd.ptr = (*Rd.ptr << 1);
+								setFlagsMOV(*Rd.ptr, 32);
+								printInstruction("%04x - SHLL.l er%d\n", pc, Rd.idx);
+							}break;
+							case 0x8:{ // SHAL.b Rd -- These differ in their treatment of the V flag
+								struct RegRef8 Rd = getRegRef8(bL);
+								flags.C = *Rd.ptr & 0x80;
+								*Rd.ptr = (*Rd.ptr << 1);
+								setFlagsMOV(*Rd.ptr, 8);
+								flags.V = flags.C && !(*Rd.ptr & 0x80);
+								printInstruction("%04x - SHAL.b r%d%c\n", pc, Rd.idx, Rd.loOrHiReg);
+							}break;
+							case 0x9:{ // SHAL.w Rd
+								struct RegRef16 Rd = getRegRef16(bL);
+								flags.C = *Rd.ptr & 0x8000;
+								*Rd.ptr = (*Rd.ptr << 1);
+								setFlagsMOV(*Rd.ptr, 16);
+								flags.V = flags.C && !(*Rd.ptr & 0x8000);
+								printInstruction("%04x - SHAL.w %c%d\n", pc, Rd.loOrHiReg, Rd.idx);
+							}break;
+							case 0xB:{ // SHAL.l Rd
+								struct RegRef32 Rd = getRegRef32(bL);
+								flags.C = *Rd.ptr & 0x80000000;
+								*Rd.ptr = (*Rd.ptr << 1);
+								setFlagsMOV(*Rd.ptr, 32);
+								flags.V = flags.C && !(*Rd.ptr & 0x80000000);
+								printInstruction("%04x - SHAL.l er%d\n", pc, Rd.idx);
+							}break;
+							default:{
+								return 1;
+							} break;
+						}
+						printRegistersState();
+					}break;
+					case 0x1:{
+						switch(bH){
+							case 0x0:{ // SHLR.b Rd
+								struct RegRef8 Rd = getRegRef8(bL);
+								flags.C = *Rd.ptr & 0x1;
+								*Rd.ptr = (*Rd.ptr >> 1);
+								setFlagsMOV(*Rd.ptr, 8);
+								printInstruction("%04x - SHLR.b r%d%c\n", pc, Rd.idx, Rd.loOrHiReg);
+							}break;
+							case 0x1:{ // SHLR.w Rd
+								struct RegRef16 Rd = getRegRef16(bL);
+								flags.C = *Rd.ptr & 0x1;
+								*Rd.ptr = (*Rd.ptr >> 1);
+								setFlagsMOV(*Rd.ptr, 16);
+								printInstruction("%04x - SHLR.w %c%d\n", pc, Rd.loOrHiReg, Rd.idx);
+							} break;
+							case 0x3:{ // SHLR.l Rd
+								struct RegRef32 Rd = getRegRef32(bL);
+								flags.C = *Rd.ptr & 0x1;
+								*Rd.ptr = (*Rd.ptr >> 1);
+								setFlagsMOV(*Rd.ptr, 32);
+								printInstruction("%04x - SHLR.l er%d\n", pc, Rd.idx);
+							}break;
+							case 0x8:{ // SHAR.b Rd - Unused in the ROM
+								return 1;
+							}break;
+							case 0x9:{ // SHAR.w Rd
+								struct RegRef16 Rd = getRegRef16(bL);
+								flags.C = *Rd.ptr & 0x1;
+								*Rd.ptr = (*Rd.ptr >> 1) | (*Rd.ptr & 0x8000);
+								setFlagsMOV(*Rd.ptr, 16);
+								printInstruction("%04x - SHAR.w %c%d\n", pc, Rd.loOrHiReg, Rd.idx);
+							}break;
+							case 0xB:{ // SHAR.l Rd
+								struct RegRef32 Rd = getRegRef32(bL);
+								flags.C = *Rd.ptr & 0x1;
+								*Rd.ptr = (*Rd.ptr >> 1) | (*Rd.ptr & 0x80000000);
+								setFlagsMOV(*Rd.ptr, 32);
+								printInstruction("%04x - SHAR.l er%d\n", pc, Rd.idx);
+							}break;
+							default:{
+								return 1;
+							} break;
+						}
+						printRegistersState();
+					}break;
+					case 0x2:{
+						switch(bH){
+							case 0x0:{ // ROTXL.b Rd
+								struct RegRef8 Rd = getRegRef8(bL);
+								bool oldCarry = flags.C;
+								flags.C = *Rd.ptr & 0x80;
+								*Rd.ptr = (*Rd.ptr << 1) | oldCarry;
+								setFlagsMOV(*Rd.ptr, 8);
+								printInstruction("%04x - ROTXL.b r%d%c\n", pc, Rd.idx, Rd.loOrHiReg);
+							} break;
+							case 0x1:{ // ROTXL.w Rd
+								struct RegRef16 Rd = getRegRef16(bL);
+								bool oldCarry = flags.C;
+								flags.C = *Rd.ptr & 0x8000;
+								*Rd.ptr = (*Rd.ptr << 1) | oldCarry;
+								setFlagsMOV(*Rd.ptr, 16);
+								printInstruction("%04x - ROTXL.w %c%d\n", pc, Rd.loOrHiReg, Rd.idx);
+							} break;
+							case 0x3:{ // ROTXL.l Rd
+								struct RegRef32 Rd = getRegRef32(bL);
+								bool oldCarry = flags.C;
+								flags.C = *Rd.ptr & 0x80000000;
+								*Rd.ptr = (*Rd.ptr << 1) | oldCarry;
+								setFlagsMOV(*Rd.ptr, 32);
+								printInstruction("%04x - ROTXL.l er%d\n", pc, Rd.idx);
+							}break;
+							case 0x8:{ // ROTL.b Rd
+								struct RegRef8 Rd = getRegRef8(bL);
+								flags.C = *Rd.ptr & 0x80;
+								*Rd.ptr = (*Rd.ptr << 1) | flags.C;
+								setFlagsMOV(*Rd.ptr, 8);
+								printInstruction("%04x - ROTL.b r%d%c\n", pc, Rd.idx, Rd.loOrHiReg);
+							} break;
+							case 0x9:{ // ROTL.w Rd
+								struct RegRef16 Rd = getRegRef16(bL);
+								flags.C = *Rd.ptr & 0x8000;
+								*Rd.ptr = (*Rd.ptr << 1) | flags.C;
+								setFlagsMOV(*Rd.ptr, 16);
+								printInstruction("%04x - ROTL.w %c%d\n", pc, Rd.loOrHiReg, Rd.idx);
+							} break;
+							case 0xB:{ // ROTL.l Rd
+								struct RegRef32 Rd = getRegRef32(bL);
+								flags.C = *Rd.ptr & 0x80000000;
+								*Rd.ptr = (*Rd.ptr << 1) | flags.C;
+								setFlagsMOV(*Rd.ptr, 32);
+								printInstruction("%04x - ROTL.l er%d\n", pc, Rd.idx);
+							}break;
+							default:{
+								return 1;
+							} break;
+						}
+						printRegistersState();
+					}break;
+					case 0x3:{ // ROTR and ROTXR - Unused in the ROM
+						return 1;
+					}break;
+					case 0x4:{ // OR.B Rs, Rd
+						struct RegRef8 Rs = getRegRef8(bH);
+						struct RegRef8 Rd = getRegRef8(bL);
+
+						uint8_t newValue = *Rs.ptr | *Rd.ptr;
+
+						setFlagsMOV(newValue, 8);
+						*Rd.ptr = newValue;
+
+						printInstruction("%04x - OR.b R%d%c,R%d%c\n", pc, Rs.idx, Rs.loOrHiReg, Rd.idx, Rd.loOrHiReg); 
+						printRegistersState();
+					}break;
+					case 0x5:{ // XOR.B Rs, Rd
+						struct RegRef8 Rs = getRegRef8(bH);
+						struct RegRef8 Rd = getRegRef8(bL);
+
+						uint8_t newValue = *Rs.ptr ^ *Rd.ptr;
+
+						setFlagsMOV(newValue, 8);
+						*Rd.ptr = newValue;
+
+						printInstruction("%04x - XOR.b R%d%c,R%d%c\n", pc, Rs.idx, Rs.loOrHiReg, Rd.idx, Rd.loOrHiReg); 
+						printRegistersState();
+					}break;
+					case 0x6:{ // AND.B Rs, Rd
+						struct RegRef8 Rs = getRegRef8(bH);
+						struct RegRef8 Rd = getRegRef8(bL);
+
+						uint8_t newValue = *Rs.ptr & *Rd.ptr;
+
+						setFlagsMOV(newValue, 8);
+						*Rd.ptr = newValue;
+
+						printInstruction("%04x - AND.b R%d%c,R%d%c\n", pc, Rs.idx, Rs.loOrHiReg, Rd.idx, Rd.loOrHiReg); 
+						printRegistersState();
+					}break;
+					case 0x7:{
+						switch(bH){
+							case 0x0:{ // NOT.b Rd
+								struct RegRef8 Rd = getRegRef8(bL);
+								*Rd.ptr = ~*Rd.ptr;
+								setFlagsMOV(*Rd.ptr, 8);
+								printInstruction("%04x - NOT.b r%d%c\n", pc, Rd.idx, Rd.loOrHiReg); 
+								printRegistersState();
+							} break;
+							case 0x1:{
+								// NOT.w Rd
+								struct RegRef16 Rd = getRegRef16(bL);
+								*Rd.ptr = ~*Rd.ptr;
+								setFlagsMOV(*Rd.ptr, 16);
+								printInstruction("%04x - NOT.w %c%d\n", pc, Rd.loOrHiReg, Rd.idx); 
+								printRegistersState();
+							} break;
+							case 0x3:{ // NOT.l Rd
+								printInstruction("%04x - NOT.l\n", pc);
+								return 1; // Unused in the ROM
+							}break;
+							case 0x5:{ // EXTU.w Rd
+								struct RegRef16 Rd = getRegRef16(bL);
+								*Rd.ptr = *Rd.ptr & 0x00FF;
+								setFlagsMOV(*Rd.ptr, 16);
+								printInstruction("%04x - EXTU.w %c%d\n", pc, Rd.loOrHiReg, Rd.idx);
+								printRegistersState();
+							} break;
+							case 0x7:{ // EXTU.l Rd
+								struct RegRef32 Rd = getRegRef32(bL);
+								*Rd.ptr = *Rd.ptr & 0x0000FFFF;
+								setFlagsMOV(*Rd.ptr, 32);
+								printInstruction("%04x - EXTU.l er%d\n", pc, Rd.idx);
+								printRegistersState();
+							}break;
+							case 0x8:{ // NEG.b Rd -- TODO: Untested
+								struct RegRef8 Rd = getRegRef8(bL);
+
+								setFlagsSUB(0, *Rd.ptr, 8);
+								if (*Rd.ptr != 0x80){
+									*Rd.ptr = (int8_t)0 - (int8_t)*Rd.ptr;
+								}
+								printInstruction("%04x - NEG.b r%d%c\n", pc, Rd.idx, Rd.loOrHiReg); 
+								printRegistersState();
+
+							} break;
+							case 0x9:{ // NEG.w Rd
+								struct RegRef16 Rd = getRegRef16(bL);
+
+								setFlagsSUB(0, *Rd.ptr, 16);
+								if (*Rd.ptr != 0x8000){
+									*Rd.ptr = (int16_t)0 - (int16_t)*Rd.ptr;
+								}
+								printInstruction("%04x - NEG.w %c%d\n", pc, Rd.loOrHiReg, Rd.idx); 
+								printRegistersState();
+
+							} break;
+							case 0xB:{ // NEG.l Rd
+								printInstruction("%04x - NEG.l\n", pc);
+								return 1; // Unused in the ROM
+							}break;
+							case 0xD:{ // EXTS.w Rd
+								struct RegRef16 Rd = getRegRef16(bL);
+								bool sign = *Rd.ptr & 0x80;
+								if (sign == 0){
+									*Rd.ptr = *Rd.ptr & 0x00FF;
+								} else{
+									*Rd.ptr = (*Rd.ptr & 0x00FF) | 0xFF00;
+								}
+								setFlagsMOV(*Rd.ptr, 16);
+								printInstruction("%04x - EXTS.w %c%d\n", pc, Rd.loOrHiReg, Rd.idx);
+								printRegistersState();
+							} break;
+							case 0xF:{ // EXTS.l Rd
+								struct RegRef32 Rd = getRegRef32(bL);
+								bool sign = *Rd.ptr & 0x8000;
+								if (sign == 0){
+									*Rd.ptr = *Rd.ptr & 0x0000FFFF;
+								} else{
+									*Rd.ptr = (*Rd.ptr & 0x0000FFFF) | 0xFFFF0000;
+								}
+								setFlagsMOV(*Rd.ptr, 32);
+								printInstruction("%04x - EXTS.l er%d\n", pc, Rd.idx);
+								printRegistersState();
+							}break;
+							default:{
+								return 1;
+							} break;
+
+						}
+					}break;
+					case 0x8:{ // SUB.b Rs, Rd
+						struct RegRef8 Rs = getRegRef8(bH);
+						struct RegRef8 Rd = getRegRef8(bL);
+
+						setFlagsSUB(*Rd.ptr, *Rs.ptr, 8);
+						*Rd.ptr -= *Rs.ptr;
+
+						printInstruction("%04x - SUB.b R%d%c,R%d%c\n", pc, Rs.idx, Rs.loOrHiReg, Rd.idx, Rd.loOrHiReg); 
+						printRegistersState();
+
+					}break;
+					case 0x9:{ // SUB.W Rs, Rd
+
+					struct RegRef16 Rs = getRegRef16(bH);
+					struct RegRef16 Rd = getRegRef16(bL);
+
+						setFlagsSUB(*Rd.ptr, *Rs.ptr, 16);
+
+						*Rd.ptr -= *Rs.ptr;
+						printInstruction("%04x - SUB.w %c%d,%c%d\n", pc, Rs.loOrHiReg, Rs.idx, Rd.loOrHiReg,  Rd.idx); 
+						printRegistersState();
+
+					}break;
+					case 0xA:{
+						switch(bH){
+							case 0x0:{ // DEC.b Rd
+								struct RegRef8 Rd = getRegRef8(bL);
+								setFlagsINC(*Rd.ptr, -1, 8);
+								*Rd.ptr -= 1;
+								printInstruction("%04x - DEC.b r%d%c\n", pc, Rd.idx, Rd.loOrHiReg);
+								printRegistersState();
+							}break;
+							case 0x8:
+							case 0x9:
+							case 0xA:
+							case 0xB:
+							case 0xC:
+							case 0xD:
+							case 0xE:
+							case 0xF:{ // SUB.l ERs, ERd
+								struct RegRef32 Rs = getRegRef32(bH);
+								struct RegRef32 Rd = getRegRef32(bL);
+
+								setFlagsSUB(*Rd.ptr, *Rs.ptr, 32);
+
+								*Rd.ptr -= *Rs.ptr;
+								printInstruction("%04x - SUB.l ER%d, ER%d\n", pc, Rs.idx,  Rd.idx); 
+								printRegistersState();
+							}break;
+							default:{
+								return 1;
+							} break;
+
+						}
+					}break;
+					case 0xB:{
+						switch(bH){
+							case 0x0:{ // SUBS #1, ERd
+								struct RegRef32 Rd = getRegRef32(bL);
+
+								*Rd.ptr -= 1;
+								printInstruction("%04x - SUBS #1, ER%d\n", pc, Rd.idx); 
+								printRegistersState();
+							}break;
+							case 0x8:{ // SUBS #2, ERd
+								struct RegRef32 Rd = getRegRef32(bL);
+
+								*Rd.ptr -= 2;
+								printInstruction("%04x - SUBS #2, ER%d\n", pc, Rd.idx); 
+								printRegistersState();
+							}break;
+							case 0x9:{ // SUBS #4, ERd
+								struct RegRef32 Rd = getRegRef32(bL);
+
+								*Rd.ptr -= 4;
+								printInstruction("%04x - SUBS #4, ER%d\n", pc, Rd.idx); 
+								printRegistersState();
+							}break;
+							case 0x5:{ // DEC.w #1, Rd
+								struct RegRef16 Rd = getRegRef16(bL);
+								setFlagsINC(*Rd.ptr, -1, 16);
+								*Rd.ptr -= 1;
+								printInstruction("%04x - DEC.w #1, %c%d\n", pc, Rd.loOrHiReg, Rd.idx);
+								printRegistersState();
+							}break;
+							case 0x7:{ // DEC.l #1, ERd
+								struct RegRef32 Rd = getRegRef32(bL);
+								setFlagsINC(*Rd.ptr, -1, 32);
+								*Rd.ptr -= 1;
+								printInstruction("%04x - DEC.l #1, ER%d\n", pc, Rd.idx);
+								printRegistersState();
+							}break;
+							case 0xD:{ // DEC.w #2, Rd
+								struct RegRef16 Rd = getRegRef16(bL);
+								setFlagsINC(*Rd.ptr, -2, 16);
+								*Rd.ptr -= 2;
+								printInstruction("%04x - DEC.w #2, %c%d\n", pc, Rd.loOrHiReg, Rd.idx);
+								printRegistersState();
+							}break;
+							case 0xF:{ // DEC.l #2, ERd
+								struct RegRef32 Rd = getRegRef32(bL);
+								setFlagsINC(*Rd.ptr, -2, 32);
+								*Rd.ptr -= 2;
+								printInstruction("%04x - DEC.l #2, ER%d\n", pc, Rd.idx);
+								printRegistersState();
+							}break;
+							default:{
+								return 1;
+							} break;
+						}
+					}break;
+					case 0xC:{ // CMP.b Rs, Rd
+						struct RegRef8 Rs = getRegRef8(bH);
+						struct RegRef8 Rd = getRegRef8(bL);
+
+						setFlagsSUB(*Rd.ptr, *Rs.ptr, 8);
+
+						printInstruction("%04x - SUB.b R%d%c,R%d%c\n", pc, Rs.idx, Rs.loOrHiReg, Rd.idx, Rd.loOrHiReg); 
+						printRegistersState();
+
+					}break;
+					case 0xD:{ // CMP.W Rs, Rd
+					struct RegRef16 Rs = getRegRef16(bH);
+					struct RegRef16 Rd = getRegRef16(bL);
+						setFlagsSUB(*Rd.ptr, *Rs.ptr, 16);
+
+						printInstruction("%04x - CMP.w %c%d,%c%d\n", pc, Rs.loOrHiReg, Rs.idx, Rd.loOrHiReg,  Rd.idx); 
+						printRegistersState();
+					}break;
+					case 0xE:{ // SUBX Rs, Rd
+						struct RegRef8 Rs = getRegRef8(bH);
+						struct RegRef8 Rd = getRegRef8(bL);
+
+						setFlagsSUB(*Rd.ptr, *Rs.ptr + flags.C, 8); // NOTE: didn't check edge cases (Rs + flag OV)
+						*Rd.ptr -= *Rs.ptr;
+						*Rd.ptr -= flags.C;
+
+						printInstruction("%04x - SUBX R%d%c,R%d%c\n", pc, Rs.idx, Rs.loOrHiReg, Rd.idx, Rd.loOrHiReg); 
+						printRegistersState();
+					}break;
+					case 0xF:{
+						switch(bH){
+							case 0x0:{
+								printInstruction("%04x - DAS\n", pc);
+								return 1; // UNIMPLEMENTED
+							}break;
+							case 0x8:
+							case 0x9:
+							case 0xA:
+							case 0xB:
+							case 0xC:
+							case 0xD:
+							case 0xE:
+							case 0xF:{ // CMP.l ERs, ERd
+								struct RegRef32 Rs = getRegRef32(bH);
+								struct RegRef32 Rd = getRegRef32(bL);
+
+								setFlagsSUB(*Rd.ptr, *Rs.ptr, 32);
+
+								printInstruction("%04x - CMP.l ER%d, ER%d\n", pc, Rs.idx,  Rd.idx); 
+								printRegistersState();
+							}break;
+							default:{
+								return 1;
+							} break;
+						}
+					}break;
+					default:{
+						return 1;
+					} break;
+				}
+			}break;
+
+			case 0x2:{ // MOV.B @aa:8, Rd
+				uint32_t address = (b & 0x000000FF) | 0x00FFFF00; // Upper 16 bits assumed to be 1
+				uint8_t value = getMemory8(address);
+
+				struct RegRef8 Rd = getRegRef8(aL);
+				setFlagsMOV(value, 8);
+				*Rd.ptr = value;
+
+				printInstruction("%04x - MOV.b @%x:8, R%d%c\n", pc, address, Rd.idx, Rd.loOrHiReg); 
+				printRegistersState();
+
+
+			}break;
+			case 0x3:{ // MOV.B Rs, @aa:8 
+				uint32_t address = (b & 0x000000FF) | 0x00FFFF00; // Upper 16 bits assumed to be 1
+
+				struct RegRef8 Rs = getRegRef8(aL);
+				uint8_t value = *Rs.ptr;
+				setFlagsMOV(value, 8);
+				setMemory8(address, value);
+
+				printInstruction("%04x - MOV.b R%d%c,@%x:8 \n", pc, Rs.idx, Rs.loOrHiReg, address); 
+				printMemory(address, 1);
+				printRegistersState();
+
+
+
+			}break;
+			case 0x4:{
+				int8_t disp = b;
+
+				switch(aL){
+					case 0x0:{ // BRA d:8
+						printInstruction("%04x - BRA %d:8\n", pc, disp);
+						pc += disp; 
+					}break;
+					case 0x1:{ // Unused in the ROM
+						printInstruction("%04x - BRN %d:8\n", pc, disp);
+						return 1; // UNIMPLEMENTED
+					}break;
+					case 0x2:{
+						printInstruction("%04x - BHI %d:8\n", pc, disp);
+						if(!(flags.C | flags.Z)){
+							pc += disp;
+						}
+					}break;
+					case 0x3:{
+						printInstruction("%04x - BLS %d:8\n", pc, disp);
+						if((flags.C | flags.Z)){
+							pc += disp;
+						}
+					}break;
+					case 0x4:{
+						printInstruction("%04x - BCC %d:8\n", pc, disp);
+						if(!(flags.C)){
+							pc += disp;
+						}
+					}break;
+					case 0x5:{
+						printInstruction("%04x - BCS %d:8\n", pc, disp);
+						if(flags.C){
+							pc += disp;
+						}
+					}break;
+					case 0x6:{
+						printInstruction("%04x - BNE %d:8\n", pc, disp);
+						if(!(flags.Z)){
+							pc += disp;
+						}
+					}break;
+					case 0x7:{
+						printInstruction("%04x - BEQ %d:8\n", pc, disp);
+						if(flags.Z){
+							pc += disp;
+						}
+					}break;
+					case 0x8:{
+						printInstruction("%04x - BVC %d:8\n", pc, disp);
+						if(!(flags.V)){
+							pc += disp;
+						}
+					}break;
+					case 0x9:{
+						printInstruction("%04x - BVS %d:8\n", pc, disp);
+						if(flags.V){
+							pc += disp;
+						}
+					}break;
+					case 0xA:{
+						printInstruction("%04x - BPL %d:8\n", pc, disp);
+						if(!(flags.N)){
+							pc += disp;
+						}
+					}break;
+					case 0xB:{
+						printInstruction("%04x - BMI %d:8\n", pc, disp);
+						if(flags.N){
+							pc += disp;
+						}
+					}break;
+					case 0xC:{
+						printInstruction("%04x - BGE %d:8\n", pc, disp);
+						if(!(flags.N ^ flags.V)){
+							pc += disp;
+						}
+					}break;
+					case 0xD:{
+						printInstruction("%04x - BLT %d:8\n", pc, disp);
+						if((flags.N ^ flags.V)){
+							pc += disp;
+						}
+
+					}break;
+					case 0xE:{
+						printInstruction("%04x - BGT %d:8\n", pc, disp);
+					if(!(flags.Z | (flags.N ^ flags.V))){
+							pc += disp;
+						}
+
+					}break;
+					case 0xF:{
+						printInstruction("%04x - BLE %d:8\n", pc, disp);
+						if(flags.Z | (flags.N ^ flags.V)){
+							pc += disp;
+						}
+					}break;
+					default:{
+						return 1;
+					} break;
+				}
+			}break;
+			case 0x5:{
+				switch(aL){
+					case 0x0:{ // MULXU B Rs, Rd
+						struct RegRef8 Rs = getRegRef8(bH);
+					struct RegRef16 Rd = getRegRef16(bL);
+						uint8_t lowerBitsRd = *Rd.ptr & 0x00FF;
+						*Rd.ptr = *Rs.ptr * lowerBitsRd;
+						printInstruction("%04x - MULXU B r%d%c, %c%d\n", pc, Rs.idx, Rs.loOrHiReg, Rd.loOrHiReg, Rd.idx);
+						printRegistersState();
+					} break;
+					case 0x2:{// MULXU W Rs, Rd
+					struct RegRef16 Rs = getRegRef16(bH);
+					struct RegRef32 Rd = getRegRef32(bL);
+						uint16_t lowerBitsRd = *Rd.ptr & 0x0000FFFF;
+						*Rd.ptr = *Rs.ptr * lowerBitsRd;
+
+						printInstruction("%04x - MULXU W %c%d, er%d\n", pc, Rs.loOrHiReg, Rs.idx, Rd.idx);
+						printRegistersState();
+					}break;
+					case 0x1:{ // DIVXU B Rs, Rd
+						struct RegRef8 Rs = getRegRef8(bH);
+					struct RegRef16 Rd = getRegRef16(bL);
+						uint8_t quotient = *Rd.ptr / *Rs.ptr;
+						uint8_t remainder = *Rd.ptr % *Rs.ptr; 
+						*Rd.ptr = (remainder << 8) | quotient;
+
+						flags.Z = (*Rs.ptr == 0) ? 1 : 0;
+						flags.N = (*Rs.ptr & 0x8000) ? 1 : 0;
+
+						printInstruction("%04x - DIVXU B r%d%c, %c%d\n", pc, Rs.idx, Rs.loOrHiReg, Rd.loOrHiReg, Rd.idx);
+						printRegistersState();
+
+
+					} break;
+					case 0x3:{ // DIVXU W Rs, Rd
+					struct RegRef16 Rs = getRegRef16(bH);
+					struct RegRef32 Rd = getRegRef32(bL);
+						uint16_t quotient = *Rd.ptr / *Rs.ptr;
+						uint16_t remainder = *Rd.ptr % *Rs.ptr; 
+						*Rd.ptr = (remainder << 16) | quotient;
+
+						flags.Z = (*Rs.ptr == 0) ? 1 : 0;
+						flags.N = (*Rs.ptr & 0x80000000) ? 1 : 0;
+
+						printInstruction("%04x - DIVXU W %c%d, er%d\n", pc, Rs.loOrHiReg, Rs.idx, Rd.idx);
+						printRegistersState();
+
+					}break;
+					case 0x4:{ // RTS
+					printInstruction("%04x - RTS\n", pc);
+						pc = getMemory16(*SP) - 2;
+						*SP += 2;
+						printRegistersState();
+					}break;
+					case 0x5:{ // BSR d:8
+						int8_t disp = b;
+						printInstruction("%04x - BSR @%d:8\n", pc, disp);
+						*SP -= 2;
+						setMemory16(*SP, pc + 2);
+
+						pc = pc + disp; // No need to increment pc by 2 since we're always doing that at the end of the loop
+
+						printMemory(*SP, 2);
+						printRegistersState();
+					}break;
+					case 0xC:{ // BSR d:16
+						int16_t disp = cd; 
+						printInstruction("%04x - BSR @%d:16\n", pc, disp);
+						*SP -= 2;
+						setMemory16(*SP, pc + 4);
+
+						pc = pc + 2 + disp; // Increment pc by 2 since we need the next instruction (pc + 4) and we're already adding 2 at the end of the loop.
+
+						printMemory(*SP, 2);
+						printRegistersState();
+					}break;
+					case 0x6:{
+						pc = interruptSavedAddress - 2; // -2?
+						flags = interruptSavedFlags;
+						updatePendingInterrupts();
+						printInstruction("%04x - RTE\n", pc);
+					}break;
+					case 0x7:{
+						printInstruction("%04x - TRAPA\n", pc);
+						return 1; // UNIMPLEMENTED
+					}break;
+					case 0x8:{
+						int16_t disp = cd;
+						switch(bH){
+							case 0x0:{
+								printInstruction("%04x - BRA %d:16\n", pc, disp);
+								pc += 2 + disp;
+							}break;
+							case 0x1:{ // Unused in the ROM
+								printInstruction("%04x - BRN %d:16\n", pc, disp);
+							}break;
+							case 0x2:{
+								printInstruction("%04x - BHI %d:16\n", pc, disp);
+								if(!(flags.C | flags.Z)){
+									pc += 2 + disp;
+								}else{
+									pc += 2;
+								}
+							}break;
+							case 0x3:{
+								printInstruction("%04x - BLS %d:16\n", pc, disp);
+								if(flags.C | flags.Z){
+									pc += 2 + disp;
+								}else{
+									pc += 2;
+								}
+
+							}break;
+							case 0x4:{
+								printInstruction("%04x - BCC %d:16\n", pc, disp);
+								if(!flags.C){
+									pc += 2 + disp;
+								}else{
+									pc += 2;
+								}
+
+							}break;
+							case 0x5:{
+								printInstruction("%04x - BCS %d:16\n", pc, disp);
+								if(flags.C){
+									pc += 2 + disp;
+								}else{
+									pc += 2;
+								}
+
+							}break;
+							case 0x6:{
+								printInstruction("%04x - BNE %d:16\n", pc, disp);
+								if(!flags.Z){
+									pc += 2 + disp;
+								}else{
+									pc += 2;
+								}
+
+							}break;
+							case 0x7:{
+								printInstruction("%04x - BEQ %d:16\n", pc, disp);
+								if(flags.Z){
+									pc += 2 + disp;
+								}else{
+									pc += 2;
+								}
+
+							}break;
+							case 0x8:{
+								printInstruction("%04x - BVC %d:16\n", pc, disp);
+								if(!flags.V){
+									pc += 2 + disp;
+								}else{
+									pc += 2;
+								}
+
+							}break;
+							case 0x9:{
+								printInstruction("%04x - BVS %d:16\n", pc, disp);
+								if(flags.V){
+									pc += 2 + disp;
+								}else{
+									pc += 2;
+								}
+
+							}break;
+							case 0xA:{
+								printInstruction("%04x - BPL %d:16\n", pc, disp);
+								if(!flags.N){
+									pc += 2 + disp;
+								}else{
+									pc += 2;
+								}
+
+							}break;
+							case 0xB:{
+								printInstruction("%04x - BMI %d:16\n", pc, disp);
+								if(flags.N){
+									pc += 2 + disp;
+								}else{
+									pc += 2;
+								}
+
+							}break;
+							case 0xC:{
+								printInstruction("%04x - BGE %d:16\n", pc, disp);
+								if(!(flags.N ^ flags.V)){
+									pc += 2 + disp;
+								}else{
+									pc += 2;
+								}
+
+							}break;
+							case 0xD:{
+								printInstruction("%04x - BLT %d:16\n", pc, disp);
+								if(flags.N ^ flags.V){
+									pc += 2 + disp;
+								}else{
+									pc += 2;
+								}
+
+							}break;
+							case 0xE:{
+								printInstruction("%04x - BGT %d:16\n", pc, disp);
+								if(!(flags.Z | (flags.N ^ flags.V))){
+									pc += 2 + disp;
+								}else{
+									pc += 2;
+								}
+
+							}break;
+							case 0xF:{
+								printInstruction("%04x - BLE %d:16\n", pc, disp);
+								if((flags.Z | (flags.N ^ flags.V))){
+									pc += 2 + disp;
+								}else{
+									pc += 2;
+								}
+
+							}break;
+							default:{
+								return 1;
+							} break;
+						}				
+					}break;
+					case 0x9:{ // JMP @ERn
+					struct RegRef32 Er = getRegRef32(bH);
+						printInstruction("%04x - JMP @ER%d\n", pc, Er.idx);
+						pc = (*Er.ptr & 0x0000FFFF) - 2; // Sub 2 cause we're incrementing 2 at the end of the loop
+					}break;
+					case 0xA:{ // JMP @aa:24
+						uint32_t address = (b << 16) | cd;
+						printInstruction("%04x - JMP @0x%04x:24\n", pc, address);
+						pc = address - 2; // Sub 2 cause we're incrementing 2 at the end of the loop
+					}break;
+					case 0xB:{ // JMP @@aa:8 - UNUSED IN THE ROM, left unimplemented.
+						printInstruction("%04x - ????\n", pc);
+					}break;
+					case 0xD:{ // JSR @ERn
+					struct RegRef32 Er = getRegRef32(bH);
+
+						*SP -= 2;
+						setMemory16(*SP, pc + 2);
+
+						printInstruction("%04x - JSR @ER%d\n", pc, Er.idx);
+						pc = (*Er.ptr & 0x0000FFFF) - 2; // Sub 2 cause we're incrementing 2 at the end of the loop
+
+						printMemory(*SP, 2);
+						printRegistersState();
+					}break;
+					case 0xE:{ // JSR @aa:24
+						uint32_t address = (b << 16) | cd;
+
+						*SP -= 2;
+						setMemory16(*SP, pc + 4);
+
+						printInstruction("%04x - JSR @0x%04x:24\n", pc, address);
+						pc = address - 2; // Sub 2 cause we're incrementing 2 at the end of the loop
+
+						printMemory(*SP, 2);
+						printRegistersState();
+
+					}break;
+					case 0xF:{ // JSR @@aa:24 - UNUSED IN THE ROM, left unimplemented.
+						printInstruction("%04x - ????\n", pc);
+					}break;
+					default:{
+						return 1;
+					} break;
+
+				}
+			}break;
+			case 0x6:{
+				switch(aL){
+					case 0x0:{ // BSET Rn, Rd
+
+						struct RegRef8 Rd = getRegRef8(bL);		
+						struct RegRef8 Rn = getRegRef8(bH);		
+						int bitToSet = *Rn.ptr;
+
+						*Rd.ptr = *Rd.ptr | (1 << bitToSet);
+
+						printInstruction("%04x - BSET r%d%c, r%d%c\n", pc, Rn.idx, Rn.loOrHiReg, Rd.idx, Rd.loOrHiReg);
+						printRegistersState();
+					}break;
+					case 0x1:{
+						printInstruction("%04x - BNOT\n", pc);
+						return 1; // UNUSED IN THE ROM
+					}break;
+					case 0x2:{ // BCLR Rn, Rd
+						struct RegRef8 Rd = getRegRef8(bL);		
+						struct RegRef8 Rn = getRegRef8(bH);		
+						int bitToClear = *Rn.ptr;
+
+						*Rd.ptr = *Rd.ptr & ~(1 << bitToClear);
+
+						printInstruction("%04x - BCLR r%d%c, r%d%c\n", pc, Rn.idx, Rn.loOrHiReg, Rd.idx, Rd.loOrHiReg);
+						printRegistersState();
+					}break;
+					case 0x3:{
+						printInstruction("%04x - BTST\n", pc);
+						return 1; // UNIMPLEMENTED
+					}break;
+					case 0x4:{ // OR.w Rs, Rd
+					struct RegRef16 Rd = getRegRef16(bL);
+					struct RegRef16 Rs = getRegRef16(bH);
+						uint16_t newValue = *Rs.ptr | *Rd.ptr;
+						setFlagsMOV(newValue, 16);
+						*Rd.ptr = newValue;
+
+						printInstruction("%04x - OR.w %c%d,%c%d\n", pc, Rs.loOrHiReg, Rs.idx, Rd.loOrHiReg,  Rd.idx); 
+						printRegistersState();
+					}break;
+					case 0x5:{ // XOR.w Rs, Rd
+					struct RegRef16 Rd = getRegRef16(bL);
+					struct RegRef16 Rs = getRegRef16(bH);
+						uint16_t newValue = *Rs.ptr ^ *Rd.ptr;
+						setFlagsMOV(newValue, 16);
+						*Rd.ptr = newValue;
+
+						printInstruction("%04x - XOR.w %c%d,%c%d\n", pc, Rs.loOrHiReg, Rs.idx, Rd.loOrHiReg,  Rd.idx); 
+						printRegistersState();
+					}break;
+					case 0x6:{ // AND.w Rs, Rd
+					struct RegRef16 Rd = getRegRef16(bL);
+					struct RegRef16 Rs = getRegRef16(bH);
+						uint16_t newValue = *Rs.ptr & *Rd.ptr;
+						setFlagsMOV(newValue, 16);
+						*Rd.ptr = newValue;
+
+						printInstruction("%04x - AND.w %c%d,%c%d\n", pc, Rs.loOrHiReg, Rs.idx, Rd.loOrHiReg,  Rd.idx); 
+						printRegistersState();
+					}break;
+					case 0x7:{ // BST #xx:3, Rd
+						uint8_t mostSignificantBit = bH >> 7;
+						if (mostSignificantBit == 0x1){
+							printInstruction("%04x - BIST\n", pc);
+						}else{
+							uint8_t bitToSet = bH;
+							struct RegRef8 Rd = getRegRef8(bL);
+							if (flags.C == 0){
+								setMemory8(*Rd.ptr, getMemory8(*Rd.ptr) & ~(1 << bitToSet));
+							} else{
+								setMemory8(*Rd.ptr, getMemory8(*Rd.ptr) | (1 << bitToSet));
+							}
+							printInstruction("%04x - BST #%d, R%d%c\n", pc, bitToSet, Rd.idx, Rd.loOrHiReg);
+						}					
+					}break;
+					case 0x8:{ 
+						if(!(b & 0x80)){ // MOV.B @ERs, Rd
+							struct RegRef32 Rs = getRegRef32(bH);
+							struct RegRef8 Rd = getRegRef8(bL);
+
+							uint8_t value = getMemory8(*Rs.ptr);
+
+							setFlagsMOV(value, 8);
+							*Rd.ptr = value;
+
+							printInstruction("%04x - MOV.b @ER%d, R%d%c\n", pc, Rs.idx, Rd.idx, Rd.loOrHiReg); 
+						} else{// MOV.B Rs, @ERd 
+							struct RegRef8 Rs = getRegRef8(bL);
+							struct RegRef32 Rd = getRegRef32(bH);
+
+							uint8_t value = *Rs.ptr;
+
+							setFlagsMOV(value, 8);
+							setMemory8(*Rd.ptr, value);
+							printInstruction("%04x - MOV.b R%d%c, @ER%d, \n", pc, Rs.idx, Rs.loOrHiReg, Rd.idx);
+							printMemory(*Rd.ptr, 1);
+						}
+						printRegistersState();
+					}break;
+					case 0x9:{ 
+						if(!(b & 0x80)){ // MOV.w @ERs, Rd
+							struct RegRef32 Rs = getRegRef32(bH);
+							struct RegRef16 Rd = getRegRef16(bL);
+							uint16_t value = getMemory16(*Rs.ptr);
+							setFlagsMOV(value, 16);
+							*Rd.ptr = value;
+							printInstruction("%04x - MOV.w @ER%d, %c%d\n", pc, Rs.idx, Rd.loOrHiReg, Rd.idx ); 
+						} else{ // MOV.w Rs, @ERd 
+							struct RegRef16 Rs = getRegRef16(bL);
+							struct RegRef32 Rd = getRegRef32(bH);
+							uint16_t value = *Rs.ptr;
+							setFlagsMOV(value, 16);
+							setMemory16(*Rd.ptr, value);
+							printInstruction("%04x - MOV.w R%d%c, @ER%d, \n", pc, Rs.idx, Rs.loOrHiReg, Rd.idx);
+							printMemory(*Rd.ptr, 2);
+						}
+						printRegistersState();
+
+					} break;
+					case 0xA:{ 
+						switch(bH){
+							case 0x0:{ // MOV.B @aa:16, Rd
+								uint32_t address = (cd & 0x0000FFFF) | 0x00FF0000; // Upper 16 bits assumed to be 1
+								uint8_t value = getMemory8(address);
+
+								struct RegRef8 Rd = getRegRef8(bL);
+
+								setFlagsMOV(value, 8);
+								*Rd.ptr = value;
+
+
+								printInstruction("%04x - MOV.b @%x:16, R%d%c\n", pc, address, Rd.idx, Rd.loOrHiReg); 
+								printRegistersState();
+
+							}break;
+
+							case 0x8:{ // MOV.B Rs, @aa:16 
+								uint32_t address = (cd & 0x0000FFFF) | 0x00FF0000; // Upper 16 bits assumed to be 1
+
+								struct RegRef8 Rs = getRegRef8(bL);
+
+								uint8_t value = *Rs.ptr;
+								setFlagsMOV(value, 8);
+								setMemory8(address, value);
+
+								printInstruction("%04x - MOV.b R%d%c,@%x:16 \n", pc, Rs.idx, Rs.loOrHiReg, address); 
+								printMemory(address, 1);
+								printRegistersState();
+
+							}break;
+							default:{
+								return 1;
+							} break;
+						}
+						pc+=2;
+
+					}break;
+					case 0xB:{
+						switch(bH){
+							case 0x0:{ // MOV.w @aa:16, Rd
+								uint32_t address = (cd & 0x0000FFFF) | 0x00FF0000; // Upper 16 bits assumed to be 1
+								uint16_t value = getMemory16(address);
+
+								struct RegRef16 Rd = getRegRef16(bL);
+
+								setFlagsMOV(value, 16);
+								*Rd.ptr = value;
+
+								printInstruction("%04x - MOV.w @%x:16, %c%d\n", pc, address, Rd.loOrHiReg, Rd.idx); 
+								printRegistersState();
+
+							}break;
+
+							case 0x8:{ // MOV.w Rs, @aa:16 
+								uint32_t address = (cd & 0x0000FFFF) | 0x00FF0000; // Upper 16 bits assumed to be 1
+
+								struct RegRef16 Rs = getRegRef16(bL);
+
+								uint16_t value = *Rs.ptr;
+								setFlagsMOV(value, 16);
+								setMemory16(address, value);
+
+								printInstruction("%04x - MOV.w %c%d,@%x:16 \n", pc, Rs.loOrHiReg, Rs.idx, address); 
+								printMemory(address, 2);
+								printRegistersState();
+
+							}break;
+							default:{
+								return 1;
+							} break;
+						}
+						pc+=2;
+
+					}break;
+					case 0xC:{ // MOV.B @ERs+, Rd --- MOV.B Rs, @-ERd
+						char incOrDec = (bH & 0b1000) ? '-' : '+';
+
+						if (incOrDec == '+'){
+							struct RegRef32 Rs = getRegRef32(bH);
+							struct RegRef8 Rd = getRegRef8(bL);
+
+							uint8_t value = getMemory8(*Rs.ptr);
+
+							*Rs.ptr += 1;
+
+							setFlagsMOV(value, 8);
+							*Rd.ptr = value;
+
+							printInstruction("%04x - MOV.b @ER%d+, R%d%c\n", pc, Rs.idx, Rd.idx, Rd.loOrHiReg); 
+
+						} else{
+							struct RegRef32 Rd = getRegRef32(bH);
+							struct RegRef8 Rs = getRegRef8(bL);
+
+							*Rd.ptr -= 1;
+
+
+							uint8_t value = *Rs.ptr;
+							setMemory8(*Rs.ptr, value);
+							setFlagsMOV(value, 8);
+
+							printInstruction("%04x - MOV.b R%d%c, @-ER%d, \n", pc, Rs.idx, Rs.loOrHiReg, Rd.idx); 
+							printMemory(*Rd.ptr, 1);
+
+						}
+						printRegistersState();
+
+
+
+					}break;
+					case 0xD:{ // MOV.w @ERs+, Rd --- MOV.w Rs, @-ERd
+						char incOrDec = (bH & 0b1000) ? '-' : '+';
+
+						if (incOrDec == '+'){
+							struct RegRef32 Rs = getRegRef32(bH);
+							struct RegRef16 Rd = getRegRef16(bL);
+
+							uint16_t value = getMemory16(*Rs.ptr);
+
+							*Rs.ptr += 2;
+
+							setFlagsMOV(value, 16);
+							*Rd.ptr = value;
+
+							printInstruction("%04x - MOV.w @ER%d+, %c%d\n", pc, Rs.idx, Rd.loOrHiReg, Rd.idx); 
+
+						} else{
+							struct RegRef32 Rd = getRegRef32(bH);
+							struct RegRef16 Rs = getRegRef16(bL);
+
+							*Rd.ptr -= 2;
+
+							uint16_t value = *Rs.ptr;
+							setMemory16(*Rd.ptr, value);
+							setFlagsMOV(value, 16);
+
+							printInstruction("%04x - MOV.w %c%d, @-ER%d, \n", pc, Rs.loOrHiReg, Rs.idx, Rd.idx); 
+							printMemory(*Rd.ptr, 2);
+						}
+						printRegistersState();
+					} break;
+					case 0xE:{ 
+						struct RegRef8 Rd = getRegRef8(bL);
+					struct RegRef32 Rs = getRegRef32(bH);
+
+						uint16_t disp = cd;
+						bool msbDisp = disp & 0x8000;
+						uint32_t signExtendedDisp = msbDisp ? (0xFFFF0000 | disp) : disp;
+
+						if (!(bH & 0b1000)){ // From memory MOV.B @(d:16, ERs), Rd
+							uint8_t value = getMemory8(*Rs.ptr + signExtendedDisp);
+							*Rd.ptr = value;
+							setFlagsMOV(value, 8);
+
+							printInstruction("%04x - MOV.b @(%d:16, ER%d), R%d%c\n", pc, disp, Rs.idx, Rd.idx, Rd.loOrHiReg); 
+
+						} else{ // To memory MOV.B Rs, @(d:16, ERd)
+							uint8_t value = *Rd.ptr;
+							setFlagsMOV(value, 8);
+							setMemory8(*Rs.ptr + signExtendedDisp, value);
+							printInstruction("%04x - MOV.b R%d%c, @(%d:16, ER%d), \n", pc, Rd.idx, Rd.loOrHiReg, disp, Rs.idx); 
+							printMemory(*Rs.ptr + signExtendedDisp, 1);
+						}
+						printRegistersState();
+						pc+=2;
+					}break;
+					case 0xF:{ 
+						struct RegRef16 Rd = getRegRef16(bL);
+					struct RegRef32 Rs = getRegRef32(bH);
+						uint16_t disp = cd;
+						bool msbDisp = disp & 0x8000;
+						uint32_t signExtendedDisp = msbDisp ? (0xFFFF0000 | disp) : disp;
+
+						if (!(bH & 0b1000)){ // From memory MOV.W @(d:16, ERs), Rd
+							uint16_t value = getMemory16(*Rs.ptr + signExtendedDisp);
+							*Rd.ptr = value;
+							setFlagsMOV(value, 16);
+
+							printInstruction("%04x - MOV.w @(%d:16, ER%d), %c%d\n", pc, disp, Rs.idx, Rd.loOrHiReg, Rd.idx); 
+
+						} else{ // To memory MOV.W Rs, @(d:16, ERd)
+							uint16_t value = *Rd.ptr;
+							setFlagsMOV(value, 16);
+							setMemory16(*Rs.ptr + signExtendedDisp, value);
+							printInstruction("%04x - MOV.w %c%d, @(%d:16, ER%d), \n", pc, Rd.loOrHiReg, Rd.idx, disp, Rs.idx); 
+							printMemory(*Rs.ptr + signExtendedDisp, 2);
+						}
+						printRegistersState();
+						pc+=2;
+
+
+					}break;
+					default:{
+						return 1;
+					} break;
+				}
+			}break;
+			case 0x7:{
+				uint8_t mostSignificantBit = bH >> 7;
+				switch(aL){
+					case 0x0:{ // BSET #xx:3, Rd
+
+						struct RegRef8 Rd = getRegRef8(bL);		
+
+						int bitToSet = bH;
+
+						*Rd.ptr = *Rd.ptr | (1 << bitToSet);
+
+						printInstruction("%04x - BSET #%d, r%d%c\n", pc, bitToSet, Rd.idx, Rd.loOrHiReg);
+						printRegistersState();
+					}break;
+					case 0x1:{
+						return 1; // UNUSED IN THE ROM
+						printInstruction("%04x - BNOT\n", pc);
+					}break;
+					case 0x2:{ // BCLR #xx:3, Rd
+
+						struct RegRef8 Rd = getRegRef8(bL);		
+
+						int bitToClear = bH;
+
+						*Rd.ptr = *Rd.ptr & ~(1 << bitToClear);
+
+						printInstruction("%04x - BCLR #%d, r%d%c\n", pc, bitToClear, Rd.idx, Rd.loOrHiReg);
+						printRegistersState();
+					}break;
+					case 0x3:{
+						struct RegRef8 Rd = getRegRef8(bL);
+						int bitToTest = bH;
+					flags.Z = !(*Rd.ptr & (1<<bitToTest));
+						printInstruction("%04x - BTST #%d, r%d%c\n", pc, bitToTest, Rd.idx, Rd.loOrHiReg);
+					}break;
+					case 0x4:{
+						if (mostSignificantBit == 0x1){
+							printInstruction("%04x - BIOR\n", pc);
+							return 1; // UNIMPLEMENTED
+						}else{
+							printInstruction("%04x - BOR\n", pc);
+							return 1; // UNIMPLEMENTED
+						}
+					}break;
+					case 0x5:{
+						if (mostSignificantBit == 0x1){
+							printInstruction("%04x - BIXOR\n", pc);
+							return 1; // UNIMPLEMENTED
+						}else{
+							printInstruction("%04x - BXOR\n", pc);
+							return 1; // UNIMPLEMENTED
+						}
+					}break;
+					case 0x6:{
+						if (mostSignificantBit == 0x1){
+							printInstruction("%04x - BIAND\n", pc);
+							return 1; // UNIMPLEMENTED
+						}else{
+							printInstruction("%04x - BAND\n", pc);
+							return 1; // UNIMPLEMENTED
+						}
+					}break;
+					case 0x7:{
+						if (mostSignificantBit == 0x1){
+							printInstruction("%04x - BILD\n", pc);
+						}else{ // BLD #xx:3, Rd
+							struct RegRef8 Rd = getRegRef8(bL);		
+
+							int bitToLoad = bH;
+
+							flags.C = *Rd.ptr & (1 << bitToLoad);
+
+							printInstruction("%04x - BLD #%d, r%d%c\n", pc, bitToLoad, Rd.idx, Rd.loOrHiReg);
+							printRegistersState();
+						}					
+					}break;
+					case 0x8:{
+					printInstruction("%04x - MOV\n", pc);
+						return 1; // UNIMPLEMENTED
+					}break;
+					case 0x9:{ // XXX.w #xx:16, Rd
+					struct RegRef16 Rd = getRegRef16(bL);
+						switch(bH){ 
+							case 0x0:{ // MOV.w #xx:16, Rd
+								setFlagsMOV(cd, 16);
+								*Rd.ptr = cd;
+								printInstruction("%04x - MOV.w 0x%x,%c%d\n", pc, cd, Rd.loOrHiReg,  Rd.idx); 
+							}break;
+							case 0x1:{ // ADD.w #xx:16, Rd
+								setFlagsADD(*Rd.ptr, cd, 16);
+								*Rd.ptr += cd;
+								printInstruction("%04x - ADD.w 0x%x,%c%d\n", pc, cd, Rd.loOrHiReg,  Rd.idx); 
+							}break;
+							case 0x2:{ // CMP.w #xx:16, Rd
+								setFlagsSUB(*Rd.ptr, cd, 16);
+								printInstruction("%04x - CMP.w 0x%x,%c%d\n", pc, cd, Rd.loOrHiReg,  Rd.idx); 
+							}break;
+							case 0x3:{ // SUB.w #xx:16, Rd
+								setFlagsSUB(*Rd.ptr, cd, 16);
+								*Rd.ptr -= cd;
+								printInstruction("%04x - SUB.w 0x%x,%c%d\n", pc, cd, Rd.loOrHiReg,  Rd.idx); 
+							}break;
+							case 0x4:{ // OR.w #xx:16, Rd
+								uint16_t value = cd;
+								uint16_t newValue = cd | *Rd.ptr;
+								setFlagsMOV(newValue, 16);
+								*Rd.ptr = newValue;
+								printInstruction("%04x - OR.w 0x%x,%c%d\n", pc, cd, Rd.loOrHiReg,  Rd.idx); 
+							}break;
+							case 0x5:{ // XOR.w #xx:16, Rd
+								uint16_t value = cd;
+								uint16_t newValue = cd ^ *Rd.ptr;
+								setFlagsMOV(newValue, 16);
+								*Rd.ptr = newValue;
+								printInstruction("%04x - XOR.w 0x%x,%c%d\n", pc, cd, Rd.loOrHiReg,  Rd.idx); 
+							}break;
+							case 0x6:{ // AND.w #xx:16, Rd
+								uint16_t value = cd;
+								uint16_t newValue = cd & *Rd.ptr;
+								setFlagsMOV(newValue, 16);
+								*Rd.ptr = newValue;
+								printInstruction("%04x - AND.w 0x%x,%c%d\n", pc, cd, Rd.loOrHiReg,  Rd.idx); 
+							}break;
+							default:{
+								return 1;
+							} break;
+						}
+						printRegistersState();
+						pc+=2;
+					}break;
+					case 0xA:{ // XXX.l #xx:32, ERd
+					struct RegRef32 Rd = getRegRef32(bL);
+						switch(bH){ 
+							case 0x0:{ // MOV.l #xx:32, ERd
+								setFlagsMOV(cdef, 32);
+								*Rd.ptr = cdef;
+								printInstruction("%04x - MOV.l 0x%04x, ER%d\n", pc, cdef,  Rd.idx); 
+							}break;
+							case 0x1:{ // ADD.l #xx:32, ERd
+								setFlagsADD(*Rd.ptr, cdef, 32);
+								*Rd.ptr += cdef;
+								printInstruction("%04x - ADD.l 0x%04x, ER%d\n", pc, cdef,  Rd.idx); 
+							}break;
+							case 0x2:{
+								// CMP.l #xx:32, ERd
+								setFlagsSUB(*Rd.ptr, cdef, 32);
+								printInstruction("%04x - CMP.l 0x%04x, ER%d\n", pc, cdef,  Rd.idx); 
+							}break;
+							case 0x3:{ // SUB.l #xx:32, ERd
+								setFlagsSUB(*Rd.ptr, cdef, 32);
+								*Rd.ptr -= cdef;
+								printInstruction("%04x - SUB.l 0x%04x, ER%d\n", pc, cdef,  Rd.idx); 
+							}break;
+							case 0x4:{ // OR.l #xx:32, ERd
+								uint32_t newValue = cdef | *Rd.ptr;
+								setFlagsMOV(newValue, 32);
+								*Rd.ptr = newValue;
+								printInstruction("%04x - OR.l 0x%04x, ER%d\n", pc, cdef,  Rd.idx); 
+							}break;
+							case 0x5:{ // XOR.l #xx:32, ERd
+								uint32_t newValue = cdef ^ *Rd.ptr;
+								setFlagsMOV(newValue, 32);
+								*Rd.ptr = newValue;
+								printInstruction("%04x - XOR.l 0x%04x, ER%d\n", pc, cdef,  Rd.idx); 
+							}break;
+							case 0x6:{ // AND.l #xx:32, ERd
+								uint32_t newValue = cdef & *Rd.ptr;
+								setFlagsMOV(newValue, 32);
+								*Rd.ptr = newValue;
+								printInstruction("%04x - AND.l 0x%04x, ER%d\n", pc, cdef,  Rd.idx); 
+							}break;
+							default:{
+								return 1;
+							} break;
+						}
+						printRegistersState();
+						pc+=4;
+					}break;
+					case 0xB:{ // EEPMOV.B (7B5C598F) / EEPMOV.W (7BD4598F): copies R4L / R4 bytes from @ER5+ to @ER6+
+						bool word = b == 0xD4;
+						uint16_t count = word ? *R[4] : *RL[4];
+						for(uint16_t i = 0; i < count; i++){
+							setMemory8(*ER[6], getMemory8(*ER[5]));
+							*ER[5] += 1;
+							*ER[6] += 1;
+						}
+						if (word){
+							*R[4] = 0;
+						}
+						else{
+							*RL[4] = 0;
+						}
+						printInstruction("%04x - EEPMOV.%c %d bytes\n", pc, word ? 'w' : 'b', count);
+						cyclesEllapsed += 4 * count;
+						printRegistersState();
+						pc+=2;
+					}break;
+					case 0xC:{
+						uint8_t mostSignificantBit = dH >> 7;
+						switch(c){
+							case 0x77:{
+								// BLD #xx:3, @ERd
+								struct RegRef32 Rd = getRegRef32(bH);		
+								int bitToLoad = dH;
+								printInstruction("%04x - BLD #%d, @ER%d\n", pc, bitToLoad, Rd.idx);
+								flags.C = getMemory8(*Rd.ptr) & (1 << bitToLoad);
+								printRegistersState();
+								pc+=2;
+
+							}break;
+							default:{
+								return 1;
+							} break;
+
+						}
+					} break;
+					case 0xE:{
+						if (cH == 0x6){
+							switch(cL){
+								case 0x3:{
+									printInstruction("%04x - BTST\n", pc);
+									return 1; // UNIMPLEMENTED
+								}break;
+								default:{
+									return 1;
+								} break;
+							}
+						}else if (cH == 0x7){
+							uint8_t mostSignificantBit = dH >> 7;
+							switch(cL){
+								case 0x3:{
+									printInstruction("%04x - BTST\n", pc);
+									return 1; // UNIMPLEMENTED
+								}break;
+								case 0x4:{
+									if (mostSignificantBit == 0x1){
+										printInstruction("%04x - BIOR\n", pc);
+										return 1; // UNIMPLEMENTED
+									}else{
+										printInstruction("%04x - BOR\n", pc);
+										return 1; // UNIMPLEMENTED
+									}
+								}break;
+								case 0x5:{
+									if (mostSignificantBit == 0x1){
+										printInstruction("%04x - BXOR\n", pc);
+										return 1; // UNIMPLEMENTED
+									}else{
+										printInstruction("%04x - BIXOR\n", pc);
+										return 1; // UNIMPLEMENTED
+									}
+								}break;
+								case 0x6:{
+									if (mostSignificantBit == 0x1){
+										printInstruction("%04x - BIAND\n", pc);
+										return 1; // UNIMPLEMENTED
+									}else{
+										printInstruction("%04x - BAND\n", pc);
+										return 1; // UNIMPLEMENTED
+									}
+								}break;
+								case 0x7:{
+									if (mostSignificantBit == 0x1){
+										printInstruction("%04x - BILD\n", pc);
+									}else{ // BLD #xx:3, @ERd
+										int bitToLoad = dH;
+										uint32_t address = (0x0000FF00) | b;
+										printInstruction("%04x - BLD #%d, @0x%x:8\n", pc, bitToLoad, address);
+										flags.C =  getMemory8(address) & (1 << bitToLoad);
+									}
+								}break;
+								default:{
+									return 1;
+								} break;
+							}
+
+
+						}
+						pc+=2; 
+					}break;
+					case 0xD:{
+					struct RegRef32 Rd = getRegRef32(bH);		
+						switch(c){
+							case 0x70:{ // BSET #xx:3, @ERd
+								int bitToSet = dH;
+								printInstruction("%04x - BSET #%d, @ER%d\n", pc, bitToSet, Rd.idx);
+								setMemory8(*Rd.ptr, getMemory8(*Rd.ptr) | (1 << bitToSet));
+							}break;
+							case 0x60:{ // BSET Rn, @ERd
+								struct RegRef8 Rn = getRegRef8(dH);		
+								int bitToSet = *Rn.ptr;
+								printInstruction("%04x - BSET r%d%c, @ER%d\n", pc, Rn.idx, Rn.loOrHiReg, Rd.idx);
+								setMemory8(*Rd.ptr, getMemory8(*Rd.ptr) | (1 << bitToSet));
+							}break;
+							case 0x71:{ // BNOT #xx:3, @ERd
+								int bitToInvert = dH;
+								bool bitValue = getMemory8(*Rd.ptr) & bitToInvert;
+								if (bitValue == 1){
+									setMemory8(*Rd.ptr, getMemory8(*Rd.ptr) & ~(1 << bitToInvert));
+								} else{
+									setMemory8(*Rd.ptr, getMemory8(*Rd.ptr) | (1 << bitToInvert));
+								}
+								printInstruction("%04x - BNOT #%d, @ER%d\n", pc, bitToInvert, Rd.idx);
+							}break;
+							case 0x72:{ // BCLR #xx:3, @ERd
+								int bitToClear = dH;
+								printInstruction("%04x - BCLR #%d, @ER%d\n", pc, bitToClear, Rd.idx);
+								setMemory8(*Rd.ptr, getMemory8(*Rd.ptr) & ~(1 << bitToClear));
+							}break;
+							case 0x62:{ // BCLR Rn, @ERd
+								struct RegRef8 Rn = getRegRef8(dH);		
+								int bitToClear = *Rn.ptr;
+								printInstruction("%04x - BCLR r%d%c, @ER%d\n", pc, Rn.idx, Rn.loOrHiReg, Rd.idx);
+								setMemory8(*Rd.ptr, getMemory8(*Rd.ptr) & ~(1 << bitToClear));
+							}break;
+							case 0x67:{ // BST ##xx:3, @ERd
+								int bitToSet = dH;
+								if (flags.C == 0){
+									setMemory8(*Rd.ptr, getMemory8(*Rd.ptr) & ~(1 << bitToSet));
+								} else{
+								setMemory8(*Rd.ptr, getMemory8(*Rd.ptr) | (1 << bitToSet));
+								}
+								printInstruction("%04x - BST #%d, @ER%d\n", pc, bitToSet, Rd.idx);
+							}break;
+							default:{
+								return 1;
+							} break;
+						}
+						printMemory(*Rd.ptr, 1);
+						printRegistersState();
+						pc+=2;
+					}break;
+					case 0xF:{
+						uint32_t address = (0x0000FF00) | b;
+						switch(c){
+							case 0x70:{ // BSET #xx:3, @aa:8
+								int bitToSet = dH;
+								printInstruction("%04x - BSET #%d, @0x%x:8\n", pc, bitToSet, address);
+								setMemory8(address, getMemory8(address) | (1 << bitToSet));
+							}break;
+							case 0x60:{ // BSET Rn, @aa:8
+								struct RegRef8 Rn = getRegRef8(dH);		
+								int bitToSet = *Rn.ptr;
+								printInstruction("%04x - BSET r%d%c, @0x%x:8\n", pc, Rn.idx, Rn.loOrHiReg, address);
+								setMemory8(address, getMemory8(address) | (1 << bitToSet));
+							}break;
+							case 0x72:{ // BCLR #xx:3, @aa:8
+								int bitToClear = dH;
+								printInstruction("%04x - BCLR #%d, @0x%x:8\n", pc, bitToClear, address);
+								setMemory8(address, getMemory8(address) & ~(1 << bitToClear));
+							}break;
+							case 0x62:{ // BCLR Rn, @aa:8
+								struct RegRef8 Rn = getRegRef8(dH);		
+								int bitToClear = *Rn.ptr;
+								printInstruction("%04x - BCLR r%d%c, @0x%x:8\n", pc, Rn.idx, Rn.loOrHiReg, address);
+								setMemory8(address, getMemory8(address) & ~(1 << bitToClear));
+
+							}break;
+							case 0x67:{ // BST - Unused in the ROM
+								return 1;
+							} break;
+							default:{
+								return 1;
+							} break;
+						}
+						printMemory(address, 1);
+						pc+=2;
+					} break;
+					default:{
+						return 1;
+					} break;
+				}
+			}break;
+			case 0x8:{ // ADD.B #xx:8, Rd
+				struct RegRef8 Rd = getRegRef8(aL);
+
+				uint8_t value = (bH << 4) | bL;
+
+				setFlagsADD(*Rd.ptr, value, 8);
+				*Rd.ptr += value;
+
+				printInstruction("%04x - ADD.b 0x%x,R%d%c\n", pc, value, Rd.idx, Rd.loOrHiReg); //Note: Dmitry's dissasembler sometimes outputs address in decimal (0xdd) not sure why
+				printRegistersState();
+			}break;
+			case 0x9:{
+				printInstruction("%04x - ADDX\n", pc);
+				return 1; // UNIMPLEMENTED
+			}break;
+
+			case 0xA:{ // CMP.B #xx:8, Rd
+				struct RegRef8 Rd = getRegRef8(aL);
+
+				uint8_t value = (bH << 4) | bL;
+
+				setFlagsSUB(*Rd.ptr, value, 8);
+
+				printInstruction("%04x - CMP.b 0x%x,R%d%c\n", pc, value, Rd.idx, Rd.loOrHiReg); 
+				printRegistersState();
+
+			}break;
+
+			case 0xB:{
+				printInstruction("%04x - SUBX\n", pc);
+				return 1; // UNIMPLEMENTED
+			}break;
+
+			case 0xC:{ // OR.b #xx:8, Rd
+				struct RegRef8 Rd = getRegRef8(aL);
+
+				uint8_t value = b;
+				uint8_t newValue = value | *Rd.ptr;
+				setFlagsMOV(newValue, 8);
+				*Rd.ptr = newValue;
+
+				printInstruction("%04x - OR.b 0x%x,R%d%c\n", pc, value, Rd.idx, Rd.loOrHiReg); 
+				printRegistersState();
+			}break;
+
+			case 0xD:{ // XOR.b #xx:8, Rd
+				struct RegRef8 Rd = getRegRef8(aL);
+
+				uint8_t value = b;
+				uint8_t newValue = value ^ *Rd.ptr;
+				setFlagsMOV(newValue, 8);
+				*Rd.ptr = newValue;
+
+				printInstruction("%04x - XOR.b 0x%x,R%d%c\n", pc, value, Rd.idx, Rd.loOrHiReg); 
+				printRegistersState();
+			}break;
+
+			case 0xE:{ // AND #xx:8, Rd
+				struct RegRef8 Rd = getRegRef8(aL);
+
+				uint8_t value = b;
+				uint8_t newValue = value & *Rd.ptr;
+				setFlagsMOV(newValue, 8);
+				*Rd.ptr = newValue;
+
+				printInstruction("%04x - AND.b 0x%x,R%d%c\n", pc, value, Rd.idx, Rd.loOrHiReg); 
+				printRegistersState();
+			}break;
+
+			case 0xF:{ // MOV.B #xx:8, Rd
+				struct RegRef8 Rd = getRegRef8(aL);
+
+				uint8_t value = b;
+
+				setFlagsMOV(value, 8);
+				*Rd.ptr = value;
+
+				printInstruction("%04x - MOV.b 0x%x,R%d%c\n", pc, value, Rd.idx, Rd.loOrHiReg); 
+				printRegistersState();
+			}break;
+
+			default:{
+				printInstruction("???\n");
+				return 1; // UNIMPLEMENTED
+			} break;
+		}
+
+		pc+=2;
+
+	}
+	// Interrupt handling
+	if (pendingInterrupts){
+		takePendingInterrupt();
+		cyclesEllapsed += INTERRUPT_ENTRY_CYCLES;
+	}
+
+	// Clock handling
+	return advanceClock(cycleCount, cyclesEllapsed);
+}
+
+#if INSTRUMENTED
+#undef setMemory8
+#undef setMemory16
+#undef setMemory32
+#undef getMemory8
+#undef getMemory16
+#undef getMemory32
+#else
+#undef printInstruction
+#undef printRegistersState
+#undef printMemory
+#endif
+#undef CORE_ASSERT
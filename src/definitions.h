@@ -1,6 +1,8 @@
 #pragma once
 #include <stdint.h>
 
+#include "ssuBus.h"
+
 #define STARTING_WATTS 50
 
 // Memory
@@ -8,7 +10,54 @@
 	// 0xF020 - 0xF0FF - MMIO
 	// 0xF780 - 0xFF7F - RAM 
 	// 0xFF80 - 0xFFFF - MMIO
-#define MEM_SIZE (64 * 1024)
+#define MEM_SIZE (64 * 1024) // Mirrored at 0x000000 and 0xFF0000 in the 24 bit address space
+#define ROM_SIZE 0xC000
+#define PAGE_SIZE 256
+#define RAM_START 0xF780
+#define RAM_END 0xFF80
+
+// Memory is big endian, the host is assumed to be little endian
+#ifdef _MSC_VER
+#include <stdlib.h>
+#include <intrin.h>
+#define byteSwap16(value) _byteswap_ushort(value)
+#define byteSwap32(value) _byteswap_ulong(value)
+static inline int countTrailingZeros(uint32_t value){
+	unsigned long index;
+	_BitScanForward(&index, value);
+	return index;
+}
+#else
+#define countTrailingZeros(value) __builtin_ctz(value)
+#define byteSwap16(value) __builtin_bswap16(value)
+#define byteSwap32(value) __builtin_bswap32(value)
+#endif
+
+// MMIO pages: reads and writes to registers with side effects go through a handler, everything else maps straight to memory
+struct MmioPage_t{
+	uint8_t (*read[PAGE_SIZE])(uint16_t address);
+	void (*write[PAGE_SIZE])(uint16_t address, uint8_t value);
+};
+
+// Hooks
+// Actions that run when the CPU reaches a ROM address, loaded from hooks.cfg
+#define MAX_HOOKS 64
+enum HOOK_TYPES{
+	HOOK_SKIP, // Don't execute 'value' bytes of code
+	HOOK_SET_REG8, // Set the 8 bit register 'target' (encoded like in instructions, bit 3 selects RnL) to 'value'
+	HOOK_INPUT, // Pop the next key from the input queue into address 'target'
+	HOOK_POKE8, // Write 'value' to address 'target'
+	HOOK_POKE16,
+	HOOK_BREAKPOINT, // Instrumented core only
+	HOOK_HLE, // Run hleRoutines['target'] instead of the routine starting at 'address' (see hle.c)
+	HOOK_MEMO, // Cache the results of the routine starting at 'address', memoRoutines['target'] (see memo.c)
+};
+struct Hook_t{
+	uint16_t address;
+	enum HOOK_TYPES type;
+	uint16_t target;
+	uint16_t value;
+};
 
 // Flags / CCR Condition Code Register
 struct Flags_t{
@@ -23,6 +72,7 @@ struct Flags_t{
 };	
 
 // Vector Table
+#define INTERRUPT_ENTRY_CYCLES 14 // Pushing pc and CCR, fetching the vector and refilling the prefetch
 #define VECTOR_TIMER_B1 0x06fa
 #define VECTOR_TIMER_W 0x3a4a
 #define VECTOR_IRQ0 0xa300
@@ -51,11 +101,20 @@ struct SSU_t{
 	uint8_t* SSRDR; // Recieve data register
 	uint8_t* SSTDR; // Transmit data register.
 	uint8_t SSTRSR; // Shift register.
-	uint8_t progress; // goes from 0 to 7
+	uint64_t completionCycle; // Value of cyclesRun at which the byte being shifted is done, SSU_IDLE if there's none
+	struct SsuDevice* devices[MAX_SSU_DEVICES];
+	int deviceCount;
+	struct SsuDevice* selectedDevice; // First attached device with its chip select low, NULL if none
 };
 #define RDRF (1 << 1) /* Recieve Data Register Full */
 #define TDRE (1 << 2) /* Transmit Data Register Empty */
 #define TEND (1 << 3) /* Transmit End */
+#define SSU_IDLE UINT64_MAX
+#define SSMR_CKS 0x07 /* Transfer clock select: 001 = φ/4, 010 = φ/8 ... 111 = φ/256 */
+#define SSER_ADDRESS 0xf0e3
+#define SSSR_ADDRESS 0xf0e4
+#define SSRDR_ADDRESS 0xf0e9
+#define SSTDR_ADDRESS 0xf0eb
 #define TE 0x80 /* Transmission Enabled */
 #define RE 0x40 /* Reception Enabled */
 
@@ -63,6 +122,10 @@ struct SSU_t{
 static const size_t EEPROM_SIZE = 64 * 1024;
 const static int EEPROM_PAGE_SIZE = 128;
 #define EEPROM_PIN 0x4
+#define EEPROM_WRITE 0x2
+#define EEPROM_READ 0x3
+#define EEPROM_RDSR 0x5 /* Read status register */
+#define EEPROM_WREN 0x6 /* Write enable */
 enum EEPROM_STATES{
 	EEPROM_EMPTY,
 	EEPROM_GETTING_STATUS_REGISTER,
@@ -77,12 +140,14 @@ struct Eeprom_t{
 		uint8_t hiAddress;
 		uint8_t loAddress;
 		enum EEPROM_STATES state;
+		uint8_t command; // EEPROM_READ or EEPROM_WRITE, tells what to do once the address is in
 		uint16_t offset;
 	} buffer;
 };
 
 // Accelerometer
 #define ACCEL_PIN 0x1
+#define ACCEL_MEM_SIZE 29
 enum ACCEL_STATES{
 	ACCEL_GETTING_ADDRESS,
 	ACCEL_GETTING_BYTES,
@@ -92,6 +157,7 @@ struct Accelerometer_t{
 	struct accelBuffer_t{
 		uint8_t address;
 		uint8_t offset;
+		bool reading; // RW flag of the address byte
 		enum ACCEL_STATES state;
 	} buffer;
 };
@@ -104,9 +170,14 @@ struct Accelerometer_t{
 #define LCD_MEM_WIDTH 128 // TODO: figure out way to traverse the memory without needing to simulate the bigger RAM size
 #define LCD_MEM_HEIGHT 176
 static const int LCD_MEM_SIZE = LCD_MEM_WIDTH * LCD_MEM_HEIGHT / 4; // /4 cuz in 2B we get 8px ( 4px per byte)
+#define LCD_PAGE_SIZE (LCD_WIDTH * LCD_BYTES_PER_STRIPE)
+#define LCD_PAGES (LCD_HEIGHT / 8) // Per buffer
+#define LCD_MEM_PAGES 18 // Highest data write: page 15, column 255 (the column counter wraps at 8 bits)
+#define LCD_DIRTY_SPAN 16 // Columns per dirty bit, the width the decoder handles in one step
 enum LCD_STATES{
 	LCD_EMPTY,
 	LCD_READING_CONTRAST,
+	LCD_READING_START_LINE,
 };
 struct Lcd_t{
 	uint8_t* memory;
@@ -115,12 +186,18 @@ struct Lcd_t{
 	uint8_t currentColumn;
 	uint8_t currentPage;
 	uint8_t currentByte;
-	bool currentBuffer;
+	bool currentBuffer; // Buffer on screen: picked by the display start line, or alternating every quarter second until the ROM sets one
+	bool startLineSet;
+	uint8_t startLine;
+	uint8_t dirtySpans[LCD_MEM_PAGES]; // Bit n set -> columns n*LCD_DIRTY_SPAN... of the page were written since they were last decoded
+	bool changed; // Data was written since the last fillVideoBuffer/fillVideoBufferDirty
+	uint32_t framesCompleted;
 };
 
 // Timers
 #define TMB_AUTORELOAD (1<<7)
 #define TMB_COUNTING (1<<6)
+#define TLB1_ADDRESS 0xf0d1 /* Reads TCB1, writes TLB1 */
 struct TimerB_t{
 	bool on;
 	uint8_t TLBvalue;
@@ -146,6 +223,19 @@ struct TimerW_t{
 #define TCNT_ADDRESS 0xf0f6
 
 // Interrupts
+// Interrupt sources the core takes, lowest bit first
+enum INTERRUPT_SOURCES{
+	INTERRUPT_IRQ0,
+	INTERRUPT_RTC_QUARTER_SEC,
+	INTERRUPT_RTC_HALF_SEC,
+	INTERRUPT_RTC_EVERY_SEC,
+	INTERRUPT_TIMER_B1,
+};
+#define IENR1_ADDRESS 0xfff3
+#define IENR2_ADDRESS 0xfff4
+#define IRR1_ADDRESS 0xfff6
+#define IRR2_ADDRESS 0xfff7
+#define RTCFLG_ADDRESS 0xf067
 // IRQ_IENR1; // Interrupt enable register 1
 #define IEN0 (1<<0)
 #define IENRTC (1<<7)
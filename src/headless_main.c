@@ -0,0 +1,215 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <signal.h>
+
+#include "walker.h"
+#include "capture.h"
+#include "sharedFrame.h"
+
+// Runs the walker without any window for batch jobs and CI.
+// Time is driven by the emulated cycle count: every quarter second worth of cycles fires the RTC interrupt,
+// the wall clock is only used to slow things down when a speed is given.
+
+#define TICKS_PER_SEC 4 /* RTC/4 */
+#define CYCLES_PER_TICK (SYSTEM_CLOCK_CYCLES_PER_SECOND/TICKS_PER_SEC)
+
+static struct Capture capture;
+static const char* recordPath;
+static struct SharedFrame* shared;
+static volatile sig_atomic_t quitting;
+
+static void printUsage(const char* program){
+	printf("Usage: %s [options]\n", program);
+	printf("  -rom PATH        ROM image (default rom.bin)\n");
+	printf("  -eeprom PATH     EEPROM image (default eeprom.bin), 'none' starts with a blank one\n");
+	printf("  -speed SPEED     'realtime', a multiplier like '4x' or 'uncapped' (default uncapped)\n");
+	printf("  -seconds N       Emulated seconds to run (default 60)\n");
+	printf("  -record FILE     Write every presented frame to a capture file, see captureExport\n");
+	printf("  -shm NAME        Publish the screen and CPU state in shared memory NAME (like /pokestroller), see shmReader\n");
+	printf("  -trace, -print, -validatehle, -profile   Same as the Windows frontend\n");
+}
+
+static double getSeconds(){
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+// Frame callback, also called every quarter second like the frontends present frames
+static void presentFrame(){
+	if (recordPath){
+		static uint8_t packed[CAPTURE_FRAME_SIZE];
+		fillVideoBufferFormat(packed, LCD_FORMAT_PACKED2BPP, LCD_WIDTH / 4);
+		captureFrame(&capture, packed, getCycleCount());
+	}
+	if (shared){
+		beginSharedWrite(shared);
+		if (fillVideoBufferDirty(shared->pixels)){ // Only the emulator writes the pixels, so they still hold the previous frame
+			shared->frameNumber += 1;
+		}
+		shared->cycle = getCycleCount();
+		getRegisters(shared->registers);
+		shared->pc = getPc();
+		shared->ccr = getFlags();
+		endSharedWrite(shared);
+	}
+}
+
+// SIGINT/SIGTERM end the run like -seconds does, so the capture gets closed and the shared memory removed
+static void onSignal(int signal){
+	(void)signal;
+	quitting = 1;
+}
+
+// Sleeps until the wall clock reaches 'deadline' (in getSeconds time)
+static void sleepUntil(double deadline){
+	struct timespec wakeUp;
+	wakeUp.tv_sec = (time_t)deadline;
+	wakeUp.tv_nsec = (long)((deadline - (double)wakeUp.tv_sec) * 1e9);
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wakeUp, NULL) == EINTR);
+}
+
+int main(int argc, char** argv){
+	const char* romPath = "rom.bin";
+	const char* eepromPath = "eeprom.bin";
+	double speed = 0; // Multiple of real time, 0 is uncapped
+	double seconds = 60;
+	const char* shmName = NULL;
+	bool tracing = false, printing = false, validatingHle = false, profiling = false;
+
+	for(int i = 1; i < argc; i++){
+		bool hasValue = i + 1 < argc;
+		if (strcmp(argv[i], "-rom") == 0 && hasValue){
+			romPath = argv[++i];
+		}
+		else if (strcmp(argv[i], "-eeprom") == 0 && hasValue){
+			eepromPath = argv[++i];
+			if (strcmp(eepromPath, "none") == 0){
+				eepromPath = NULL;
+			}
+		}
+		else if (strcmp(argv[i], "-speed") == 0 && hasValue){
+			const char* value = argv[++i];
+			if (strcmp(value, "realtime") == 0){
+				speed = 1;
+			}
+			else if (strcmp(value, "uncapped") == 0){
+				speed = 0;
+			}
+			else{
+				speed = atof(value); // "4x" -> 4
+				if (speed <= 0){
+					printf("Invalid speed %s\n", value);
+					return 1;
+				}
+			}
+		}
+		else if (strcmp(argv[i], "-seconds") == 0 && hasValue){
+			seconds = atof(argv[++i]);
+		}
+		else if (strcmp(argv[i], "-record") == 0 && hasValue){
+			recordPath = argv[++i];
+		}
+		else if (strcmp(argv[i], "-shm") == 0 && hasValue){
+			shmName = argv[++i];
+		}
+		else if (strcmp(argv[i], "-trace") == 0){
+			tracing = true;
+		}
+		else if (strcmp(argv[i], "-print") == 0){
+			printing = true;
+		}
+		else if (strcmp(argv[i], "-validatehle") == 0){
+			validatingHle = true;
+		}
+		else if (strcmp(argv[i], "-profile") == 0){
+			profiling = true;
+		}
+		else{
+			printUsage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (!initWalkerFromFiles(romPath, eepromPath)){
+		return 1;
+	}
+	if (tracing){
+		setInstrumentation(true);
+		setTracing(true);
+	}
+	if (printing){
+		setInstrumentation(true);
+		setPrintState(true);
+	}
+	if (validatingHle){
+		setInstrumentation(true);
+		setHleValidation(true);
+	}
+	if (profiling){
+		setInstrumentation(true);
+		setProfiling(true);
+	}
+	if (recordPath && !openCapture(&capture, recordPath, getLcdPalette())){
+		return 1;
+	}
+	if (shmName && !(shared = createSharedFrame(shmName, getLcdPalette()))){
+		return 1;
+	}
+	if (recordPath || shared){
+		setFrameCallback(presentFrame);
+	}
+	signal(SIGINT, onSignal);
+	signal(SIGTERM, onSignal);
+
+	uint64_t ticksToRun = (uint64_t)(seconds * TICKS_PER_SEC);
+	uint64_t ticks = 0;
+	uint64_t cycleCount = 0;
+	bool error = false;
+	double startTime = getSeconds();
+	while (ticks < ticksToRun){
+		error = runNextInstruction(&cycleCount);
+		if (error){
+			break;
+		}
+		if (cycleCount >= CYCLES_PER_TICK){
+			cycleCount -= CYCLES_PER_TICK;
+			quarterRTCInterrupt();
+			ticks += 1;
+			if (quitting){
+				break;
+			}
+			if (recordPath || shared){
+				presentFrame();
+			}
+			if (speed > 0){
+				// Absolute deadlines so sleeping late doesn't add up
+				sleepUntil(startTime + ticks / (TICKS_PER_SEC * speed));
+			}
+		}
+	}
+	double elapsedTime = getSeconds() - startTime;
+	if (recordPath){
+		closeCapture(&capture, getCycleCount());
+		printf("Recorded %u distinct frames to %s\n", capture.header.count, recordPath);
+	}
+	if (shared){
+		removeSharedFrame(shared, shmName);
+	}
+
+	uint64_t cyclesRun = ticks * CYCLES_PER_TICK + cycleCount;
+	double emulatedSeconds = (double)cyclesRun / SYSTEM_CLOCK_CYCLES_PER_SECOND;
+	printf("%s after %.2f emulated seconds (%llu cycles) in %.2f s\n", error ? "Stopped on an error" : quitting ? "Interrupted" : "Done", emulatedSeconds, (unsigned long long)cyclesRun, elapsedTime);
+	if (elapsedTime > 0){
+		printf("%.2f emulated MHz, %.2fx real time\n", cyclesRun / elapsedTime / 1e6, emulatedSeconds / elapsedTime);
+	}
+	if (profiling){
+		dumpProfile("profile.txt");
+	}
+	return error ? 1 : 0;
+}
@@ -0,0 +1,255 @@
+// High level emulation of ROM routines. An "hle" hook on a routine's entry point runs a native
+// replacement instead of the ROM code, charges the cycles the ROM code would have taken and returns
+// to the caller. Included by walker.c.
+//
+// With setHleValidation(true) the replacement only runs on a copy of the machine state (RAM, registers
+// and the SSU devices, so the LCD doesn't get a blit twice), the ROM code runs as usual and once it returns both results get compared and printed. Use it to check the
+// register contract and tune the cycle costs of a replacement.
+
+// Native replacement: does the routine's work on the emulated state and returns the cycles it would take.
+// 'outputs' and 'clobbered' describe the register contract (bit n = ERn): validation compares every register
+// except the clobbered ones that aren't outputs, since the caller can't rely on what the ROM leaves in those.
+struct HleRoutine_t{
+	const char* name;
+	uint32_t (*run)();
+	uint8_t outputs;
+	uint8_t clobbered;
+};
+#define HLE_SCRATCH_REGISTERS 0x0F // ER0-ER3, not preserved across calls
+
+// Every byte the ROM moves through the SSU costs the transfer itself plus the polling loop around it
+#define HLE_SSU_BYTE_OVERHEAD 20 // mov.b to SSTDR, btst/beq on SSSR, mov.b from SSRDR
+#define HLE_CALL_OVERHEAD 40 // Chip select toggling, argument shuffling, rts
+
+#define HLE_DEAD_STACK 0x100 // Stack below SP is scratch once the routine returns, don't compare it
+
+static bool hleValidating;
+static struct HleValidation_t{
+	bool pending;
+	const struct HleRoutine_t* routine;
+	uint16_t returnAddress;
+	uint32_t stackPointer; // SP once the routine has returned
+	uint64_t startCycle;
+	uint32_t expectedCycles;
+	uint32_t expectedRegisters[8];
+	uint8_t expectedRam[RAM_END - RAM_START];
+} hleCheck;
+
+// What a replacement can change besides RAM and registers: the SSU and the devices behind it
+struct HleDeviceState_t{
+	uint8_t ssuRegisters[7];
+	struct SSU_t ssu;
+	struct Lcd_t lcd;
+	struct Eeprom_t eeprom;
+	struct Accelerometer_t accel;
+	uint8_t* lcdMemory;
+	uint8_t* eepromMemory;
+	uint8_t accelMemory[ACCEL_MEM_SIZE];
+};
+#define HLE_SSU_REGISTERS {SSU.SSCRH, SSU.SSCRL, SSU.SSMR, SSU.SSER, SSU.SSSR, SSU.SSRDR, SSU.SSTDR}
+
+// Copies to RAM straight into memory, anything else goes through setMemory8
+void hleCopyToMemory(uint16_t destination, const uint8_t* source, uint16_t length){
+	if (destination >= RAM_START && destination + length <= RAM_END){
+		memcpy(memory + destination, source, length);
+		touchWatchedRam(destination, length);
+		return;
+	}
+	for(uint16_t i = 0; i < length; i++){
+		setMemory8((uint16_t)(destination + i), source[i]);
+	}
+}
+
+// eepromRead(r0 = EEPROM address, r1 = destination, r2 = byte count)
+// Sends READ + 16 bit address to the EEPROM and then clocks in r2 bytes
+uint32_t hleEepromRead(){
+	uint16_t source = *R[0];
+	uint16_t destination = *R[1];
+	uint16_t length = *R[2];
+	if (source + length <= EEPROM_SIZE){
+		hleCopyToMemory(destination, eeprom.memory + source, length);
+	}
+	else{ // The EEPROM address counter wraps around
+		uint16_t firstPart = EEPROM_SIZE - source;
+		hleCopyToMemory(destination, eeprom.memory + source, firstPart);
+		hleCopyToMemory(destination + firstPart, eeprom.memory, length - firstPart);
+	}
+	return HLE_CALL_OVERHEAD + (3 + length) * (ssuByteCycles() + HLE_SSU_BYTE_OVERHEAD);
+}
+
+// memcpy(r0 = destination, r1 = source, r2 = byte count), returns the destination in r0
+uint32_t hleMemcpy(){
+	uint16_t destination = *R[0];
+	uint16_t source = *R[1];
+	uint16_t length = *R[2];
+	if (source >= RAM_START && source + length <= RAM_END && destination >= RAM_START && destination + length <= RAM_END){
+		memmove(memory + destination, memory + source, length);
+		touchWatchedRam(destination, length);
+	}
+	else{
+		for(uint16_t i = 0; i < length; i++){
+			setMemory8((uint16_t)(destination + i), getMemory8((uint16_t)(source + i)));
+		}
+	}
+	return HLE_CALL_OVERHEAD + length * 14; // mov.b @er1+, mov.b to @er0, adds, dec.w, bne
+}
+
+// memset(r0 = destination, r1l = value, r2 = byte count), returns the destination in r0
+uint32_t hleMemset(){
+	uint16_t destination = *R[0];
+	uint8_t value = *RL[1];
+	uint16_t length = *R[2];
+	if (destination >= RAM_START && destination + length <= RAM_END){
+		memset(memory + destination, value, length);
+		touchWatchedRam(destination, length);
+	}
+	else{
+		for(uint16_t i = 0; i < length; i++){
+			setMemory8((uint16_t)(destination + i), value);
+		}
+	}
+	return HLE_CALL_OVERHEAD + length * 10; // mov.b to @er0, adds, dec.w, bne
+}
+
+// lcdBlit(r0 = source, r1 = byte count). The page/column commands and the LCD chip select are set up
+// by the caller, this is just the loop pushing display data through SSTDR
+uint32_t hleLcdBlit(){
+	uint16_t source = *R[0];
+	uint16_t length = *R[1];
+	for(uint16_t i = 0; i < length; i++){
+		uint8_t data = getMemory8((uint16_t)(source + i));
+		*SSU.SSTDR = data;
+		if (SSU.selectedDevice){
+			SSU.selectedDevice->transfer(SSU.selectedDevice, data);
+		}
+	}
+	*SSU.SSSR |= TDRE | TEND;
+	SSU.completionCycle = SSU_IDLE; // A byte the ROM scheduled before the call has been overwritten by the blit, don't resend it
+	return HLE_CALL_OVERHEAD + length * (ssuByteCycles() + HLE_SSU_BYTE_OVERHEAD);
+}
+
+// The image decompressor isn't replaced: its input format isn't documented, so there's no contract to validate it against
+static const struct HleRoutine_t hleRoutines[] = {
+	{"eepromRead", hleEepromRead, 0, HLE_SCRATCH_REGISTERS},
+	{"memcpy", hleMemcpy, 1 << 0, HLE_SCRATCH_REGISTERS},
+	{"memset", hleMemset, 1 << 0, HLE_SCRATCH_REGISTERS},
+	{"lcdBlit", hleLcdBlit, 0, HLE_SCRATCH_REGISTERS},
+};
+
+int findHleRoutine(const char* name){
+	for(int i = 0; i < (int)(sizeof(hleRoutines)/sizeof(hleRoutines[0])); i++){
+		if (strcmp(hleRoutines[i].name, name) == 0){
+			return i;
+		}
+	}
+	return -1;
+}
+
+void setHleValidation(bool enabled){
+	hleValidating = enabled;
+	hleCheck.pending = false;
+}
+
+// Runs the replacement and returns to the caller. Returns the cycles to charge.
+uint32_t runHleRoutine(int routine){
+	uint32_t cycles = hleRoutines[routine].run();
+	pc = getMemory16(*SP);
+	*SP += 2;
+	return cycles;
+}
+
+void saveHleDevices(struct HleDeviceState_t* state){
+	uint8_t* registers[7] = HLE_SSU_REGISTERS;
+	for(int i = 0; i < 7; i++){
+		state->ssuRegisters[i] = *registers[i];
+	}
+	state->ssu = SSU;
+	state->lcd = lcd;
+	state->eeprom = eeprom;
+	state->accel = accel;
+	state->lcdMemory = malloc(LCD_MEM_SIZE);
+	memcpy(state->lcdMemory, lcd.memory, LCD_MEM_SIZE);
+	state->eepromMemory = malloc(EEPROM_SIZE);
+	memcpy(state->eepromMemory, eeprom.memory, EEPROM_SIZE);
+	memcpy(state->accelMemory, accel.memory, ACCEL_MEM_SIZE);
+}
+
+void restoreHleDevices(struct HleDeviceState_t* state){
+	uint8_t* registers[7] = HLE_SSU_REGISTERS;
+	for(int i = 0; i < 7; i++){
+		*registers[i] = state->ssuRegisters[i];
+	}
+	SSU = state->ssu;
+	lcd = state->lcd;
+	eeprom = state->eeprom;
+	accel = state->accel;
+	memcpy(lcd.memory, state->lcdMemory, LCD_MEM_SIZE);
+	free(state->lcdMemory);
+	memcpy(eeprom.memory, state->eepromMemory, EEPROM_SIZE);
+	free(state->eepromMemory);
+	memcpy(accel.memory, state->accelMemory, ACCEL_MEM_SIZE);
+}
+
+// Runs the replacement on the current state, keeps its results and puts the state back so the ROM code can run
+void startHleValidation(int routine){
+	if (hleCheck.pending){
+		return; // Already checking an outer routine
+	}
+	uint32_t registers[8];
+	getRegisters(registers);
+	uint8_t* ram = malloc(RAM_END - RAM_START);
+	memcpy(ram, memory + RAM_START, RAM_END - RAM_START);
+	struct HleDeviceState_t devices;
+	saveHleDevices(&devices);
+	void (*savedFrameCallback)() = frameCallback;
+	frameCallback = NULL; // A frame the replacement completes is the one the ROM code is about to send
+	uint16_t entry = pc;
+
+	hleCheck.routine = &hleRoutines[routine];
+	hleCheck.expectedCycles = runHleRoutine(routine);
+	hleCheck.returnAddress = pc;
+	hleCheck.stackPointer = *SP;
+	getRegisters(hleCheck.expectedRegisters);
+	memcpy(hleCheck.expectedRam, memory + RAM_START, RAM_END - RAM_START);
+
+	memcpy(memory + RAM_START, ram, RAM_END - RAM_START);
+	free(ram);
+	touchWatchedRam(RAM_START, RAM_END - RAM_START);
+	restoreHleDevices(&devices);
+	frameCallback = savedFrameCallback;
+	for(int i = 0; i < 8; i++){
+		*ER[i] = registers[i];
+	}
+	pc = entry;
+	hleCheck.startCycle = cyclesRun;
+	hleCheck.pending = true;
+}
+
+// Called by the instrumented core after every instruction while a validation is pending
+void checkHleValidation(){
+	if (pc != hleCheck.returnAddress || *SP != hleCheck.stackPointer){
+		return;
+	}
+	hleCheck.pending = false;
+	int differences = 0;
+	const char* name = hleCheck.routine->name;
+	uint8_t comparedRegisters = ~hleCheck.routine->clobbered | hleCheck.routine->outputs;
+	for(int i = 0; i < 8; i++){
+		if ((comparedRegisters & (1 << i)) && *ER[i] != hleCheck.expectedRegisters[i]){
+			printf("HLE %s: ER%d is %08x, expected %08x\n", name, i, *ER[i], hleCheck.expectedRegisters[i]);
+			differences += 1;
+		}
+	}
+	for(uint32_t address = RAM_START; address < RAM_END; address++){
+		if (address < hleCheck.stackPointer && address >= hleCheck.stackPointer - HLE_DEAD_STACK){
+			continue;
+		}
+		if (memory[address] != hleCheck.expectedRam[address - RAM_START]){
+			if (differences < 32){
+				printf("HLE %s: [%04x] is %02x, expected %02x\n", name, address, memory[address], hleCheck.expectedRam[address - RAM_START]);
+			}
+			differences += 1;
+		}
+	}
+	printf("HLE %s: %d differences, took %llu cycles, charged %u\n", name, differences, (unsigned long long)(cyclesRun - hleCheck.startCycle), hleCheck.expectedCycles);
+}
@@ -0,0 +1,154 @@
+#include <string.h>
+
+#include "lcdDecode.h"
+
+#if !defined(LCD_DECODE_SCALAR) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define LCD_DECODE_SSE2
+#include <emmintrin.h>
+#endif
+
+#define LCD_DECODE_CHUNK 256 // Columns decoded per pass, wider images take several
+
+void initLcdDecoder(struct LcdDecoder* decoder, const uint32_t palette[4]){
+	memcpy(decoder->palette, palette, sizeof(decoder->palette));
+	for(int entry = 0; entry < 256; entry++){
+		uint8_t highBits = entry >> 4;
+		uint8_t lowBits = entry & 0xF;
+		decoder->packed[entry] = 0;
+		for(int column = 0; column < 4; column++){
+			int paletteIdx = ((highBits >> column) & 1) << 1 | ((lowBits >> column) & 1);
+			uint32_t color = palette[paletteIdx];
+			decoder->pixels[entry][column] = color;
+			decoder->rgb565[entry][column] = ((color >> 8) & 0xF800) | ((color >> 5) & 0x07E0) | ((color >> 3) & 0x001F);
+			decoder->gray[entry][column] = color & 0xFF;
+			decoder->packed[entry] |= paletteIdx << (6 - 2*column);
+		}
+	}
+}
+
+int lcdFormatRowBytes(enum LcdPixelFormat format, int width){
+	switch(format){
+		case LCD_FORMAT_XRGB8888: return width * 4;
+		case LCD_FORMAT_RGB565: return width * 2;
+		case LCD_FORMAT_GRAY8: return width;
+		case LCD_FORMAT_PACKED2BPP: return (width + 3) / 4;
+	}
+	return 0;
+}
+
+// Turns every 4 columns of [firstColumn, lastColumn) into a table entry per row: entries[row][group].
+// Returns the first column it didn't cover (less than 4 left).
+//
+// With SSE2, 16 columns at a time: the bytes get split into a vector of first bytes and one of second bytes, then for
+// each row movemask collects the row's bit from all 16 columns (the top bit, so the vectors get doubled in place to
+// move the next row up).
+// The rest 4 columns at a time: the 4 first bytes and the 4 second bytes go in two words (column i in byte i), so
+// every row just shifts the words and pulls one bit out of each byte with a multiply.
+static int findEntries(const uint8_t* page, int firstColumn, int lastColumn, uint8_t entries[8][LCD_DECODE_CHUNK / 4]){
+	int x = firstColumn;
+#ifdef LCD_DECODE_SSE2
+	const __m128i lowBytes = _mm_set1_epi16(0x00FF);
+	for(; x + 16 <= lastColumn; x += 16){
+		__m128i pairs0 = _mm_loadu_si128((const __m128i*)(page + 2*x));
+		__m128i pairs1 = _mm_loadu_si128((const __m128i*)(page + 2*x + 16));
+		__m128i first = _mm_packus_epi16(_mm_and_si128(pairs0, lowBytes), _mm_and_si128(pairs1, lowBytes));
+		__m128i second = _mm_packus_epi16(_mm_srli_epi16(pairs0, 8), _mm_srli_epi16(pairs1, 8));
+		int group = (x - firstColumn) / 4;
+		for(int row = 7; row >= 0; row--){
+			int highBits = _mm_movemask_epi8(first);
+			int lowBits = _mm_movemask_epi8(second);
+			first = _mm_add_epi8(first, first);
+			second = _mm_add_epi8(second, second);
+			for(int i = 0; i < 4; i++){
+				entries[row][group + i] = ((highBits >> (4 * i)) & 0xF) << 4 | ((lowBits >> (4 * i)) & 0xF);
+			}
+		}
+	}
+#endif
+	for(; x + 4 <= lastColumn; x += 4){
+		const uint8_t* column = page + 2*x;
+		uint32_t first = column[0] | column[2] << 8 | column[4] << 16 | (uint32_t)column[6] << 24;
+		uint32_t second = column[1] | column[3] << 8 | column[5] << 16 | (uint32_t)column[7] << 24;
+		int group = (x - firstColumn) / 4;
+		for(int row = 0; row < 8; row++){
+			// Bit 0 of each byte, then the multiply moves byte i's bit to bit 28 + i
+			uint8_t highBits = (((first >> row) & 0x01010101) * 0x10204080) >> 28;
+			uint8_t lowBits = (((second >> row) & 0x01010101) * 0x10204080) >> 28;
+			entries[row][group] = highBits << 4 | lowBits;
+		}
+	}
+	return x;
+}
+
+#define STORE_ENTRIES(table, bytesPerGroup) \
+	for(int row = 0; row < 8; row++){ \
+		uint8_t* rowPixels = pixels + row * stride; \
+		for(int group = 0; group < groups; group++){ \
+			memcpy(rowPixels + (bytesPerGroup) * group, &decoder->table[entries[row][group]], bytesPerGroup); \
+		} \
+	}
+
+// 'pixels' points at row 0, column 'firstColumn'
+static void storeEntries(const struct LcdDecoder* decoder, uint8_t entries[8][LCD_DECODE_CHUNK / 4], int groups, enum LcdPixelFormat format, uint8_t* pixels, int stride){
+	switch(format){
+		case LCD_FORMAT_XRGB8888: STORE_ENTRIES(pixels, 16) break;
+		case LCD_FORMAT_RGB565: STORE_ENTRIES(rgb565, 8) break;
+		case LCD_FORMAT_GRAY8: STORE_ENTRIES(gray, 4) break;
+		case LCD_FORMAT_PACKED2BPP: STORE_ENTRIES(packed, 1) break;
+	}
+}
+
+// Pixel by pixel for the last few columns. 'pixels' points at row 0, column 0
+static void decodeLcdColumns(const struct LcdDecoder* decoder, const uint8_t* page, int firstColumn, int lastColumn, enum LcdPixelFormat format, uint8_t* pixels, int stride){
+	for(int row = 0; row < 8; row++){
+		uint8_t* rowPixels = pixels + row * stride;
+		for(int x = firstColumn; x < lastColumn; x++){
+			uint8_t firstBit = (page[2*x] >> row) & 1;
+			uint8_t secondBit = (page[2*x + 1] >> row) & 1;
+			uint8_t paletteIdx = firstBit << 1 | secondBit;
+			uint32_t color = decoder->palette[paletteIdx];
+			switch(format){
+				case LCD_FORMAT_XRGB8888:{
+					memcpy(rowPixels + 4 * x, &color, 4);
+				} break;
+				case LCD_FORMAT_RGB565:{
+					uint16_t rgb565 = ((color >> 8) & 0xF800) | ((color >> 5) & 0x07E0) | ((color >> 3) & 0x001F);
+					memcpy(rowPixels + 2 * x, &rgb565, 2);
+				} break;
+				case LCD_FORMAT_GRAY8:{
+					rowPixels[x] = color & 0xFF;
+				} break;
+				case LCD_FORMAT_PACKED2BPP:{
+					int shift = 6 - 2 * (x % 4);
+					rowPixels[x / 4] = (rowPixels[x / 4] & ~(3 << shift)) | paletteIdx << shift;
+				} break;
+			}
+		}
+	}
+}
+
+void decodeLcdPageFormat(const struct LcdDecoder* decoder, const uint8_t* page, int firstColumn, int lastColumn, enum LcdPixelFormat format, void* pixels, int stride){
+	uint8_t entries[8][LCD_DECODE_CHUNK / 4];
+	int x = firstColumn;
+	while (lastColumn - x >= 4){
+		int chunkEnd = lastColumn - x > LCD_DECODE_CHUNK ? x + LCD_DECODE_CHUNK : lastColumn;
+		int decoded = findEntries(page, x, chunkEnd, entries);
+		storeEntries(decoder, entries, (decoded - x) / 4, format, (uint8_t*)pixels + lcdFormatRowBytes(format, x), stride);
+		x = decoded;
+	}
+	decodeLcdColumns(decoder, page, x, lastColumn, format, pixels, stride);
+}
+
+void decodeLcdImageFormat(const struct LcdDecoder* decoder, const uint8_t* pages, int width, int height, enum LcdPixelFormat format, void* pixels, int stride){
+	for(int page = 0; page < height / 8; page++){
+		decodeLcdPageFormat(decoder, pages + page * width * 2, 0, width, format, (uint8_t*)pixels + page * 8 * stride, stride);
+	}
+}
+
+void decodeLcdPage(const struct LcdDecoder* decoder, const uint8_t* page, int firstColumn, int lastColumn, uint32_t* pixels, int stride){
+	decodeLcdPageFormat(decoder, page, firstColumn, lastColumn, LCD_FORMAT_XRGB8888, pixels, stride * 4);
+}
+
+void decodeLcdImage(const struct LcdDecoder* decoder, const uint8_t* pages, int width, int height, uint32_t* pixels, int stride){
+	decodeLcdImageFormat(decoder, pages, width, height, LCD_FORMAT_XRGB8888, pixels, stride * 4);
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <stdint.h>
+
+// Decoder for the LCD's 2 bit per pixel page format, the one the LCD RAM, LCD dumps and the images in the EEPROM use.
+// A page is 8 pixel rows tall and stores each column as 2 bytes: bit n of the first and second byte are the high and
+// low bit of the palette index of the pixel in row n. Pages follow each other, 'width' columns (2 * width bytes) apart.
+//
+// Decoding goes through lookup tables from 4 columns' worth of bits to 4 finished pixels, built once per palette.
+// With SSE2 a whole 16 column strip of a page gets transposed with movemask, one pixel row at a time.
+// Build with -DLCD_DECODE_SCALAR to use the plain C path only.
+
+enum LcdPixelFormat{
+	LCD_FORMAT_XRGB8888, // uint32_t palette colors (0x00RRGGBB), what fillVideoBuffer produces
+	LCD_FORMAT_RGB565, // uint16_t
+	LCD_FORMAT_GRAY8, // One byte per pixel, the palette color's blue channel (the palette is gray)
+	LCD_FORMAT_PACKED2BPP, // The palette index itself, 4 pixels per byte with the leftmost one in the top bits. 1.5KB per frame
+};
+
+struct LcdDecoder{
+	// [high bits of 4 columns << 4 | low bits of 4 columns] -> those 4 pixels, column 0 in bit 0
+	uint32_t pixels[256][4];
+	uint16_t rgb565[256][4];
+	uint8_t gray[256][4];
+	uint8_t packed[256];
+	uint32_t palette[4];
+};
+
+void initLcdDecoder(struct LcdDecoder* decoder, const uint32_t palette[4]); // The decoder is read-only afterwards, threads can share it
+int lcdFormatRowBytes(enum LcdPixelFormat format, int width); // Smallest stride for an image 'width' pixels wide
+// Decodes columns [firstColumn, lastColumn) of one page into 8 rows, 'stride' bytes apart. 'page' and 'pixels' point at column 0.
+// For LCD_FORMAT_PACKED2BPP firstColumn has to be a multiple of 4
+void decodeLcdPageFormat(const struct LcdDecoder* decoder, const uint8_t* page, int firstColumn, int lastColumn, enum LcdPixelFormat format, void* pixels, int stride);
+// Decodes height/8 pages into a row-major image with rows 'stride' bytes apart. height must be a multiple of 8
+void decodeLcdImageFormat(const struct LcdDecoder* decoder, const uint8_t* pages, int width, int height, enum LcdPixelFormat format, void* pixels, int stride);
+
+// LCD_FORMAT_XRGB8888 shorthands, 'stride' in pixels
+void decodeLcdPage(const struct LcdDecoder* decoder, const uint8_t* page, int firstColumn, int lastColumn, uint32_t* pixels, int stride);
+void decodeLcdImage(const struct LcdDecoder* decoder, const uint8_t* pages, int width, int height, uint32_t* pixels, int stride);
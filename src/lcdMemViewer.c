@@ -1,49 +1,346 @@
+#define _POSIX_C_SOURCE 200809L
 #include <stdint.h>
 #include <stdlib.h>
 #include <stdio.h>
-#include "src/walker.h"
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
 
-int main(int argc, char **argv){
-	FILE* input1;
-	FILE* input2;
-	input1 = fopen(argv[1], "rb");
-	input2 = fopen(argv[2], "rb");
-	uint8_t* lcdMemory1 = malloc(LCD_MEM_SIZE);
-	uint8_t* lcdMemory2 = malloc(LCD_MEM_SIZE);
-	fread(lcdMemory1, 1, LCD_MEM_SIZE, input1);
-	fread(lcdMemory2, 1, LCD_MEM_SIZE, input2);
-	for(int y = 0; y < LCD_HEIGHT; y++){
-		for(int i = 0; i < 2; i++){
-			uint8_t* memory = (i==0) ? lcdMemory1 : lcdMemory2;
-			for(int x = 0; x < LCD_WIDTH; x++){
-				int yOffsetStripe = y%8;
-				uint8_t firstByteForX = (memory[2*x + (y/8)*LCD_WIDTH*LCD_BYTES_PER_STRIPE] & (1<<yOffsetStripe)) >> yOffsetStripe;
-				uint8_t secondByteForX = (memory[2*x + (y/8)*LCD_WIDTH*LCD_BYTES_PER_STRIPE + 1] & (1<<yOffsetStripe)) >> yOffsetStripe;
-				int paletteIdx = firstByteForX + secondByteForX;
-				switch (paletteIdx) {
-					case 0:{
-						printf(" ");
-					} break;
-
-					case 1:{
-
-						printf("x");
-					} break;
-					case 2:{
-
-						printf("*");
-					} break;
-					case 3:{
-
-						printf("-");
-					} break;
+#include "walker.h"
+#include "definitions.h"
+#include "pngWriter.h"
+
+// Converts LCD memory dumps (LCD_MEM_SIZE bytes each, a copy of lcd.memory) to pictures, in bulk.
+// Usage: lcdMemViewer [options] dump...
+// A file can hold any number of dumps back to back, '-' reads such a stream from stdin.
+//   -format ascii|pgm|png   ascii (default) prints the frames side by side, the others write a file per distinct frame to -out
+//   -out DIR                Where the pgm/png files go (default .). They're named after the frame's hash (plus the index
+//                           of its first dump if two pictures share a hash), and index.txt lists which file every dump ended up in
+//   -buffer 0|1             LCD buffer to show (default 0)
+//   -columns N              ascii frames per row (default 2)
+//   -threads N              Decode and write on N threads (default: one per core)
+// Identical frames are only converted once. All threads share a single decoder, it's read-only once initialized.
+
+#define VIEWER_FRAME_SIZE (LCD_WIDTH / 4 * LCD_HEIGHT) // LCD_FORMAT_PACKED2BPP
+
+enum OUTPUT_FORMATS{
+	OUTPUT_ASCII,
+	OUTPUT_PGM,
+	OUTPUT_PNG,
+};
+
+struct Frame_t{
+	const uint8_t* dump;
+	const char* source; // File it came from
+	uint32_t indexInSource;
+	uint64_t hash;
+	uint32_t first; // Index of the first frame with the same picture, its own index if it's the first
+	bool hashShared; // Another picture has the same hash, the file name needs 'first' too
+	uint8_t packed[VIEWER_FRAME_SIZE];
+};
+
+enum STAGES{
+	STAGE_DECODE, // Every frame: packed pixels and hash
+	STAGE_WRITE, // First frame of every picture: the output file
+};
+
+struct Worker_t{
+	pthread_t thread;
+	int index;
+	enum STAGES stage;
+	bool failed;
+};
+
+static struct LcdDecoder decoder;
+static struct Frame_t* frames;
+static uint32_t frameCount;
+static int threadCount;
+static int bufferOffset;
+static enum OUTPUT_FORMATS outputFormat = OUTPUT_ASCII;
+static const char* outputDirectory = ".";
+
+// FNV-1a
+static uint64_t hashFrame(const uint8_t* data, size_t length){
+	uint64_t hash = 0xCBF29CE484222325ull;
+	for(size_t i = 0; i < length; i++){
+		hash = (hash ^ data[i]) * 0x100000001B3ull;
+	}
+	return hash;
+}
+
+static const char* frameExtension(){
+	return outputFormat == OUTPUT_PNG ? "png" : "pgm";
+}
+
+// 'frame' has to be the first one with its picture
+static void printFileName(const struct Frame_t* frame, char* name, size_t size){
+	if (frame->hashShared){
+		snprintf(name, size, "%016llx_%u.%s", (unsigned long long)frame->hash, frame->first, frameExtension());
+	}
+	else{
+		snprintf(name, size, "%016llx.%s", (unsigned long long)frame->hash, frameExtension());
+	}
+}
+
+static bool writeFrame(struct Frame_t* frame){
+	char name[64];
+	printFileName(frame, name, sizeof(name));
+	char fileName[1024];
+	snprintf(fileName, sizeof(fileName), "%s/%s", outputDirectory, name);
+	if (outputFormat == OUTPUT_PNG){
+		return writePng2bpp(fileName, frame->packed, LCD_WIDTH, LCD_HEIGHT, LCD_WIDTH / 4, decoder.palette);
+	}
+	uint8_t gray[LCD_WIDTH * LCD_HEIGHT];
+	decodeLcdImageFormat(&decoder, frame->dump + bufferOffset, LCD_WIDTH, LCD_HEIGHT, LCD_FORMAT_GRAY8, gray, LCD_WIDTH);
+	FILE* output = fopen(fileName, "wb");
+	if (!output){
+		printf("Can't open %s for writing\n", fileName);
+		return false;
+	}
+	fprintf(output, "P5\n%d %d\n255\n", LCD_WIDTH, LCD_HEIGHT);
+	fwrite(gray, 1, sizeof(gray), output);
+	return fclose(output) == 0;
+}
+
+// Frames are dealt round robin, they all cost about the same
+static void* runWorker(void* argument){
+	struct Worker_t* worker = argument;
+	for(uint32_t i = worker->index; i < frameCount; i += threadCount){
+		struct Frame_t* frame = &frames[i];
+		if (worker->stage == STAGE_DECODE){
+			decodeLcdImageFormat(&decoder, frame->dump + bufferOffset, LCD_WIDTH, LCD_HEIGHT, LCD_FORMAT_PACKED2BPP, frame->packed, LCD_WIDTH / 4);
+			frame->hash = hashFrame(frame->packed, VIEWER_FRAME_SIZE);
+		}
+		else if (frame->first == i && !writeFrame(frame)){
+			worker->failed = true;
+		}
+	}
+	return NULL;
+}
+
+static bool runStage(enum STAGES stage){
+	struct Worker_t* workers = calloc(threadCount, sizeof(struct Worker_t));
+	for(int i = 0; i < threadCount; i++){
+		workers[i].index = i;
+		workers[i].stage = stage;
+	}
+	for(int i = 1; i < threadCount; i++){
+		pthread_create(&workers[i].thread, NULL, runWorker, &workers[i]);
+	}
+	runWorker(&workers[0]);
+	bool failed = workers[0].failed;
+	for(int i = 1; i < threadCount; i++){
+		pthread_join(workers[i].thread, NULL);
+		failed |= workers[i].failed;
+	}
+	free(workers);
+	return !failed;
+}
+
+// Points every frame at the first one with the same picture. Returns the number of distinct pictures
+static uint32_t findDuplicates(){
+	uint32_t tableSize = 1;
+	while (tableSize < frameCount * 2){
+		tableSize <<= 1;
+	}
+	uint32_t* table = calloc(tableSize, sizeof(uint32_t)); // Frame index + 1, 0 is empty
+	uint32_t distinct = 0;
+	for(uint32_t i = 0; i < frameCount; i++){
+		uint32_t slot = frames[i].hash & (tableSize - 1);
+		frames[i].first = i;
+		frames[i].hashShared = false;
+		while (table[slot]){
+			struct Frame_t* other = &frames[table[slot] - 1];
+			if (other->hash == frames[i].hash){
+				if (memcmp(other->packed, frames[i].packed, VIEWER_FRAME_SIZE) == 0){
+					frames[i].first = table[slot] - 1;
+					break;
 				}
+				other->hashShared = frames[i].hashShared = true;
 			}
-			printf("        ");
+			slot = (slot + 1) & (tableSize - 1);
+		}
+		if (frames[i].first == i){
+			table[slot] = i + 1;
+			distinct += 1;
+		}
+	}
+	free(table);
+	return distinct;
+}
+
+static uint8_t* readWholeFile(const char* fileName, size_t* size){
+	FILE* input = strcmp(fileName, "-") == 0 ? stdin : fopen(fileName, "rb");
+	if (!input){
+		printf("Can't open %s\n", fileName);
+		return NULL;
+	}
+	size_t capacity = LCD_MEM_SIZE;
+	uint8_t* data = malloc(capacity);
+	*size = 0;
+	size_t count;
+	while ((count = fread(data + *size, 1, capacity - *size, input)) > 0){
+		*size += count;
+		if (*size == capacity){
+			capacity *= 2;
+			data = realloc(data, capacity);
+		}
+	}
+	if (input != stdin){
+		fclose(input);
+	}
+	return data;
+}
+
+static bool addDumps(const char* fileName){
+	size_t size;
+	uint8_t* data = readWholeFile(fileName, &size);
+	if (!data){
+		return false;
+	}
+	if (size == 0 || size % LCD_MEM_SIZE){
+		printf("%s is %zu bytes, not a whole number of %d byte LCD dumps\n", fileName, size, LCD_MEM_SIZE);
+		free(data);
+		return false;
+	}
+	uint32_t count = (uint32_t)(size / LCD_MEM_SIZE);
+	frames = realloc(frames, (frameCount + count) * sizeof(struct Frame_t));
+	for(uint32_t i = 0; i < count; i++){
+		frames[frameCount + i].dump = data + (size_t)i * LCD_MEM_SIZE;
+		frames[frameCount + i].source = fileName;
+		frames[frameCount + i].indexInSource = i;
+	}
+	frameCount += count;
+	return true;
+}
+
+static void printFrameName(const struct Frame_t* frame, char* name, size_t size){
+	if (frame->indexInSource || (frame + 1 < frames + frameCount && frame[1].source == frame->source)){
+		snprintf(name, size, "%s#%u", frame->source, frame->indexInSource);
+	}
+	else{
+		snprintf(name, size, "%s", frame->source);
+	}
+}
+
+// Distinct frames in input order, 'columns' side by side
+static void printAscii(int columns){
+	const char shades[4] = {' ', '.', '*', '#'}; // Lightest first, like the palette
+	uint32_t* shown = malloc(frameCount * sizeof(uint32_t));
+	uint32_t shownCount = 0;
+	for(uint32_t i = 0; i < frameCount; i++){
+		if (frames[i].first == i){
+			shown[shownCount++] = i;
+		}
+	}
+	for(uint32_t group = 0; group < shownCount; group += columns){
+		uint32_t groupEnd = group + columns < shownCount ? group + columns : shownCount;
+		for(uint32_t i = group; i < groupEnd; i++){
+			char name[LCD_WIDTH + 1];
+			printFrameName(&frames[shown[i]], name, sizeof(name));
+			printf("%-*s        ", LCD_WIDTH, name);
 		}
 		printf("\n");
+		for(int y = 0; y < LCD_HEIGHT; y++){
+			for(uint32_t i = group; i < groupEnd; i++){
+				const uint8_t* row = frames[shown[i]].packed + y * (LCD_WIDTH / 4);
+				for(int x = 0; x < LCD_WIDTH; x++){
+					putchar(shades[(row[x / 4] >> (6 - 2 * (x % 4))) & 3]);
+				}
+				printf("        ");
+			}
+			printf("\n");
+		}
+	}
+	free(shown);
+}
+
+static bool writeIndex(){
+	char fileName[1024];
+	snprintf(fileName, sizeof(fileName), "%s/index.txt", outputDirectory);
+	FILE* output = fopen(fileName, "w");
+	if (!output){
+		printf("Can't open %s for writing\n", fileName);
+		return false;
+	}
+	for(uint32_t i = 0; i < frameCount; i++){
+		char name[1024];
+		printFrameName(&frames[i], name, sizeof(name));
+		char fileName[64];
+		printFileName(&frames[frames[i].first], fileName, sizeof(fileName));
+		fprintf(output, "%s %s\n", name, fileName);
+	}
+	return fclose(output) == 0;
+}
+
+static void printUsage(const char* program){
+	printf("Usage: %s [-format ascii|pgm|png] [-out DIR] [-buffer 0|1] [-columns N] [-threads N] dump...\n", program);
+	printf("Every file can hold several %d byte dumps back to back, '-' reads them from stdin\n", LCD_MEM_SIZE);
+}
+
+int main(int argc, char **argv){
+	int columns = 2;
+	threadCount = (int)sysconf(_SC_NPROCESSORS_ONLN);
+	int i = 1;
+	for(; i < argc && argv[i][0] == '-' && argv[i][1]; i++){
+		bool hasValue = i + 1 < argc;
+		if (strcmp(argv[i], "-format") == 0 && hasValue){
+			const char* format = argv[++i];
+			if (strcmp(format, "ascii") == 0){
+				outputFormat = OUTPUT_ASCII;
+			}
+			else if (strcmp(format, "pgm") == 0){
+				outputFormat = OUTPUT_PGM;
+			}
+			else if (strcmp(format, "png") == 0){
+				outputFormat = OUTPUT_PNG;
+			}
+			else{
+				printf("Unknown format %s\n", format);
+				return 1;
+			}
+		}
+		else if (strcmp(argv[i], "-out") == 0 && hasValue){
+			outputDirectory = argv[++i];
+		}
+		else if (strcmp(argv[i], "-buffer") == 0 && hasValue){
+			bufferOffset = (atoi(argv[++i]) & 1) * LCD_WIDTH * LCD_BUFFER_SEPARATION;
+		}
+		else if (strcmp(argv[i], "-columns") == 0 && hasValue){
+			columns = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "-threads") == 0 && hasValue){
+			threadCount = atoi(argv[++i]);
+		}
+		else{
+			printUsage(argv[0]);
+			return 1;
+		}
+	}
+	if (i == argc){
+		printUsage(argv[0]);
+		return 1;
+	}
+	for(; i < argc; i++){
+		if (!addDumps(argv[i])){
+			return 1;
+		}
+	}
+	columns = columns < 1 ? 1 : columns;
+	threadCount = threadCount < 1 ? 1 : threadCount;
+	threadCount = (uint32_t)threadCount > frameCount ? (int)frameCount : threadCount;
+
+	initLcdDecoder(&decoder, palette);
+	initPngWriter();
+	runStage(STAGE_DECODE);
+	uint32_t distinct = findDuplicates();
+	if (outputFormat == OUTPUT_ASCII){
+		printAscii(columns);
+		return 0;
+	}
+	if (!runStage(STAGE_WRITE) || !writeIndex()){
+		return 1;
 	}
-	fclose(input1);
-	fclose(input2);
+	printf("%u dumps, %u distinct frames written to %s\n", frameCount, distinct, outputDirectory);
 	return 0;
 }
@@ -0,0 +1,295 @@
+// Result cache for pure ROM routines. Included by walker.c.
+//
+// A "memo" hook marks the routine at its address as a candidate. When it gets called with inputs that aren't
+// cached yet, it runs on the instrumented core, which records the RAM bytes it reads before writing them
+// (its read set) and the RAM it leaves modified. The next call with the same registers and the same values
+// in the read set skips the routine: the recorded writes, registers, flags and cycles get applied and it
+// returns to its caller.
+// While memoization is on, writes to RAM bump a generation counter per page, so a hit only has to compare
+// the read set against memory when one of the pages it covers has been written since the last check.
+// A routine that touches MMIO, sleeps or doesn't fit in the buffers is marked impure and runs normally from
+// then on. A call that gets interrupted just isn't cached.
+
+#define MEMO_MAX_ROUTINES 8
+#define MEMO_MAX_ENTRIES 32 // Per routine, the oldest gets replaced
+#define MEMO_MAX_READS 256
+#define MEMO_MAX_WRITES 256
+#define MEMO_MAX_CYCLES 1000000 // Longer calls aren't worth caching
+#define MEMO_FIRST_PAGE (RAM_START >> 8)
+#define MEMO_PAGE_COUNT (((RAM_END - 1) >> 8) - MEMO_FIRST_PAGE + 1)
+
+struct MemoByte_t{
+	uint16_t address;
+	uint8_t value;
+};
+
+struct MemoEntry_t{
+	bool valid;
+	uint32_t inputRegisters[8];
+	uint8_t inputFlags;
+	uint32_t outputRegisters[8];
+	uint8_t outputFlags;
+	uint32_t cycles;
+	uint16_t readCount;
+	uint16_t writeCount;
+	struct MemoByte_t reads[MEMO_MAX_READS];
+	struct MemoByte_t writes[MEMO_MAX_WRITES];
+	uint16_t pages; // Bit n set -> the read set has bytes in page MEMO_FIRST_PAGE + n
+	uint32_t pageGenerations[MEMO_PAGE_COUNT]; // memoPageGenerations when the read set was last checked
+};
+
+struct MemoRoutine_t{
+	uint16_t address;
+	bool impure;
+	int nextEntry;
+	uint32_t hits;
+	uint32_t misses;
+	struct MemoEntry_t entries[MEMO_MAX_ENTRIES];
+};
+
+static struct MemoRoutine_t memoRoutines[MEMO_MAX_ROUTINES];
+static int memoRoutineCount;
+static uint32_t memoPageGenerations[MEMO_PAGE_COUNT];
+
+static struct MemoRecording_t{
+	bool active;
+	const char* failure; // Why the routine isn't pure, NULL while it looks fine
+	bool aborted; // Nothing wrong with the routine, this call just can't be cached
+	struct MemoRoutine_t* routine;
+	struct MemoEntry_t entry;
+	uint32_t entryStackPointer;
+	uint32_t lowestStackPointer;
+	uint16_t returnAddress;
+	uint64_t startCycle;
+	uint32_t startInterrupts;
+	uint8_t read[(RAM_END - RAM_START) / 8]; // One bit per RAM byte
+	uint8_t written[(RAM_END - RAM_START) / 8];
+	int (*previousCore)(uint64_t* cycleCount);
+} memoRecording;
+
+int runInstrumentedInstruction(uint64_t* cycleCount);
+
+// Maps an address to its offset in RAM, -1 for ROM (constant, not worth recording) and -2 for anything else
+int memoRamOffset(uint32_t address){
+	address &= ADDRESS_MASK;
+	if ((address >> 16) != 0 && (address >> 16) != 0xFF){
+		return -2;
+	}
+	address &= 0xFFFF;
+	if (address < ROM_SIZE){
+		return -1;
+	}
+	if (address < RAM_START || address >= RAM_END){
+		return -2;
+	}
+	return address - RAM_START;
+}
+
+void writeWatchedRam(uint16_t address, uint8_t value){
+	memory[address] = value;
+	memoPageGenerations[((address & 0xFFFF) >> 8) - MEMO_FIRST_PAGE] += 1;
+}
+
+// For code writing RAM straight through 'memory' (HLE routines): bumps the pages covering [address, address + length)
+void touchWatchedRam(uint16_t address, uint16_t length){
+	if (length == 0){
+		return;
+	}
+	for(uint32_t page = address >> 8; page <= ((uint32_t)address + length - 1) >> 8; page++){
+		memoPageGenerations[page - MEMO_FIRST_PAGE] += 1;
+	}
+}
+
+// Routes every RAM write through writeWatchedRam. Needs to run after initWalker has set up the MMIO pages.
+void watchRamPages(){
+	if (mmioPages[2].write[0] == writeWatchedRam){
+		return; // Already watching
+	}
+	uint32_t mirrors[3] = {0, MEM_SIZE, ADDRESS_SPACE_SIZE - MEM_SIZE};
+	for(uint32_t address = RAM_START; address < RAM_END; address += PAGE_SIZE){
+		for(int i = 0; i < 3; i++){
+			if (!pageMmio[(mirrors[i] + address) >> 8]){
+				pageMmio[(mirrors[i] + address) >> 8] = 3;
+			}
+		}
+	}
+	for(int i = 0; i < PAGE_SIZE; i++){
+		mmioPages[2].write[i] = writeWatchedRam;
+	}
+	for(uint32_t address = RAM_END & 0xFF00; address < RAM_END; address++){ // RAM sharing its page with MMIO registers
+		setMmioHandlers(address, NULL, writeWatchedRam);
+	}
+}
+
+int addMemoRoutine(uint16_t address){
+	if (memoRoutineCount == MEMO_MAX_ROUTINES){
+		return -1;
+	}
+	struct MemoRoutine_t* routine = &memoRoutines[memoRoutineCount];
+	memset(routine, 0, sizeof(*routine));
+	routine->address = address;
+	return memoRoutineCount++;
+}
+
+bool memoReadSetMatches(struct MemoEntry_t* entry){
+	bool stale = false;
+	for(int i = 0; i < MEMO_PAGE_COUNT; i++){
+		if ((entry->pages & (1 << i)) && entry->pageGenerations[i] != memoPageGenerations[i]){
+			stale = true;
+		}
+	}
+	if (!stale){
+		return true;
+	}
+	for(int i = 0; i < entry->readCount; i++){
+		if (memory[entry->reads[i].address] != entry->reads[i].value){
+			entry->valid = false; // Something it depends on changed, it can't hit again
+			return false;
+		}
+	}
+	memcpy(entry->pageGenerations, memoPageGenerations, sizeof(memoPageGenerations));
+	return true;
+}
+
+// Applies a cached result and returns to the caller. Returns false on a miss.
+bool memoLookup(struct MemoRoutine_t* routine, uint32_t* cycles){
+	uint32_t registers[8];
+	getRegisters(registers);
+	uint8_t ccr = getFlags();
+	for(int i = 0; i < MEMO_MAX_ENTRIES; i++){
+		struct MemoEntry_t* entry = &routine->entries[i];
+		if (!entry->valid || entry->inputFlags != ccr || memcmp(entry->inputRegisters, registers, sizeof(registers)) != 0){
+			continue;
+		}
+		if (!memoReadSetMatches(entry)){
+			continue;
+		}
+		uint16_t returnAddress = getMemory16(*SP);
+		for(int w = 0; w < entry->writeCount; w++){
+			memory[entry->writes[w].address] = entry->writes[w].value;
+			memoPageGenerations[(entry->writes[w].address >> 8) - MEMO_FIRST_PAGE] += 1;
+		}
+		for(int r = 0; r < 8; r++){
+			*ER[r] = entry->outputRegisters[r];
+		}
+		setFlags(entry->outputFlags);
+		pc = returnAddress;
+		*cycles += entry->cycles;
+		routine->hits += 1;
+		return true;
+	}
+	return false;
+}
+
+// Switches to the instrumented core until the routine returns
+void startMemoRecording(struct MemoRoutine_t* routine){
+	memoRecording.active = true;
+	memoRecording.failure = NULL;
+	memoRecording.aborted = false;
+	memoRecording.routine = routine;
+	getRegisters(memoRecording.entry.inputRegisters);
+	memoRecording.entry.inputFlags = getFlags();
+	memoRecording.entry.readCount = 0;
+	memoRecording.entry.writeCount = 0;
+	memoRecording.entry.pages = 0;
+	memoRecording.entryStackPointer = *SP;
+	memoRecording.lowestStackPointer = *SP;
+	memoRecording.returnAddress = getMemory16(*SP);
+	memoRecording.startCycle = cyclesRun;
+	memoRecording.startInterrupts = interruptsTaken;
+	memset(memoRecording.read, 0, sizeof(memoRecording.read));
+	memset(memoRecording.written, 0, sizeof(memoRecording.written));
+	memoRecording.previousCore = runNextInstruction;
+	runNextInstruction = runInstrumentedInstruction;
+	routine->misses += 1;
+}
+
+void memoRecordRead(uint32_t address, int size){
+	for(int i = 0; i < size && !memoRecording.failure; i++){
+		int offset = memoRamOffset(address + i);
+		if (offset == -2){
+			memoRecording.failure = "reads MMIO";
+			return;
+		}
+		uint16_t ramAddress = RAM_START + offset;
+		if (offset < 0 || (ramAddress >= memoRecording.entryStackPointer && ramAddress < memoRecording.entryStackPointer + 2)){
+			continue; // ROM or the return address
+		}
+		uint8_t bit = 1 << (offset & 7);
+		if ((memoRecording.read[offset >> 3] & bit) || (memoRecording.written[offset >> 3] & bit)){
+			continue; // Already in the read set, or produced by the routine itself
+		}
+		if (memoRecording.entry.readCount == MEMO_MAX_READS){
+			memoRecording.failure = "reads too much";
+			return;
+		}
+		memoRecording.read[offset >> 3] |= bit;
+		memoRecording.entry.reads[memoRecording.entry.readCount++] = (struct MemoByte_t){ramAddress, memory[ramAddress]};
+		memoRecording.entry.pages |= 1 << ((ramAddress >> 8) - MEMO_FIRST_PAGE);
+	}
+}
+
+void memoRecordWrite(uint32_t address, int size){
+	for(int i = 0; i < size && !memoRecording.failure; i++){
+		int offset = memoRamOffset(address + i);
+		if (offset < 0){
+			memoRecording.failure = "writes outside RAM";
+			return;
+		}
+		memoRecording.written[offset >> 3] |= 1 << (offset & 7);
+	}
+}
+
+void finishMemoRecording(){
+	struct MemoEntry_t* entry = &memoRecording.entry;
+	// The stack frame below the entry SP is dead once the routine returns
+	for(uint32_t address = RAM_START; address < RAM_END && !memoRecording.failure; address++){
+		int offset = address - RAM_START;
+		bool deadStack = address >= memoRecording.lowestStackPointer && address < memoRecording.entryStackPointer;
+		if (!(memoRecording.written[offset >> 3] & (1 << (offset & 7))) || deadStack){
+			continue;
+		}
+		if (entry->writeCount == MEMO_MAX_WRITES){
+			memoRecording.failure = "writes too much";
+			break;
+		}
+		entry->writes[entry->writeCount++] = (struct MemoByte_t){address, memory[address]};
+	}
+
+	struct MemoRoutine_t* routine = memoRecording.routine;
+	if (memoRecording.aborted){
+		// Try again on the next call
+	}
+	else if (memoRecording.failure){
+		routine->impure = true;
+		printf("Memo %04x: not memoizing, the routine %s\n", routine->address, memoRecording.failure);
+	}
+	else{
+		getRegisters(entry->outputRegisters);
+		entry->outputFlags = getFlags();
+		entry->cycles = cyclesRun - memoRecording.startCycle;
+		memcpy(entry->pageGenerations, memoPageGenerations, sizeof(memoPageGenerations));
+		entry->valid = true;
+		routine->entries[routine->nextEntry] = *entry;
+		routine->nextEntry = (routine->nextEntry + 1) % MEMO_MAX_ENTRIES;
+	}
+	memoRecording.active = false;
+	runNextInstruction = memoRecording.previousCore;
+}
+
+// Called by the instrumented core after every instruction while recording
+void checkMemoRecording(){
+	if (*SP < memoRecording.lowestStackPointer){
+		memoRecording.lowestStackPointer = *SP;
+	}
+	if (sleep){
+		memoRecording.failure = "sleeps";
+	}
+	else if (cyclesRun - memoRecording.startCycle > MEMO_MAX_CYCLES){
+		memoRecording.failure = "runs for too long";
+	}
+	memoRecording.aborted = interruptsTaken != memoRecording.startInterrupts; // The handler's work would end up in the entry
+	if (memoRecording.failure || memoRecording.aborted || (pc == memoRecording.returnAddress && *SP == memoRecording.entryStackPointer + 2)){
+		finishMemoRecording();
+	}
+}
@@ -0,0 +1,114 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "pngWriter.h"
+
+static uint32_t crcTable[256];
+
+void initPngWriter(){
+	for(uint32_t n = 0; n < 256; n++){
+		uint32_t c = n;
+		for(int k = 0; k < 8; k++){
+			c = c & 1 ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+		}
+		crcTable[n] = c;
+	}
+}
+
+uint32_t updateCrc(uint32_t crc, const uint8_t* data, size_t length){
+	crc = ~crc;
+	for(size_t i = 0; i < length; i++){
+		crc = crcTable[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+	}
+	return ~crc;
+}
+
+void putBig32(uint8_t* destination, uint32_t value){
+	destination[0] = value >> 24;
+	destination[1] = value >> 16;
+	destination[2] = value >> 8;
+	destination[3] = value;
+}
+
+void writePngChunk(FILE* output, const char* type, const uint8_t* data, uint32_t length){
+	uint8_t word[4];
+	putBig32(word, length);
+	fwrite(word, 1, 4, output);
+	fwrite(type, 1, 4, output);
+	fwrite(data, 1, length, output);
+	uint32_t crc = updateCrc(updateCrc(0, (const uint8_t*)type, 4), data, length);
+	putBig32(word, crc);
+	fwrite(word, 1, 4, output);
+}
+
+// zlib stream of stored deflate blocks. 'prefix' bytes at the start of the result are left for the caller (like fdAT's sequence number)
+uint8_t* storeZlib(const uint8_t* data, uint32_t length, uint32_t prefix, uint32_t* resultLength){
+	uint32_t blocks = length / 65535 + 1;
+	uint8_t* result = malloc(prefix + 2 + blocks * 5 + length + 4);
+	uint8_t* out = result + prefix;
+	*out++ = 0x78;
+	*out++ = 0x01;
+	uint32_t a = 1, b = 0;
+	for(uint32_t i = 0; i < length; i++){
+		a = (a + data[i]) % 65521;
+		b = (b + a) % 65521;
+	}
+	for(uint32_t offset = 0; offset < length || offset == 0; ){
+		uint32_t size = length - offset > 65535 ? 65535 : length - offset;
+		*out++ = offset + size == length; // BFINAL on the last block, BTYPE 0
+		*out++ = size & 0xFF;
+		*out++ = size >> 8;
+		*out++ = ~size & 0xFF;
+		*out++ = (~size >> 8) & 0xFF;
+		memcpy(out, data + offset, size);
+		out += size;
+		offset += size;
+		if (length == 0){
+			break;
+		}
+	}
+	putBig32(out, b << 16 | a);
+	out += 4;
+	*resultLength = (uint32_t)(out - result);
+	return result;
+}
+
+void writePngHeader(FILE* output, int width, int height, const uint32_t palette[4]){
+	fwrite("\x89PNG\r\n\x1a\n", 1, 8, output);
+	uint8_t header[13];
+	putBig32(header, width);
+	putBig32(header + 4, height);
+	header[8] = 2; // Bit depth
+	header[9] = 3; // Indexed color
+	header[10] = header[11] = header[12] = 0;
+	writePngChunk(output, "IHDR", header, sizeof(header));
+	uint8_t plte[12];
+	for(int i = 0; i < 4; i++){
+		plte[3*i] = (palette[i] >> 16) & 0xFF;
+		plte[3*i + 1] = (palette[i] >> 8) & 0xFF;
+		plte[3*i + 2] = palette[i] & 0xFF;
+	}
+	writePngChunk(output, "PLTE", plte, sizeof(plte));
+}
+
+bool writePng2bpp(const char* fileName, const uint8_t* packed, int width, int height, int stride, const uint32_t palette[4]){
+	FILE* output = fopen(fileName, "wb");
+	if (!output){
+		printf("Can't open %s for writing\n", fileName);
+		return false;
+	}
+	writePngHeader(output, width, height, palette);
+	int rowBytes = 1 + (width + 3) / 4; // Filter byte + 2bpp pixels
+	uint8_t* raw = malloc((size_t)rowBytes * height);
+	for(int y = 0; y < height; y++){
+		raw[y * rowBytes] = 0; // No filter
+		memcpy(raw + y * rowBytes + 1, packed + (size_t)y * stride, rowBytes - 1);
+	}
+	uint32_t length;
+	uint8_t* data = storeZlib(raw, (uint32_t)rowBytes * height, 0, &length);
+	writePngChunk(output, "IDAT", data, length);
+	writePngChunk(output, "IEND", NULL, 0);
+	free(data);
+	free(raw);
+	return fclose(output) == 0;
+}
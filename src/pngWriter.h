@@ -0,0 +1,16 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+// Minimal PNG output for 4 color images: 2 bit indexed color, the pixel data in stored (uncompressed) deflate blocks,
+// so there's no zlib dependency. Run the files through an optimizer if size matters.
+// The 2 bit rows are the LCD_FORMAT_PACKED2BPP layout, leftmost pixel in the top bits.
+
+void initPngWriter(); // Builds the CRC table, call once before anything else. The rest is safe to use from several threads
+uint32_t updateCrc(uint32_t crc, const uint8_t* data, size_t length); // CRC-32 of the PNG spec, start with 0
+void putBig32(uint8_t* destination, uint32_t value);
+void writePngChunk(FILE* output, const char* type, const uint8_t* data, uint32_t length);
+uint8_t* storeZlib(const uint8_t* data, uint32_t length, uint32_t prefix, uint32_t* resultLength); // malloc'd zlib stream, the first 'prefix' bytes are left for the caller
+void writePngHeader(FILE* output, int width, int height, const uint32_t palette[4]); // Signature, IHDR and PLTE. 'palette' is 0x00RRGGBB
+bool writePng2bpp(const char* fileName, const uint8_t* packed, int width, int height, int stride, const uint32_t palette[4]); // Whole file for a single image, rows 'stride' bytes apart
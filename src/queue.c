@@ -4,38 +4,30 @@
 
 #include "queue.h"
 
-// TODO: might be better to replace the implementation with an array instead of a linked list, as it will allow the memory to be statically allocated.
-
-void addElement(struct Queue *queue, int value){
-	struct Element* newElement = malloc(sizeof(struct Element));
-	newElement->value = value;
-	newElement->next = NULL;
-	if(queue->last != NULL){
-		queue->last->next = newElement;
-	}
-	if(queue->first == NULL){
-		queue->first = newElement;
+bool addElement(struct Queue *queue, int value){
+	uint32_t tail = (uint32_t)queue->tail;
+	if (tail - atomicLoad(&queue->head) == QUEUE_CAPACITY){
+		return false;
 	}
-	queue->last = newElement;
+	queue->values[tail % QUEUE_CAPACITY] = value;
+	atomicStore(&queue->tail, tail + 1); // Publishes the value
+	return true;
 }
 
 int popElement(struct Queue* queue){
-	int value = queue->first->value;
-	struct Element* newFirst = queue->first->next;
-	free(queue->first);
-	queue->first = newFirst;
+	uint32_t head = (uint32_t)queue->head;
+	int value = queue->values[head % QUEUE_CAPACITY];
+	atomicStore(&queue->head, head + 1); // Hands the slot back to the producer
 	return value;
 }
 
 bool isEmpty(struct Queue* queue){
-	return (queue->first == NULL);
+	return atomicLoad(&queue->tail) == (uint32_t)queue->head;
 }
 
 void printQueue(struct Queue* queue){
-	struct Element* current = queue->first;
-	while(current != NULL){
-		printf("%d ", current->value);
-		current = current->next;
+	for(uint32_t i = (uint32_t)queue->head; i != atomicLoad(&queue->tail); i++){
+		printf("%d ", queue->values[i % QUEUE_CAPACITY]);
 	}
 	printf("\n");
 
@@ -1,17 +1,20 @@
 #pragma once
 #include <stdlib.h>
 #include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
 
-struct Element{
-	int value;
-	struct Element* next;
-};
+#include "atomics.h"
+
+// Fixed size ring. It's safe for one thread to add elements while another one pops them, with no locks.
+#define QUEUE_CAPACITY 64 // Must be a power of 2
 struct Queue{
-	struct Element* first;
-	struct Element* last;
+	AtomicU32 head; // Next element to pop, only the consumer writes it
+	AtomicU32 tail; // Next free slot, only the producer writes it
+	int values[QUEUE_CAPACITY];
 };
 
-void addElement(struct Queue *queue, int value);
-int popElement(struct Queue* queue);
+bool addElement(struct Queue *queue, int value); // Returns false if the queue is full
+int popElement(struct Queue* queue); // The queue must not be empty
 bool isEmpty(struct Queue* queue);
 void printQueue(struct Queue* queue);
@@ -0,0 +1,255 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "scaler.h"
+
+#if !defined(SCALER_SCALAR) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define SCALER_SSE2
+#include <emmintrin.h>
+#endif
+
+bool parseScaleFilter(const char* name, enum ScaleFilter* filter){
+	if (strcmp(name, "nearest") == 0){
+		*filter = SCALE_NEAREST;
+	}
+	else if (strcmp(name, "scale2x") == 0){
+		*filter = SCALE_2X;
+	}
+	else if (strcmp(name, "scale3x") == 0){
+		*filter = SCALE_3X;
+	}
+	else if (strcmp(name, "lcd") == 0){
+		*filter = SCALE_LCD_GRID;
+	}
+	else{
+		return false;
+	}
+	return true;
+}
+
+static int filterFactor(enum ScaleFilter filter){
+	return filter == SCALE_2X ? 2 : filter == SCALE_3X ? 3 : 1;
+}
+
+bool initScaler(struct Scaler* scaler, enum ScaleFilter filter, int scale, int width, int height, uint32_t gapColor){
+	memset(scaler, 0, sizeof(*scaler));
+	int factor = filterFactor(filter);
+	if (scale < 1 || scale % factor){
+		return false;
+	}
+	scaler->filter = filter;
+	scaler->scale = scale;
+	scaler->width = width;
+	scaler->height = height;
+	scaler->gapColor = gapColor;
+	scaler->rows = malloc((2 * width + 2) * sizeof(uint32_t));
+	if (factor > 1 && scale > factor){
+		scaler->intermediate = malloc((size_t)width * factor * height * factor * sizeof(uint32_t));
+	}
+	return true;
+}
+
+void freeScaler(struct Scaler* scaler){
+	free(scaler->intermediate);
+	free(scaler->rows);
+	memset(scaler, 0, sizeof(*scaler));
+}
+
+// One source row to one scaled row. With SSE2 the common factors shuffle 4 pixels at a time, bigger ones store
+// a broadcast pixel 4 at a time (the last store of a block overlaps the previous one, it's the same value)
+static void scaleRow(const uint32_t* source, int width, int scale, uint32_t* destination){
+	int x = 0;
+#ifdef SCALER_SSE2
+	if (scale == 2){
+		for(; x + 4 <= width; x += 4){
+			__m128i pixels = _mm_loadu_si128((const __m128i*)(source + x));
+			_mm_storeu_si128((__m128i*)(destination + 2*x), _mm_unpacklo_epi32(pixels, pixels));
+			_mm_storeu_si128((__m128i*)(destination + 2*x + 4), _mm_unpackhi_epi32(pixels, pixels));
+		}
+	}
+	else if (scale == 3){
+		for(; x + 4 <= width; x += 4){
+			__m128i pixels = _mm_loadu_si128((const __m128i*)(source + x));
+			_mm_storeu_si128((__m128i*)(destination + 3*x), _mm_shuffle_epi32(pixels, _MM_SHUFFLE(1, 0, 0, 0)));
+			_mm_storeu_si128((__m128i*)(destination + 3*x + 4), _mm_shuffle_epi32(pixels, _MM_SHUFFLE(2, 2, 1, 1)));
+			_mm_storeu_si128((__m128i*)(destination + 3*x + 8), _mm_shuffle_epi32(pixels, _MM_SHUFFLE(3, 3, 3, 2)));
+		}
+	}
+	else if (scale >= 4){
+		for(; x < width; x++){
+			__m128i pixel = _mm_set1_epi32((int)source[x]);
+			uint32_t* block = destination + x * scale;
+			for(int i = 0; i + 4 <= scale; i += 4){
+				_mm_storeu_si128((__m128i*)(block + i), pixel);
+			}
+			_mm_storeu_si128((__m128i*)(block + scale - 4), pixel);
+		}
+	}
+#endif
+	for(; x < width; x++){
+		for(int i = 0; i < scale; i++){
+			destination[x * scale + i] = source[x];
+		}
+	}
+}
+
+static void scaleNearest(const uint32_t* source, int width, int height, int sourceStride, int scale, uint32_t* destination, int destinationStride){
+	for(int y = 0; y < height; y++){
+		uint32_t* row = destination + (size_t)y * scale * destinationStride;
+		scaleRow(source + (size_t)y * sourceStride, width, scale, row);
+		for(int i = 1; i < scale; i++){
+			memcpy(row + (size_t)i * destinationStride, row, (size_t)width * scale * sizeof(uint32_t));
+		}
+	}
+}
+
+// Source row with its edge pixels repeated on both sides, so the left and right neighbors are plain loads
+static const uint32_t* padRow(uint32_t* padded, const uint32_t* row, int width){
+	memcpy(padded + 1, row, width * sizeof(uint32_t));
+	padded[0] = row[0];
+	padded[width + 1] = row[width - 1];
+	return padded + 1;
+}
+
+#ifdef SCALER_SSE2
+static inline __m128i select128(__m128i mask, __m128i ifSet, __m128i ifClear){
+	return _mm_or_si128(_mm_and_si128(mask, ifSet), _mm_andnot_si128(mask, ifClear));
+}
+#endif
+
+// Scale2x: for pixel E with B above, D left, F right and H below, when B != H and D != F
+// E0 = D == B ? D : E, E1 = B == F ? F : E, E2 = D == H ? D : E, E3 = H == F ? F : E (E0 E1 on top, E2 E3 below)
+static void scale2x(struct Scaler* scaler, const uint32_t* source, int sourceStride, uint32_t* destination, int destinationStride){
+	int width = scaler->width;
+	for(int y = 0; y < scaler->height; y++){
+		const uint32_t* above = source + (size_t)(y > 0 ? y - 1 : y) * sourceStride;
+		const uint32_t* below = source + (size_t)(y + 1 < scaler->height ? y + 1 : y) * sourceStride;
+		const uint32_t* row = padRow(scaler->rows, source + (size_t)y * sourceStride, width);
+		uint32_t* top = destination + (size_t)2 * y * destinationStride;
+		uint32_t* bottom = top + destinationStride;
+		int x = 0;
+#ifdef SCALER_SSE2
+		const __m128i ones = _mm_set1_epi32(-1);
+		for(; x + 4 <= width; x += 4){
+			__m128i B = _mm_loadu_si128((const __m128i*)(above + x));
+			__m128i H = _mm_loadu_si128((const __m128i*)(below + x));
+			__m128i D = _mm_loadu_si128((const __m128i*)(row + x - 1));
+			__m128i E = _mm_loadu_si128((const __m128i*)(row + x));
+			__m128i F = _mm_loadu_si128((const __m128i*)(row + x + 1));
+			__m128i active = _mm_andnot_si128(_mm_or_si128(_mm_cmpeq_epi32(B, H), _mm_cmpeq_epi32(D, F)), ones);
+			__m128i E0 = select128(_mm_and_si128(active, _mm_cmpeq_epi32(D, B)), D, E);
+			__m128i E1 = select128(_mm_and_si128(active, _mm_cmpeq_epi32(B, F)), F, E);
+			__m128i E2 = select128(_mm_and_si128(active, _mm_cmpeq_epi32(D, H)), D, E);
+			__m128i E3 = select128(_mm_and_si128(active, _mm_cmpeq_epi32(H, F)), F, E);
+			_mm_storeu_si128((__m128i*)(top + 2*x), _mm_unpacklo_epi32(E0, E1));
+			_mm_storeu_si128((__m128i*)(top + 2*x + 4), _mm_unpackhi_epi32(E0, E1));
+			_mm_storeu_si128((__m128i*)(bottom + 2*x), _mm_unpacklo_epi32(E2, E3));
+			_mm_storeu_si128((__m128i*)(bottom + 2*x + 4), _mm_unpackhi_epi32(E2, E3));
+		}
+#endif
+		for(; x < width; x++){
+			uint32_t B = above[x], H = below[x], D = row[x - 1], E = row[x], F = row[x + 1];
+			bool active = B != H && D != F;
+			top[2*x] = active && D == B ? D : E;
+			top[2*x + 1] = active && B == F ? F : E;
+			bottom[2*x] = active && D == H ? D : E;
+			bottom[2*x + 1] = active && H == F ? F : E;
+		}
+	}
+}
+
+// Scale3x, with the 3x3 neighborhood
+// A B C
+// D E F
+// G H I
+static void scale3x(struct Scaler* scaler, const uint32_t* source, int sourceStride, uint32_t* destination, int destinationStride){
+	int width = scaler->width;
+	for(int y = 0; y < scaler->height; y++){
+		const uint32_t* above = source + (size_t)(y > 0 ? y - 1 : y) * sourceStride;
+		const uint32_t* below = source + (size_t)(y + 1 < scaler->height ? y + 1 : y) * sourceStride;
+		const uint32_t* row = source + (size_t)y * sourceStride;
+		uint32_t* out0 = destination + (size_t)3 * y * destinationStride;
+		uint32_t* out1 = out0 + destinationStride;
+		uint32_t* out2 = out1 + destinationStride;
+		for(int x = 0; x < width; x++){
+			int left = x > 0 ? x - 1 : x;
+			int right = x + 1 < width ? x + 1 : x;
+			uint32_t A = above[left], B = above[x], C = above[right];
+			uint32_t D = row[left], E = row[x], F = row[right];
+			uint32_t G = below[left], H = below[x], I = below[right];
+			if (B != H && D != F){
+				out0[3*x] = D == B ? D : E;
+				out0[3*x + 1] = (D == B && E != C) || (B == F && E != A) ? B : E;
+				out0[3*x + 2] = B == F ? F : E;
+				out1[3*x] = (D == B && E != G) || (D == H && E != A) ? D : E;
+				out1[3*x + 1] = E;
+				out1[3*x + 2] = (B == F && E != I) || (H == F && E != C) ? F : E;
+				out2[3*x] = D == H ? D : E;
+				out2[3*x + 1] = (D == H && E != I) || (H == F && E != G) ? H : E;
+				out2[3*x + 2] = H == F ? F : E;
+			}
+			else{
+				out0[3*x] = out0[3*x + 1] = out0[3*x + 2] = E;
+				out1[3*x] = out1[3*x + 1] = out1[3*x + 2] = E;
+				out2[3*x] = out2[3*x + 1] = out2[3*x + 2] = E;
+			}
+		}
+	}
+}
+
+// Average of every byte, rounding up like _mm_avg_epu8
+static inline uint32_t blendPixels(uint32_t a, uint32_t b){
+	return (a | b) - (((a ^ b) & 0xFEFEFEFE) >> 1);
+}
+
+// Nearest, then the last column of every block and the last row get the pixel blended with the gap color
+static void scaleLcdGrid(struct Scaler* scaler, const uint32_t* source, int sourceStride, uint32_t* destination, int destinationStride){
+	int width = scaler->width;
+	int scale = scaler->scale;
+	uint32_t* blended = scaler->rows;
+	for(int y = 0; y < scaler->height; y++){
+		const uint32_t* row = source + (size_t)y * sourceStride;
+		int x = 0;
+#ifdef SCALER_SSE2
+		const __m128i gap = _mm_set1_epi32((int)scaler->gapColor);
+		for(; x + 4 <= width; x += 4){
+			_mm_storeu_si128((__m128i*)(blended + x), _mm_avg_epu8(_mm_loadu_si128((const __m128i*)(row + x)), gap));
+		}
+#endif
+		for(; x < width; x++){
+			blended[x] = blendPixels(row[x], scaler->gapColor);
+		}
+		uint32_t* lit = destination + (size_t)y * scale * destinationStride;
+		scaleRow(row, width, scale, lit);
+		for(x = 0; x < width; x++){
+			lit[x * scale + scale - 1] = blended[x];
+		}
+		for(int i = 1; i < scale - 1; i++){
+			memcpy(lit + (size_t)i * destinationStride, lit, (size_t)width * scale * sizeof(uint32_t));
+		}
+		scaleRow(blended, width, scale, lit + (size_t)(scale - 1) * destinationStride);
+	}
+}
+
+void scaleImage(struct Scaler* scaler, const uint32_t* source, int sourceStride, uint32_t* destination, int destinationStride){
+	if (scaler->scale == 1 || scaler->filter == SCALE_NEAREST){
+		scaleNearest(source, scaler->width, scaler->height, sourceStride, scaler->scale, destination, destinationStride);
+		return;
+	}
+	if (scaler->filter == SCALE_LCD_GRID){
+		scaleLcdGrid(scaler, source, sourceStride, destination, destinationStride);
+		return;
+	}
+	int factor = filterFactor(scaler->filter);
+	uint32_t* filtered = scaler->intermediate ? scaler->intermediate : destination;
+	int filteredStride = scaler->intermediate ? scaler->width * factor : destinationStride;
+	if (scaler->filter == SCALE_2X){
+		scale2x(scaler, source, sourceStride, filtered, filteredStride);
+	}
+	else{
+		scale3x(scaler, source, sourceStride, filtered, filteredStride);
+	}
+	if (scaler->intermediate){
+		scaleNearest(filtered, scaler->width * factor, scaler->height * factor, filteredStride, scaler->scale / factor, destination, destinationStride);
+	}
+}
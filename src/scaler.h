@@ -0,0 +1,29 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+// Integer upscaling of XRGB8888 images, meant for the 96x64 frame straight out of the decoder so the scaled image is
+// written in a single pass. Strides are in pixels, like decodeLcdImage.
+// The filters only compare pixels for equality (except the LCD grid's blend), so they work just as well on palette
+// indices stored as uint32_t.
+enum ScaleFilter{
+	SCALE_NEAREST, // Every pixel becomes a scale x scale block
+	SCALE_2X, // Scale2x/AdvMAME2x edge smoothing, scale has to be a multiple of 2 (the rest is nearest)
+	SCALE_3X, // Scale3x/AdvMAME3x, scale has to be a multiple of 3
+	SCALE_LCD_GRID, // Nearest with the last row and column of every block blended with gapColor, like the gaps between the walker's pixels
+};
+
+struct Scaler{
+	enum ScaleFilter filter;
+	int scale;
+	int width; // Source size
+	int height;
+	uint32_t gapColor; // SCALE_LCD_GRID
+	uint32_t* intermediate; // Scale2x/3x output when there's nearest scaling left to do after it
+	uint32_t* rows; // Scratch: padded source row, blended row
+};
+
+bool parseScaleFilter(const char* name, enum ScaleFilter* filter); // "nearest", "scale2x", "scale3x" or "lcd"
+bool initScaler(struct Scaler* scaler, enum ScaleFilter filter, int scale, int width, int height, uint32_t gapColor); // False if the filter can't scale by 'scale'
+void freeScaler(struct Scaler* scaler);
+void scaleImage(struct Scaler* scaler, const uint32_t* source, int sourceStride, uint32_t* destination, int destinationStride); // destination is width*scale x height*scale
@@ -0,0 +1,93 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <string.h>
+#include <sched.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "sharedFrame.h"
+
+struct SharedFrame* createSharedFrame(const char* name, const uint32_t palette[4]){
+	int descriptor = shm_open(name, O_CREAT | O_RDWR, 0644);
+	if (descriptor < 0){
+		printf("Can't create shared memory %s\n", name);
+		return NULL;
+	}
+	if (ftruncate(descriptor, sizeof(struct SharedFrame)) != 0){
+		printf("Can't size shared memory %s\n", name);
+		close(descriptor);
+		return NULL;
+	}
+	struct SharedFrame* shared = mmap(NULL, sizeof(struct SharedFrame), PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0);
+	close(descriptor);
+	if (shared == MAP_FAILED){
+		printf("Can't map shared memory %s\n", name);
+		return NULL;
+	}
+	// A segment left behind by an instance that didn't exit cleanly gets reused, readers still attached see it restart
+	atomicStore(&shared->magic, 0);
+	atomicStore(&shared->sequence, 0);
+	shared->version = SHARED_FRAME_VERSION;
+	shared->size = sizeof(struct SharedFrame);
+	shared->width = LCD_WIDTH;
+	shared->height = LCD_HEIGHT;
+	memcpy(shared->palette, palette, sizeof(shared->palette));
+	shared->frameNumber = 0;
+	for(int i = 0; i < LCD_WIDTH * LCD_HEIGHT; i++){
+		shared->pixels[i] = palette[0];
+	}
+	atomicStore(&shared->magic, SHARED_FRAME_MAGIC);
+	return shared;
+}
+
+void beginSharedWrite(struct SharedFrame* shared){
+	atomicStore(&shared->sequence, shared->sequence + 1);
+	atomicFence(); // The data writes can't move above the odd sequence
+}
+
+void endSharedWrite(struct SharedFrame* shared){
+	atomicStore(&shared->sequence, shared->sequence + 1); // Release: the data writes can't move below it
+}
+
+void removeSharedFrame(struct SharedFrame* shared, const char* name){
+	munmap(shared, sizeof(struct SharedFrame));
+	shm_unlink(name);
+}
+
+const struct SharedFrame* attachSharedFrame(const char* name){
+	int descriptor = shm_open(name, O_RDONLY, 0);
+	if (descriptor < 0){
+		printf("No shared memory named %s, is the emulator running with -shm %s?\n", name, name);
+		return NULL;
+	}
+	const struct SharedFrame* shared = mmap(NULL, sizeof(struct SharedFrame), PROT_READ, MAP_SHARED, descriptor, 0);
+	close(descriptor);
+	if (shared == MAP_FAILED){
+		printf("Can't map shared memory %s\n", name);
+		return NULL;
+	}
+	if (atomicLoad(&shared->magic) != SHARED_FRAME_MAGIC || shared->version != SHARED_FRAME_VERSION || shared->size != sizeof(struct SharedFrame)){
+		printf("%s isn't a frame from a compatible emulator version\n", name);
+		detachSharedFrame(shared);
+		return NULL;
+	}
+	return shared;
+}
+
+uint32_t beginSharedRead(const struct SharedFrame* shared){
+	uint32_t sequence;
+	while ((sequence = atomicLoad(&shared->sequence)) & 1){
+		sched_yield(); // Writes are short, but the writer could be descheduled in the middle of one
+	}
+	return sequence;
+}
+
+bool endSharedRead(const struct SharedFrame* shared, uint32_t sequence){
+	atomicFence(); // The data reads can't move below the sequence check
+	return atomicLoad(&shared->sequence) == sequence;
+}
+
+void detachSharedFrame(const struct SharedFrame* shared){
+	munmap((void*)shared, sizeof(struct SharedFrame));
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "atomics.h"
+#include "walker.h"
+
+// Latest LCD frame and CPU state of a running emulator in a POSIX shared memory segment (shm_open), for viewers and
+// monitors running as separate processes. Guarded by a seqlock: the emulator never waits for readers, a reader works
+// straight off the mapping and checks afterwards that the emulator didn't write in the meantime, retrying if it did.
+// Readers only ever map the segment read-only.
+#define SHARED_FRAME_MAGIC 0x4D485357 // "WSHM"
+#define SHARED_FRAME_VERSION 1
+
+struct SharedFrame{
+	uint32_t magic; // Written last when the segment is created
+	uint32_t version;
+	uint32_t size; // sizeof(struct SharedFrame)
+	uint16_t width;
+	uint16_t height;
+	uint32_t palette[4];
+	AtomicU32 sequence; // Odd while the emulator is writing, bumped by 2 on every update
+	uint32_t frameNumber; // Bumped only when the picture changed
+	uint64_t cycle; // getCycleCount() at the update
+	uint32_t registers[8]; // ER0-ER7
+	uint16_t pc;
+	uint8_t ccr;
+	uint8_t reserved;
+	uint32_t pixels[LCD_WIDTH * LCD_HEIGHT]; // XRGB8888, like fillVideoBuffer
+};
+
+// Emulator side
+struct SharedFrame* createSharedFrame(const char* name, const uint32_t palette[4]); // 'name' like "/pokestroller", NULL on failure
+void beginSharedWrite(struct SharedFrame* shared);
+void endSharedWrite(struct SharedFrame* shared);
+void removeSharedFrame(struct SharedFrame* shared, const char* name); // Unmaps and unlinks the segment, attached readers keep their mapping
+
+// Reader side
+const struct SharedFrame* attachSharedFrame(const char* name); // NULL if there's no segment or it's from an incompatible version
+uint32_t beginSharedRead(const struct SharedFrame* shared); // Waits out a write in progress, returns the sequence to give endSharedRead
+bool endSharedRead(const struct SharedFrame* shared, uint32_t sequence); // False if the emulator wrote during the read, everything read since beginSharedRead has to be thrown away
+void detachSharedFrame(const struct SharedFrame* shared);
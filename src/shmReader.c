@@ -0,0 +1,73 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "sharedFrame.h"
+
+// Attaches to the shared frame of a running emulator (pokeStroller-headless -shm NAME) and prints its state and screen.
+// Usage: shmReader NAME [-watch]
+// -watch keeps printing every new frame until interrupted
+
+#define SHM_READER_TEXT_SIZE 8192
+
+// Renders everything into 'text' straight from the mapping. Returns false if the emulator wrote meanwhile
+static bool renderFrame(const struct SharedFrame* shared, char* text, uint32_t* frameNumber){
+	uint32_t sequence = beginSharedRead(shared);
+	int length = snprintf(text, SHM_READER_TEXT_SIZE, "frame %u  cycle %llu  pc %04x  ccr %02x\n", shared->frameNumber,
+		(unsigned long long)shared->cycle, shared->pc, shared->ccr);
+	for(int i = 0; i < 8; i++){
+		length += snprintf(text + length, SHM_READER_TEXT_SIZE - length, "er%d %08x%s", i, shared->registers[i], i == 3 || i == 7 ? "\n" : "  ");
+	}
+	const char shades[4] = {' ', '.', '*', '#'}; // Lightest first, like the palette
+	for(int y = 0; y < LCD_HEIGHT; y += 2){ // Two rows per line keeps the aspect ratio close in a terminal
+		for(int x = 0; x < LCD_WIDTH; x++){
+			uint32_t color = shared->pixels[y * LCD_WIDTH + x];
+			int index = 0;
+			while (index < 3 && shared->palette[index] != color){
+				index += 1;
+			}
+			text[length++] = shades[index];
+		}
+		text[length++] = '\n';
+	}
+	text[length] = 0;
+	*frameNumber = shared->frameNumber;
+	return endSharedRead(shared, sequence);
+}
+
+int main(int argc, char **argv){
+	if (argc < 2){
+		printf("Usage: %s NAME [-watch]\n", argv[0]);
+		return 1;
+	}
+	bool watching = argc > 2 && strcmp(argv[2], "-watch") == 0;
+	const struct SharedFrame* shared = attachSharedFrame(argv[1]);
+	if (!shared){
+		return 1;
+	}
+	static char text[SHM_READER_TEXT_SIZE];
+	uint32_t lastFrame = UINT32_MAX;
+	int retries = 0;
+	do{
+		uint32_t frameNumber;
+		while (!renderFrame(shared, text, &frameNumber)){
+			retries += 1;
+		}
+		if (frameNumber != lastFrame){
+			fputs(text, stdout);
+			fflush(stdout);
+			lastFrame = frameNumber;
+		}
+		if (watching){
+			struct timespec wait = {0, 50 * 1000 * 1000};
+			nanosleep(&wait, NULL);
+		}
+	} while (watching);
+	if (retries){
+		printf("%d reads raced with the emulator and were retried\n", retries);
+	}
+	detachSharedFrame(shared);
+	return 0;
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+// Devices hanging off the SSU (the SPI-like serial bus). Each one has an active low chip select
+// pin in a port data register. The bus only looks at the pins when that register gets written,
+// and every byte the SSU shifts out goes to the selected device alone.
+#define MAX_SSU_DEVICES 8
+
+struct SsuDevice{
+	const char* name;
+	uint16_t chipSelectPort; // Port data register holding the chip select pin (PORT1, PORT9...)
+	uint8_t chipSelectPin; // Mask of the pin inside chipSelectPort
+	void* context; // Free for the device's own state
+	void (*select)(struct SsuDevice* device); // Chip select went low. Can be NULL
+	void (*deselect)(struct SsuDevice* device); // Chip select went high. Can be NULL
+	uint8_t (*transfer)(struct SsuDevice* device, uint8_t data); // Gets the byte shifted out, returns the byte shifted in
+	bool selected; // Managed by the bus
+};
+
+// Devices have to be attached after initWalker, which resets the bus to the built-in EEPROM, LCD and accelerometer.
+// The device must stay alive while attached. Returns false if the bus is full.
+bool attachSsuDevice(struct SsuDevice* device);
+void detachSsuDevice(struct SsuDevice* device);
@@ -0,0 +1,215 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <termios.h>
+#include <sys/select.h>
+
+#include "walker.h"
+
+// Terminal frontend for walkers running over SSH. Every character cell shows two LCD pixels with an upper
+// half block: the foreground color is the top pixel and the background the bottom one, in 256 color grays.
+// Only the cells that changed since the previous frame get written, and the color codes are only emitted
+// when they differ from the last ones, so an idle screen costs nothing on the link.
+// Keys: space/z/x like the other frontends, q quits.
+
+#define TICKS_PER_SEC 4 /* RTC/4 */
+#define SLICES_PER_TICK 16 // The emulation syncs with the wall clock every 1/64 s
+#define CYCLES_PER_SLICE (SYSTEM_CLOCK_CYCLES_PER_SECOND / TICKS_PER_SEC / SLICES_PER_TICK)
+
+#define TERM_ROWS (LCD_HEIGHT / 2)
+#define TERM_CELL_MAX_BYTES (8 + 11 + 11 + 3) // Cursor move "\x1b[32;96H", both colors "\x1b[38;5;255m", the UTF-8 half block
+#define TERM_OUTPUT_SIZE (LCD_WIDTH * TERM_ROWS * TERM_CELL_MAX_BYTES + 1) // Every cell changed, plus sprintf's terminator
+#define TERM_UNDRAWN 0xFF
+
+struct Cell_t{
+	uint8_t top; // 256 color palette index of the top pixel, TERM_UNDRAWN before the first frame
+	uint8_t bottom;
+};
+
+static struct Cell_t cells[TERM_ROWS][LCD_WIDTH];
+static char output[TERM_OUTPUT_SIZE];
+static struct termios savedTerminal;
+static volatile sig_atomic_t quitting;
+
+static double getSeconds(){
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+static void restoreTerminal(){
+	const char* reset = "\x1b[0m\x1b[?25h\x1b[?1049l"; // Colors, cursor, main screen
+	write(STDOUT_FILENO, reset, strlen(reset));
+	tcsetattr(STDIN_FILENO, TCSAFLUSH, &savedTerminal);
+}
+
+static void onSignal(int signal){
+	(void)signal; // SIGTERM and SIGHUP both quit
+	quitting = 1;
+}
+
+// Raw input: no echo, no line buffering, reads return right away
+static bool setupTerminal(){
+	if (tcgetattr(STDIN_FILENO, &savedTerminal) != 0){
+		printf("stdin isn't a terminal\n");
+		return false;
+	}
+	struct termios raw = savedTerminal;
+	raw.c_lflag &= ~(ECHO | ICANON | ISIG | IEXTEN);
+	raw.c_iflag &= ~(IXON | ICRNL);
+	raw.c_cc[VMIN] = 0;
+	raw.c_cc[VTIME] = 0;
+	tcsetattr(STDIN_FILENO, TCSAFLUSH, &raw);
+	atexit(restoreTerminal);
+	signal(SIGTERM, onSignal);
+	signal(SIGHUP, onSignal);
+	const char* setup = "\x1b[?1049h\x1b[?25l\x1b[2J"; // Alternate screen, hide the cursor, clear
+	write(STDOUT_FILENO, setup, strlen(setup));
+	memset(cells, TERM_UNDRAWN, sizeof(cells));
+	return true;
+}
+
+// 0x00RRGGBB gray to the closest step of the 24 level gray ramp (232-255)
+static uint8_t grayIndex(uint32_t color){
+	int level = color & 0xFF;
+	if (level < 8){
+		return 16; // Black
+	}
+	int step = (level - 8 + 5) / 10;
+	return 232 + (step > 23 ? 23 : step);
+}
+
+static void drawFrame(const uint32_t* frame){
+	int length = 0;
+	int cursorRow = -1, cursorColumn = -1; // Where the terminal will print next
+	int foreground = -1, background = -1;
+	for(int row = 0; row < TERM_ROWS; row++){
+		for(int x = 0; x < LCD_WIDTH; x++){
+			struct Cell_t cell = {grayIndex(frame[2 * row * LCD_WIDTH + x]), grayIndex(frame[(2 * row + 1) * LCD_WIDTH + x])};
+			if (cell.top == cells[row][x].top && cell.bottom == cells[row][x].bottom){
+				continue;
+			}
+			cells[row][x] = cell;
+			if (row != cursorRow || x != cursorColumn){
+				length += sprintf(output + length, "\x1b[%d;%dH", row + 1, x + 1);
+			}
+			if (cell.top != foreground){
+				length += sprintf(output + length, "\x1b[38;5;%dm", cell.top);
+				foreground = cell.top;
+			}
+			if (cell.bottom != background){
+				length += sprintf(output + length, "\x1b[48;5;%dm", cell.bottom);
+				background = cell.bottom;
+			}
+			length += sprintf(output + length, "\xe2\x96\x80"); // U+2580 upper half block
+			cursorRow = row;
+			cursorColumn = x + 1;
+		}
+	}
+	if (length){
+		for(int written = 0; written < length;){
+			ssize_t result = write(STDOUT_FILENO, output + written, length - written);
+			if (result < 0 && errno != EINTR){
+				break;
+			}
+			written += result > 0 ? result : 0;
+		}
+	}
+}
+
+// Frame callback, runs as soon as the ROM finishes drawing. Also called every quarter second for the parts of
+// the screen the ROM updates without a full redraw
+static void presentFrame(){
+	static uint32_t frame[LCD_WIDTH * LCD_HEIGHT];
+	if (fillVideoBufferDirty(frame)){
+		drawFrame(frame);
+	}
+}
+
+// Waits for keys until the wall clock reaches 'deadline'. Returns false when the user quits
+static bool readKeys(double deadline){
+	while (!quitting){
+		double timeLeft = deadline - getSeconds();
+		if (timeLeft < 0){
+			timeLeft = 0;
+		}
+		fd_set readable;
+		FD_ZERO(&readable);
+		FD_SET(STDIN_FILENO, &readable);
+		struct timeval timeout = {(time_t)timeLeft, (suseconds_t)((timeLeft - (time_t)timeLeft) * 1e6)};
+		int ready = select(STDIN_FILENO + 1, &readable, NULL, NULL, &timeout);
+		if (ready <= 0){
+			return ready == 0 || errno == EINTR ? !quitting : false;
+		}
+		char keys[16];
+		ssize_t count = read(STDIN_FILENO, keys, sizeof(keys));
+		for(ssize_t i = 0; i < count; i++){
+			switch (keys[i]){
+				case ' ': setKeys(ENTER); break;
+				case 'z': case 'Z': setKeys(LEFT); break;
+				case 'x': case 'X': setKeys(RIGHT); break;
+				case 'q': case 'Q': case 3: return false; // 3 is ctrl-c, ISIG is off
+			}
+		}
+	}
+	return false;
+}
+
+int main(int argc, char** argv){
+	const char* romPath = "rom.bin";
+	const char* eepromPath = "eeprom.bin";
+	for(int i = 1; i < argc; i++){
+		bool hasValue = i + 1 < argc;
+		if (strcmp(argv[i], "-rom") == 0 && hasValue){
+			romPath = argv[++i];
+		}
+		else if (strcmp(argv[i], "-eeprom") == 0 && hasValue){
+			eepromPath = argv[++i];
+			if (strcmp(eepromPath, "none") == 0){
+				eepromPath = NULL;
+			}
+		}
+		else{
+			printf("Usage: %s [-rom PATH] [-eeprom PATH|none]\n", argv[0]);
+			return 1;
+		}
+	}
+	if (!initWalkerFromFiles(romPath, eepromPath)){
+		return 1;
+	}
+	if (!setupTerminal()){
+		return 1;
+	}
+
+	setFrameCallback(presentFrame);
+	uint64_t cycleCount = 0;
+	uint64_t slices = 0;
+	double startTime = getSeconds();
+	bool running = true;
+	while (running){
+		if (runNextInstruction(&cycleCount)){
+			break;
+		}
+		if (cycleCount >= CYCLES_PER_SLICE){
+			cycleCount -= CYCLES_PER_SLICE;
+			slices += 1;
+			if ((slices % SLICES_PER_TICK) == 0){
+				quarterRTCInterrupt();
+				presentFrame();
+			}
+
+			double deadline = startTime + (double)slices / (TICKS_PER_SEC * SLICES_PER_TICK);
+			if (getSeconds() - deadline > 1){
+				startTime = getSeconds() - (double)slices / (TICKS_PER_SEC * SLICES_PER_TICK); // Too far behind, don't try to catch up
+			}
+			running = readKeys(deadline);
+		}
+	}
+	return 0;
+}
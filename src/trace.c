@@ -0,0 +1,76 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "trace.h"
+
+bool traceEnabled;
+
+static struct TraceRecord ring[TRACE_CAPACITY];
+static uint32_t nextRecord; // Index of the slot that the next instruction will use
+static uint32_t recordCount;
+static struct TraceRecord* current;
+static uint32_t registersBefore[8];
+
+void setTracing(bool enabled){
+	traceEnabled = enabled;
+	current = NULL;
+}
+
+void traceBeginInstruction(uint16_t pc, const uint8_t* instruction, uint64_t cycle, const uint32_t* registers, uint8_t ccr){
+	current = &ring[nextRecord];
+	nextRecord = (nextRecord + 1) % TRACE_CAPACITY;
+	if (recordCount < TRACE_CAPACITY){
+		recordCount += 1;
+	}
+
+	current->cycle = cycle;
+	current->pc = pc;
+	for(int i = 0; i < 3; i++){
+		current->opcode[i] = (instruction[2*i] << 8) | instruction[2*i + 1];
+	}
+	current->ccr = ccr;
+	current->changedRegisters = 0;
+	current->writeCount = 0;
+	memcpy(registersBefore, registers, sizeof(registersBefore));
+}
+
+void traceMemoryWrite(uint32_t address, uint32_t value, uint8_t size){
+	if (current == NULL || current->writeCount == TRACE_MAX_WRITES){
+		return;
+	}
+	struct TraceWrite* write = &current->writes[current->writeCount++];
+	write->address = address;
+	write->value = value;
+	write->size = size;
+}
+
+void traceEndInstruction(const uint32_t* registers, uint8_t ccr){
+	if (current == NULL){
+		return;
+	}
+	for(int i = 0; i < 8; i++){
+		if (registers[i] != registersBefore[i]){
+			current->changedRegisters |= (1 << i);
+			current->registers[i] = registers[i];
+		}
+	}
+	current->ccr = ccr;
+	current = NULL;
+}
+
+bool dumpTrace(const char* fileName){
+	FILE* traceFile = fopen(fileName, "wb");
+	if (!traceFile){
+		printf("Can't open %s for writing\n", fileName);
+		return false;
+	}
+	struct TraceFileHeader header = {TRACE_MAGIC, TRACE_VERSION, sizeof(struct TraceRecord), recordCount};
+	fwrite(&header, sizeof(header), 1, traceFile);
+
+	uint32_t oldest = (nextRecord + TRACE_CAPACITY - recordCount) % TRACE_CAPACITY;
+	for(uint32_t i = 0; i < recordCount; i++){
+		fwrite(&ring[(oldest + i) % TRACE_CAPACITY], sizeof(struct TraceRecord), 1, traceFile);
+	}
+	fclose(traceFile);
+	return true;
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+// Binary trace ring, one record per executed instruction. Older records get overwritten once the ring is full.
+#define TRACE_CAPACITY (16 * 1024)
+#define TRACE_MAX_WRITES 1 // Every instruction writes memory at most once, except EEPMOV which only gets its first byte recorded
+#define TRACE_MAGIC 0x43525450 // "PTRC"
+#define TRACE_VERSION 2
+
+struct TraceWrite{
+	uint32_t address;
+	uint32_t value;
+	uint8_t size; // In bytes: 1, 2 or 4
+};
+
+struct TraceRecord{
+	uint64_t cycle;
+	uint16_t pc;
+	uint16_t opcode[3]; // Instruction words as they appear in the ROM
+	uint8_t ccr; // CCR after execution
+	uint8_t changedRegisters; // Bit n set -> registers[n] holds the new value of ERn
+	uint8_t writeCount;
+	uint32_t registers[8];
+	struct TraceWrite writes[TRACE_MAX_WRITES];
+};
+
+// Trace file layout: TraceFileHeader followed by 'count' TraceRecords, oldest first
+struct TraceFileHeader{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t recordSize;
+	uint32_t count;
+};
+
+extern bool traceEnabled;
+
+void setTracing(bool enabled);
+void traceBeginInstruction(uint16_t pc, const uint8_t* instruction, uint64_t cycle, const uint32_t* registers, uint8_t ccr);
+void traceMemoryWrite(uint32_t address, uint32_t value, uint8_t size);
+void traceEndInstruction(const uint32_t* registers, uint8_t ccr);
+bool dumpTrace(const char* fileName);
@@ -0,0 +1,77 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+
+#include "trace.h"
+
+// Renders a trace file dumped by the emulator as text, one line per instruction.
+// Usage: traceDecoder trace.bin [lastN]
+int main(int argc, char **argv){
+	if (argc < 2){
+		printf("Usage: %s trace.bin [lastN]\n", argv[0]);
+		return 1;
+	}
+	FILE* input = fopen(argv[1], "rb");
+	if (!input){
+		printf("Can't open %s\n", argv[1]);
+		return 1;
+	}
+	struct TraceFileHeader header;
+	if (fread(&header, sizeof(header), 1, input) != 1 || header.magic != TRACE_MAGIC){
+		printf("%s is not a trace file\n", argv[1]);
+		fclose(input);
+		return 1;
+	}
+	if (header.version != TRACE_VERSION || header.recordSize != sizeof(struct TraceRecord)){
+		printf("Trace version %u (record size %u) doesn't match this decoder\n", header.version, header.recordSize);
+		fclose(input);
+		return 1;
+	}
+
+	uint32_t first = 0;
+	if (argc > 2){
+		uint32_t lastN = (uint32_t)atoi(argv[2]);
+		if (lastN < header.count){
+			first = header.count - lastN;
+			fseek(input, (long)(first * sizeof(struct TraceRecord)), SEEK_CUR);
+		}
+	}
+
+	struct TraceRecord record;
+	uint8_t ccrBefore = 0;
+	for(uint32_t i = first; i < header.count; i++){
+		if (fread(&record, sizeof(record), 1, input) != 1){
+			printf("Trace truncated at record %u\n", i);
+			break;
+		}
+		printf("%10llu  %04x  %04x %04x %04x ", (unsigned long long)record.cycle, record.pc, record.opcode[0], record.opcode[1], record.opcode[2]);
+		for(int r = 0; r < 8; r++){
+			if (record.changedRegisters & (1 << r)){
+				printf(" ER%d=%08x", r, record.registers[r]);
+			}
+		}
+		for(int w = 0; w < record.writeCount; w++){
+			switch(record.writes[w].size){
+				case 1:{
+					printf(" [%06x]=%02x", record.writes[w].address, record.writes[w].value);
+				}break;
+				case 2:{
+					printf(" [%06x]=%04x", record.writes[w].address, record.writes[w].value);
+				}break;
+				default:{
+					printf(" [%06x]=%08x", record.writes[w].address, record.writes[w].value);
+				}break;
+			}
+		}
+		if (i == first || record.ccr != ccrBefore){
+			printf(" CCR=%c%c%c%c%c%c%c%c",
+					(record.ccr & 0x80) ? 'I' : '-', (record.ccr & 0x40) ? 'U' : '-', (record.ccr & 0x20) ? 'H' : '-', (record.ccr & 0x10) ? 'U' : '-',
+					(record.ccr & 0x08) ? 'N' : '-', (record.ccr & 0x04) ? 'Z' : '-', (record.ccr & 0x02) ? 'V' : '-', (record.ccr & 0x01) ? 'C' : '-');
+		}
+		ccrBefore = record.ccr;
+		printf("\n");
+	}
+	fclose(input);
+	return 0;
+}
@@ -0,0 +1,26 @@
+#include <string.h>
+
+#include "tripleBuffer.h"
+
+void initTripleBuffer(struct TripleBuffer* buffer){
+	memset(buffer->frames, 0, sizeof(buffer->frames));
+	buffer->back = 0;
+	buffer->middle = 1;
+	buffer->front = 2;
+}
+
+uint32_t* getBackFrame(struct TripleBuffer* buffer){
+	return buffer->frames[buffer->back];
+}
+
+void publishFrame(struct TripleBuffer* buffer){
+	buffer->back = atomicExchange(&buffer->middle, buffer->back | TRIPLE_BUFFER_FRESH) & 3;
+}
+
+uint32_t* takeFrame(struct TripleBuffer* buffer){
+	if (!(atomicLoad(&buffer->middle) & TRIPLE_BUFFER_FRESH)){
+		return NULL;
+	}
+	buffer->front = atomicExchange(&buffer->middle, buffer->front) & 3;
+	return buffer->frames[buffer->front];
+}
@@ -0,0 +1,23 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "atomics.h"
+#include "walker.h"
+
+// Hands finished frames from the emulation thread to the presentation thread without locks.
+// The writer always has a buffer to draw into and the reader always keeps the last frame it took,
+// the third one sits in the middle holding the newest published frame. Neither side ever waits.
+// A frame the reader didn't get to in time gets replaced by the next one.
+struct TripleBuffer{
+	uint32_t frames[3][LCD_WIDTH * LCD_HEIGHT];
+	AtomicU32 middle; // Index of the middle buffer, TRIPLE_BUFFER_FRESH set while it holds a frame the reader hasn't taken
+	uint32_t back; // Only used by the writer
+	uint32_t front; // Only used by the reader
+};
+#define TRIPLE_BUFFER_FRESH 4
+
+void initTripleBuffer(struct TripleBuffer* buffer);
+uint32_t* getBackFrame(struct TripleBuffer* buffer); // Writer: buffer for the next frame
+void publishFrame(struct TripleBuffer* buffer); // Writer: the back frame is complete
+uint32_t* takeFrame(struct TripleBuffer* buffer); // Reader: the newest frame, NULL if nothing was published since the last call. Stays valid until the next successful call
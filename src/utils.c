@@ -1,7 +1,10 @@
 #include <stdio.h>
 void dumpArrayToFile(void* array, size_t size, char* fileName){
-	FILE* fileToWrite;
-	fopen_s(&fileToWrite, fileName,"wb");
+	FILE* fileToWrite = fopen(fileName, "wb");
+	if (!fileToWrite){
+		printf("Can't write %s\n", fileName);
+		return;
+	}
 	fwrite(array, 1, size, fileToWrite);
 	fclose(fileToWrite);
 }
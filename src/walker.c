@@ -5,15 +5,20 @@
 #include <memory.h>
 #include <string.h>
 #include <assert.h>
+#include <stdarg.h>
 
 #include "definitions.h"
 #include "walker.h"
 #include "queue.h"
+#include "trace.h"
+#include "addressSpace.h"
+#include "lcdDecode.h"
 #include "utils.c"
 #include "regRef.h"
 
 // Walker variables
-static struct Queue inputQueue;
+static struct Queue inputQueue; // Only touched by the emulation thread
+static struct Queue keyQueue; // setKeys -> processKeys, the only state shared with the frontend thread
 static uint8_t quartersEllapsed;
 static uint64_t subClockCyclesEllapsed;
 static struct TimerB_t TimerB;
@@ -29,6 +34,8 @@ static uint8_t* IRQ_IRR2; // Interrupt flag register 2
 static uint8_t* RTCFLG; // RTC Interrupt Flag Register
 static uint16_t interruptSavedAddress;
 static struct Flags_t interruptSavedFlags;
+static uint32_t interruptsTaken;
+static uint8_t pendingInterrupts; // Bit n set -> INTERRUPT_SOURCES n is requested and enabled. Always 0 while flags.I is set
 static uint32_t* ER[8]; // General purpose registers
 static uint16_t* R[8];
 static uint16_t* E[8];
@@ -36,11 +43,24 @@ static uint8_t* RL[8];
 static uint8_t* RH[8];
 static uint32_t* SP;
 static uint8_t* memory;
+static struct MmioPage_t mmioPages[3]; // 0xF020 - 0xF0FF, 0xFF80 - 0xFFFF, RAM pages watched by memo.c
+static uint8_t pageMmio[ADDRESS_SPACE_SIZE / PAGE_SIZE]; // 0 for plain RAM/ROM pages, otherwise 1 + index in mmioPages
 static struct SSU_t SSU;
 static struct Accelerometer_t accel;
 static struct Eeprom_t eeprom;
 static struct Lcd_t lcd;
+static struct LcdDecoder lcdDecoder; // Set up with the default palette by initWalker
+static uint32_t decodedLcdBuffers[2][LCD_WIDTH * LCD_HEIGHT]; // fillVideoBufferDirty's copy of each LCD buffer, up to date except for the dirty spans
+static int lastDirtyBuffer; // Buffer fillVideoBufferDirty returned last time, -1 if none
+static void (*frameCallback)(); // Frontend's, called when the ROM completes a frame
 static bool sleep;
+static struct Hook_t hooks[MAX_HOOKS];
+static int hookCount;
+static uint32_t hookBitmap[ROM_SIZE / 32]; // One bit per ROM address, set if there's at least one hook for it
+static int hookResumeIndex = -1; // First hook left to run at hookResumeAddress when the fast core handed over to the instrumented one, -1 if none
+static uint16_t hookResumeAddress;
+static uint64_t cyclesRun; // Never reset, unlike the frontend's cycleCount
+static bool printingState;
 
 uint8_t clearBit8(uint8_t operand, int bit){
 	return operand & ~(1 << bit);			
@@ -69,34 +89,54 @@ struct RegRef32 getRegRef32(uint8_t operand){
 	return newRef;
 }
 
+// Text tracing, only compiled into the instrumented core and only printed after setPrintState(true). It's slow, setTracing() is much cheaper.
 void printRegistersState(){
-#ifdef PRINT_STATE
+	if (!printingState){
+		return;
+	}
 	for(int i=0; i < 8; i++){
 		printf("ER%d: [0x%08X], ", i, *ER[i]); 
 	}
 	printf("\n");
 	printf("I: %d, H: %d, N: %d, Z: %d, V: %d, C: %d ", flags.I, flags.H, flags.N, flags.Z, flags.V, flags.C);
 	printf("\n\n");
-#endif
-
 }
 
 void printMemory(uint32_t address, int byteCount){
-#ifdef PRINT_STATE
-	address = address & 0x0000ffff; // Keep lower 16 bits only
+	if (!printingState){
+		return;
+	}
+	address = address & ADDRESS_MASK;
 	for(int i = 0; i < byteCount; i++){ 
 		printf("MEMORY - 0x%04x -> %02x\n", address + i, memory[address + i]);
 	}
-#endif
 }
 
 void printInstruction(const char* format, ...){
-#ifdef PRINT_STATE
+	if (!printingState){
+		return;
+	}
 	va_list args;
 	va_start(args, format);
 	vprintf(format, args);
 	va_end(args);
-#endif
+}
+
+// Must be called every time flags.I or one of the interrupt flag/enable registers changes
+void updatePendingInterrupts(){
+	uint8_t pending = 0;
+	if ((*IRQ_IRR1 & IRRI0) && (*IRQ_IENR1 & IEN0)){
+		pending |= 1 << INTERRUPT_IRQ0;
+	}
+	if (*IRQ_IENR1 & IENRTC){
+		pending |= (*RTCFLG & _025SEIFG) ? (1 << INTERRUPT_RTC_QUARTER_SEC) : 0;
+		pending |= (*RTCFLG & _05SEIFG) ? (1 << INTERRUPT_RTC_HALF_SEC) : 0;
+		pending |= (*RTCFLG & _1SEIFG) ? (1 << INTERRUPT_RTC_EVERY_SEC) : 0;
+	}
+	if ((*IRQ_IRR2 & IRRTB1) && (*IRQ_IENR2 & IENTB1)){
+		pending |= 1 << INTERRUPT_TIMER_B1;
+	}
+	pendingInterrupts = flags.I ? 0 : pending;
 }
 
 void setFlags(uint8_t value){
@@ -108,55 +148,537 @@ void setFlags(uint8_t value){
 	flags.H = value & (1<<5);
 	flags.UI = value & (1<<6);
 	flags.I = value & (1<<7);
+	updatePendingInterrupts();
+}
+
+uint8_t getFlags(){
+	return flags.C | (flags.V << 1) | (flags.Z << 2) | (flags.N << 3) | (flags.U << 4) | (flags.H << 5) | (flags.UI << 6) | (flags.I << 7);
+}
+
+void getRegisters(uint32_t* registers){
+	for(int i = 0; i < 8; i++){
+		registers[i] = *ER[i];
+	}
+}
+
+uint16_t getPc(){
+	return pc;
 }
 
 void fillVideoBuffer(uint32_t* videoBuffer){
-	for(int y = 0; y < LCD_HEIGHT; y++){
-		for(int x = 0; x < LCD_WIDTH; x++){
-			int yOffsetStripe = y%8;
-			uint8_t firstBitForX = (lcd.memory[2*x + lcd.currentBuffer*LCD_WIDTH*LCD_BUFFER_SEPARATION + (y/8)*LCD_WIDTH*LCD_BYTES_PER_STRIPE] & (1<<yOffsetStripe)) >> yOffsetStripe;
-			uint8_t secondBitForX = (lcd.memory[2*x + lcd.currentBuffer*LCD_WIDTH*LCD_BUFFER_SEPARATION + (y/8)*LCD_WIDTH*LCD_BYTES_PER_STRIPE + 1] & (1<<yOffsetStripe)) >> yOffsetStripe;
-			uint8_t paletteIdx = firstBitForX  << 1| secondBitForX;
-			uint32_t color = palette[paletteIdx];
-			videoBuffer[y*LCD_WIDTH + x] = color;
+	decodeLcdImage(&lcdDecoder, lcd.memory + lcd.currentBuffer*LCD_WIDTH*LCD_BUFFER_SEPARATION, LCD_WIDTH, LCD_HEIGHT, videoBuffer, LCD_WIDTH);
+	lcd.changed = false;
+}
+
+void fillVideoBufferFormat(void* videoBuffer, enum LcdPixelFormat format, int stride){
+	decodeLcdImageFormat(&lcdDecoder, lcd.memory + lcd.currentBuffer*LCD_WIDTH*LCD_BUFFER_SEPARATION, LCD_WIDTH, LCD_HEIGHT, format, videoBuffer, stride);
+	lcd.changed = false;
+}
+
+// Brings the decoded copy of an LCD buffer up to date, returns true if any of it had to be decoded again
+bool decodeDirtySpans(int buffer){
+	bool decoded = false;
+	for(int page = 0; page < LCD_PAGES; page++){
+		int memoryPage = buffer*LCD_WIDTH*LCD_BUFFER_SEPARATION/LCD_PAGE_SIZE + page;
+		uint8_t spans = lcd.dirtySpans[memoryPage];
+		while (spans){
+			int firstSpan = countTrailingZeros(spans);
+			int lastSpan = firstSpan;
+			while (spans & (1 << (lastSpan + 1))){ // Consecutive spans in a single call
+				lastSpan += 1;
+			}
+			spans &= ~(((2 << lastSpan) - 1) & ~((1 << firstSpan) - 1));
+			int lastColumn = (lastSpan + 1) * LCD_DIRTY_SPAN;
+			decodeLcdPage(&lcdDecoder, lcd.memory + memoryPage*LCD_PAGE_SIZE, firstSpan * LCD_DIRTY_SPAN, lastColumn < LCD_WIDTH ? lastColumn : LCD_WIDTH,
+				decodedLcdBuffers[buffer] + page*8*LCD_WIDTH, LCD_WIDTH);
+			decoded = true;
 		}
+		lcd.dirtySpans[memoryPage] = 0;
 	}
-	lcd.currentBuffer = lcd.currentBuffer ? 0 : 1;
+	return decoded;
 }
 
-// With masking here we're ignoring the 0x00XX0000 part of the address for this emulator, as we have one big memory block that goes up to 0xFFFF
+bool fillVideoBufferDirty(uint32_t* videoBuffer){
+	int buffer = lcd.currentBuffer;
+	lcd.changed = false;
+	bool changed = decodeDirtySpans(buffer);
+	if (buffer != lastDirtyBuffer){
+		changed = lastDirtyBuffer < 0 || memcmp(decodedLcdBuffers[buffer], decodedLcdBuffers[lastDirtyBuffer], sizeof(decodedLcdBuffers[0])) != 0;
+		lastDirtyBuffer = buffer;
+	}
+	if (changed){
+		memcpy(videoBuffer, decodedLcdBuffers[buffer], sizeof(decodedLcdBuffers[0]));
+	}
+	return changed;
+}
+
+bool lcdChanged(){
+	return lcd.changed;
+}
+
+void setFrameCallback(void (*callback)()){
+	frameCallback = callback;
+}
+
+uint64_t getCycleCount(){
+	return cyclesRun;
+}
+
+const uint32_t* getLcdPalette(){
+	return lcdDecoder.palette;
+}
+
+// 'memory' is a view of the whole 24 bit address space with the 64KB block mirrored at 0x000000 and 0xFF0000 (see addressSpace.h),
+// so the only masking left is the one the CPU's 24 bit address bus does.
+// Accesses to MMIO pages are split into bytes so that every register goes through its handler
 void setMemory8(uint32_t address, uint8_t value){
-	address = address & 0x0000ffff; // Keep lower 16 bits only
+	address = address & ADDRESS_MASK;
+	uint8_t mmio = pageMmio[address >> 8];
+	if (mmio && mmioPages[mmio - 1].write[address & 0xff]){
+		mmioPages[mmio - 1].write[address & 0xff](address, value);
+		return;
+	}
 	memory[address] = value; 
 }
 
 void setMemory16(uint32_t address, uint16_t value){
-	address = address & 0x0000ffff; // Keep lower 16 bits only
-	memory[address] = value >> 8; 
-	memory[address + 1] = value & 0xFF; 
+	address = address & ADDRESS_MASK;
+	uint8_t mmio = pageMmio[address >> 8];
+	if (mmio && (mmioPages[mmio - 1].write[address & 0xff] || mmioPages[mmio - 1].write[(address + 1) & 0xff])){
+		setMemory8(address, value >> 8);
+		setMemory8(address + 1, value & 0xFF);
+		return;
+	}
+	value = byteSwap16(value);
+	memcpy(memory + address, &value, 2);
 }
 
 void setMemory32(uint32_t address, uint32_t value){
-	address = address & 0x0000ffff; // Keep lower 16 bits only
-	memory[address] = value >> 24; 
-	memory[address + 1] = (value >> 16) & 0xFF; 
-	memory[address + 2] = (value >> 8) & 0xFF; 
-	memory[address + 3] = value & 0xFF; 
+	address = address & ADDRESS_MASK;
+	if (pageMmio[address >> 8] || pageMmio[((address + 3) & ADDRESS_MASK) >> 8]){
+		setMemory16(address, value >> 16);
+		setMemory16(address + 2, value & 0xFFFF);
+		return;
+	}
+	value = byteSwap32(value);
+	memcpy(memory + address, &value, 4);
 }
 
 uint16_t getMemory8(uint32_t address){
-	address = address & 0x0000ffff; // Keep lower 16 bits only
-	return (uint8_t)(memory[address]);
+	address = address & ADDRESS_MASK;
+	uint8_t mmio = pageMmio[address >> 8];
+	if (mmio && mmioPages[mmio - 1].read[address & 0xff]){
+		return mmioPages[mmio - 1].read[address & 0xff](address);
+	}
+	return memory[address];
 }
 
 uint16_t getMemory16(uint32_t address){
-	address = address & 0x0000ffff; // Keep lower 16 bits only
-	return (uint16_t)((memory[address] << 8) | (memory[address + 1]));
+	address = address & ADDRESS_MASK;
+	uint8_t mmio = pageMmio[address >> 8];
+	if (mmio && (mmioPages[mmio - 1].read[address & 0xff] || mmioPages[mmio - 1].read[(address + 1) & 0xff])){
+		return (uint16_t)((getMemory8(address) << 8) | getMemory8(address + 1));
+	}
+	uint16_t value;
+	memcpy(&value, memory + address, 2);
+	return byteSwap16(value);
 }
 
 uint32_t getMemory32(uint32_t address){
-	address = address & 0x0000ffff; // Keep lower 16 bits only
-	return (uint32_t)((memory[address] << 24) | (memory[address + 1] << 16) | (memory[address + 2] << 8) | memory[address + 3]);
+	address = address & ADDRESS_MASK;
+	if (pageMmio[address >> 8] || pageMmio[((address + 3) & ADDRESS_MASK) >> 8]){
+		return (uint32_t)((getMemory16(address) << 16) | getMemory16(address + 2));
+	}
+	uint32_t value;
+	memcpy(&value, memory + address, 4);
+	return byteSwap32(value);
+}
+
+// The SSU shifts a whole byte at once: starting a transfer just schedules its completion, which the core
+// checks against cyclesRun after every instruction
+uint32_t ssuByteCycles(){
+	uint8_t cks = *SSU.SSMR & SSMR_CKS;
+	uint32_t divisor = cks ? (2 << cks) : 4; // 000 is reserved, treat it like φ/4
+	return 8 * divisor;
+}
+
+void scheduleSsuTransfer(){
+	if ((*SSU.SSER & (TE | RE)) == RE){
+		SSU.completionCycle = cyclesRun; // Receive only mode isn't implemented, have the core bail out
+	}
+	else if (~*SSU.SSER & TE){
+		*SSU.SSSR |= TDRE;
+		SSU.completionCycle = SSU_IDLE;
+	}
+	else if ((~*SSU.SSSR & TDRE) && SSU.completionCycle == SSU_IDLE){
+		SSU.completionCycle = cyclesRun + ssuByteCycles();
+	}
+}
+
+// MMIO handlers
+uint8_t readSSRDR(uint16_t address){
+	*SSU.SSSR = clearBit8(*SSU.SSSR, 1); // RDRF
+	return memory[address];
+}
+
+void writeSSTDR(uint16_t address, uint8_t value){
+	memory[address] = value;
+	*SSU.SSSR = clearBit8(*SSU.SSSR, 2); // TDRE
+	*SSU.SSSR = clearBit8(*SSU.SSSR, 3); // TEND
+	scheduleSsuTransfer();
+}
+
+void writeSSERorSSSR(uint16_t address, uint8_t value){
+	memory[address] = value;
+	scheduleSsuTransfer();
+}
+
+void writeTLB1(uint16_t address, uint8_t value){
+	memory[address] = value;
+	TimerB.TLBvalue = value;
+}
+
+void writeInterruptFlags(uint16_t address, uint8_t value){
+	memory[address] = value;
+	updatePendingInterrupts();
+}
+
+// Manual 3.8.4: an interrupt requested before the instruction that clears its enable bit is still taken after it.
+// Its pending bit stays set until the core checks for interrupts at the end of this instruction.
+void writeInterruptEnable(uint16_t address, uint8_t value){
+	uint8_t pendingBefore = pendingInterrupts;
+	memory[address] = value;
+	updatePendingInterrupts();
+	pendingInterrupts |= pendingBefore;
+}
+
+void setMmioHandlers(uint16_t address, uint8_t (*read)(uint16_t address), void (*write)(uint16_t address, uint8_t value)){
+	assert(pageMmio[address >> 8]); // Not an MMIO page
+	struct MmioPage_t* page = &mmioPages[pageMmio[address >> 8] - 1];
+	page->read[address & 0xff] = read;
+	page->write[address & 0xff] = write;
+}
+
+// SSU bus
+void updateSelectedDevice(){
+	SSU.selectedDevice = NULL;
+	for(int i = 0; i < SSU.deviceCount; i++){
+		if (SSU.devices[i]->selected){
+			SSU.selectedDevice = SSU.devices[i];
+			break;
+		}
+	}
+}
+
+// Chip selects are edge triggered: devices only get notified when their pin changes
+void writeChipSelectPort(uint16_t address, uint8_t value){
+	uint8_t changed = memory[address] ^ value;
+	memory[address] = value;
+	if (!changed){
+		return;
+	}
+	for(int i = 0; i < SSU.deviceCount; i++){
+		struct SsuDevice* device = SSU.devices[i];
+		if (device->chipSelectPort != address || !(changed & device->chipSelectPin)){
+			continue;
+		}
+		device->selected = !(value & device->chipSelectPin);
+		if (device->selected && device->select){
+			device->select(device);
+		}
+		else if (!device->selected && device->deselect){
+			device->deselect(device);
+		}
+	}
+	updateSelectedDevice();
+}
+
+bool attachSsuDevice(struct SsuDevice* device){
+	if (SSU.deviceCount == MAX_SSU_DEVICES){
+		printf("Can't attach %s, the SSU bus is full\n", device->name);
+		return false;
+	}
+	SSU.devices[SSU.deviceCount++] = device;
+	setMmioHandlers(device->chipSelectPort, NULL, writeChipSelectPort);
+	device->selected = !(memory[device->chipSelectPort] & device->chipSelectPin);
+	updateSelectedDevice();
+	return true;
+}
+
+void detachSsuDevice(struct SsuDevice* device){
+	for(int i = 0; i < SSU.deviceCount; i++){
+		if (SSU.devices[i] == device){
+			memmove(&SSU.devices[i], &SSU.devices[i + 1], (SSU.deviceCount - i - 1) * sizeof(SSU.devices[0]));
+			SSU.deviceCount -= 1;
+			break;
+		}
+	}
+	updateSelectedDevice();
+}
+
+// Called by the core once cyclesRun reaches SSU.completionCycle. Returns false if the SSU is in a mode we don't emulate
+bool ssuTransferByte(){
+	if ((*SSU.SSER & (TE | RE)) == RE){
+		return false; // TODO: Check if this mode is used in the ROM
+	}
+	SSU.completionCycle = SSU_IDLE;
+	uint8_t received = 0xFF; // Nothing drives the line
+	if (SSU.selectedDevice){
+		received = SSU.selectedDevice->transfer(SSU.selectedDevice, *SSU.SSTDR);
+	}
+	if (*SSU.SSER & RE){
+		*SSU.SSRDR = received;
+		*SSU.SSSR |= RDRF;
+	}
+	*SSU.SSSR |= TDRE | TEND;
+	return true;
+}
+
+// Built-in SSU devices
+uint8_t eepromTransfer(struct SsuDevice* device, uint8_t data){
+	(void)device; // Single instance, the state is global
+	uint8_t received = 0xFF;
+	switch(eeprom.buffer.state){
+		case EEPROM_EMPTY:{
+			switch(data){
+				case EEPROM_READ:
+				case EEPROM_WRITE:{
+					eeprom.buffer.command = data;
+					eeprom.buffer.state = EEPROM_GETTING_ADDRESS_HI;
+				} break;
+				case EEPROM_RDSR:{
+					eeprom.buffer.state = EEPROM_GETTING_STATUS_REGISTER;
+				} break;
+				case EEPROM_WREN:{
+					eeprom.status |= 0x2; // WEL - write enable latch. Note: I dont see any WRDI or WRSR instructions in the ROM that disable this latch, could cause issues later on
+				} break;
+			}
+		} break;
+		case EEPROM_GETTING_STATUS_REGISTER:{
+			received = eeprom.status;
+		} break;
+		case EEPROM_GETTING_ADDRESS_HI:{
+			eeprom.buffer.hiAddress = data;
+			eeprom.buffer.state = EEPROM_GETTING_ADDRESS_LO;
+		} break;
+		case EEPROM_GETTING_ADDRESS_LO:{
+			eeprom.buffer.loAddress = data;
+			eeprom.buffer.state = EEPROM_GETTING_BYTES;
+		} break;
+		case EEPROM_GETTING_BYTES:{
+			uint16_t address = ((eeprom.buffer.hiAddress << 8) | eeprom.buffer.loAddress) + eeprom.buffer.offset;
+			if (eeprom.buffer.command == EEPROM_READ){
+				received = eeprom.memory[address];
+				eeprom.buffer.offset += 1;
+			}
+			else{
+				eeprom.memory[address] = data;
+				eeprom.buffer.offset = (eeprom.buffer.offset + 1) % EEPROM_PAGE_SIZE;
+			}
+		} break;
+	}
+	return received;
+}
+
+void eepromDeselect(struct SsuDevice* device){
+	(void)device; // Single instance, the state is global
+	eeprom.buffer.state = EEPROM_EMPTY;
+	eeprom.buffer.offset = 0x0;
+}
+
+uint8_t accelTransfer(struct SsuDevice* device, uint8_t data){
+	(void)device; // Single instance, the state is global
+	uint8_t received = 0xFF;
+	switch(accel.buffer.state){
+		case ACCEL_GETTING_ADDRESS:{
+			accel.buffer.address = data & 0x7F; // The "&" removes 0x80 (RW flag, not part of the address)
+			accel.buffer.reading = data & 0x80;
+			accel.buffer.offset = 0;
+			accel.buffer.state = ACCEL_GETTING_BYTES;
+		}break;
+		case ACCEL_GETTING_BYTES:{
+			uint8_t address = (accel.buffer.address + accel.buffer.offset) % ACCEL_MEM_SIZE;
+			if (accel.buffer.reading){
+				received = accel.memory[address];
+				accel.buffer.offset += 1;
+			}
+			else{
+				accel.memory[address] = data;
+			}
+		}break;
+	}
+	return received;
+}
+
+void accelDeselect(struct SsuDevice* device){
+	(void)device; // Single instance, the state is global
+	accel.buffer.state = ACCEL_GETTING_ADDRESS;
+	accel.buffer.offset = 0x0;
+}
+
+void lcdFrameComplete(){
+	lcd.framesCompleted += 1;
+	if (frameCallback){
+		frameCallback();
+	}
+}
+
+uint8_t lcdTransfer(struct SsuDevice* device, uint8_t data){
+	(void)device; // Single instance, the state is global
+	if (memory[PORT1] & LCD_DATA_PIN){ // Display data
+		size_t lcdMemIndex = (lcd.currentPage * LCD_WIDTH * LCD_BYTES_PER_STRIPE) + lcd.currentColumn*LCD_BYTES_PER_STRIPE + lcd.currentByte; // Always < LCD_MEM_SIZE, page and column are 4 and 8 bits
+		if (lcd.memory[lcdMemIndex] != data){
+			lcd.memory[lcdMemIndex] = data;
+			lcd.dirtySpans[lcdMemIndex / LCD_PAGE_SIZE] |= 1 << ((lcdMemIndex % LCD_PAGE_SIZE) / LCD_BYTES_PER_STRIPE / LCD_DIRTY_SPAN);
+			lcd.changed = true;
+		}
+		if (lcd.currentByte == 1){
+			// The last byte of a buffer's bottom page ends a full sweep. Once the ROM picks the buffer on screen
+			// with the start line, finishing the hidden one isn't a new frame, the start line switch will be
+			bool lastPage = (lcd.currentPage % LCD_PAGES) == LCD_PAGES - 1;
+			if (lastPage && lcd.currentColumn == LCD_WIDTH - 1 && (!lcd.startLineSet || lcd.currentPage / LCD_PAGES == lcd.currentBuffer)){
+				lcdFrameComplete();
+			}
+			lcd.currentColumn = (lcd.currentColumn + 1);
+		}
+		lcd.currentByte = (lcd.currentByte + 1) % 2;
+		return 0xFF;
+	}
+	// Command
+	switch(lcd.state){
+		case LCD_EMPTY:{
+			switch(data){
+				case 0x00:
+				case 0x01:
+				case 0x02:
+				case 0x03:
+				case 0x04:
+				case 0x05:
+				case 0x06:
+				case 0x07:
+				case 0x08:
+				case 0x09:
+				case 0x0A:
+				case 0x0B:
+				case 0x0C:
+				case 0x0D:
+				case 0x0E:
+				case 0x0F:{
+					lcd.currentColumn = (data & 0xF) | (lcd.currentColumn & 0xF0); // Set lower column address
+					lcd.currentByte = 0;
+				}break;
+				case 0x10:
+				case 0x11:
+				case 0x12:
+				case 0x13:
+				case 0x14:
+				case 0x15:
+				case 0x16:
+				case 0x17:{
+					lcd.currentColumn = ((data & 0b111) << 4) | (lcd.currentColumn & 0xF); // Set upper column address
+					lcd.currentByte = 0;
+				} break;
+				case 0xB0:
+				case 0xB1:
+				case 0xB2:
+				case 0xB3:
+				case 0xB4:
+				case 0xB5:
+				case 0xB6:
+				case 0xB7:
+				case 0xB8:
+				case 0xB9:
+				case 0xBA:
+				case 0xBB:
+				case 0xBC:
+				case 0xBD:
+				case 0xBE:
+				case 0xBF:{
+					lcd.currentPage = data & 0xF;
+				}break;
+				case 0x40:{ // Display start line, the line follows in the next byte
+					lcd.state = LCD_READING_START_LINE;
+				} break;
+				case 0x81:{
+					lcd.state = LCD_READING_CONTRAST;
+				} break;
+				default:{
+					// We'll ignore most commands
+				} break;
+			}
+		} break;
+		case LCD_READING_CONTRAST:{
+			lcd.contrast = data;
+			lcd.state = LCD_EMPTY;
+		}break;
+		case LCD_READING_START_LINE:{
+			// The ROM flips between the buffers by starting the display at the first line of one or the other
+			lcd.startLine = data & 0x7F;
+			lcd.startLineSet = true;
+			lcd.currentBuffer = (lcd.startLine / LCD_HEIGHT) & 1;
+			lcd.state = LCD_EMPTY;
+			lcdFrameComplete();
+		}break;
+	}
+	return 0xFF;
+}
+
+static struct SsuDevice accelDevice = {.name = "Accelerometer", .chipSelectPort = PORT9, .chipSelectPin = ACCEL_PIN, .deselect = accelDeselect, .transfer = accelTransfer};
+static struct SsuDevice eepromDevice = {.name = "EEPROM", .chipSelectPort = PORT1, .chipSelectPin = EEPROM_PIN, .deselect = eepromDeselect, .transfer = eepromTransfer};
+static struct SsuDevice lcdDevice = {.name = "LCD", .chipSelectPort = PORT1, .chipSelectPin = LCD_PIN, .transfer = lcdTransfer};
+
+#include "memo.c"
+
+// Used by the instrumented core in place of setMemoryXX/getMemoryXX
+void tracedSetMemory8(uint32_t address, uint8_t value){
+	setMemory8(address, value);
+	if (traceEnabled){
+		traceMemoryWrite(address & ADDRESS_MASK, value, 1);
+	}
+	if (memoRecording.active){
+		memoRecordWrite(address, 1);
+	}
+}
+
+void tracedSetMemory16(uint32_t address, uint16_t value){
+	setMemory16(address, value);
+	if (traceEnabled){
+		traceMemoryWrite(address & ADDRESS_MASK, value, 2);
+	}
+	if (memoRecording.active){
+		memoRecordWrite(address, 2);
+	}
+}
+
+void tracedSetMemory32(uint32_t address, uint32_t value){
+	setMemory32(address, value);
+	if (traceEnabled){
+		traceMemoryWrite(address & ADDRESS_MASK, value, 4);
+	}
+	if (memoRecording.active){
+		memoRecordWrite(address, 4);
+	}
+}
+
+uint16_t tracedGetMemory8(uint32_t address){
+	if (memoRecording.active){
+		memoRecordRead(address, 1);
+	}
+	return getMemory8(address);
+}
+
+uint16_t tracedGetMemory16(uint32_t address){
+	if (memoRecording.active){
+		memoRecordRead(address, 2);
+	}
+	return getMemory16(address);
+}
+
+uint32_t tracedGetMemory32(uint32_t address){
+	if (memoRecording.active){
+		memoRecordRead(address, 4);
+	}
+	return getMemory32(address);
 }
 
 // Note: I considered using signed parameters here, but they get sign extended and screw up the carry calculations.
@@ -268,2595 +790,568 @@ void setFlagsMOV(uint32_t value, int numberOfBits){
 		}break;
 	}
 }
+// Called from the frontend, possibly on another thread. The key gets handled by processKeys on the emulation thread.
 void setKeys(uint8_t input){
-	// IRQ0 is generated on rising edge only!
-	if (!flags.I && (input & ENTER)){
-		*IRQ_IRR1 |= IRRI0;
-	}
-	else{
-		addElement(&inputQueue, input);
-		addElement(&inputQueue, 0); // Simulate key release
-		sleep = false;
+	addElement(&keyQueue, input); // A full queue drops the press
+}
+
+void processKeys(){
+	while(!isEmpty(&keyQueue)){
+		uint8_t input = popElement(&keyQueue);
+		// IRQ0 is generated on rising edge only!
+		if (!flags.I && (input & ENTER)){
+			*IRQ_IRR1 |= IRRI0;
+			updatePendingInterrupts();
+		}
+		else{
+			addElement(&inputQueue, input);
+			addElement(&inputQueue, 0); // Simulate key release
+			sleep = false;
+		}
 	}
 }
 
-void runSubClock(){
-	// Timer handling
-	if (TimerB.on && ((subClockCyclesEllapsed % 256) == 0)){ // TODO(custom ROMs): parameterize frequency
-		if(++(*TimerB.TCB1) == 0){
-			*IRQ_IRR2 |= IRRTB1;
-			*TimerB.TCB1 = TimerB.TLBvalue;
+// Used when there's no hooks.cfg in the working directory
+#include "hle.c"
+
+static const struct Hook_t defaultHooks[] = {
+	{0x0336, HOOK_SKIP, 0, 4}, // jsr factoryTestPerformIfNeeded:24
+	{0x0350, HOOK_SKIP, 0, 4}, // jsr checkBatteryForBelowGivenLevel:24
+	{0x0350, HOOK_SET_REG8, 0x8, 0}, // r0l = 0 -> battery OK
+	{0x7700, HOOK_SKIP, 0, 2}, // SLEEP during accelerometer, maybe needs an acc IRQ to work properly
+	{0x9b84, HOOK_INPUT, 0xffde, 0}, // Every time the ROM needs to read the current keys, pop an input from the input queue
+	{0x79b8, HOOK_POKE16, 0xf78e, STARTING_WATTS}, // Hack some watts in
+};
+
+bool addHook(struct Hook_t hook){
+	if (hookCount == MAX_HOOKS || hook.address >= ROM_SIZE){
+		return false;
+	}
+	if (hook.type == HOOK_MEMO){
+		int routine = addMemoRoutine(hook.address);
+		if (routine < 0){
+			return false;
 		}
+		hook.target = routine;
 	}
-	if (TimerW.on){ // Count every subclock
-		if(*TimerW.TMRW & CTS){
-			setMemory16(TCNT_ADDRESS, getMemory16(TCNT_ADDRESS) + 1); 
+	hooks[hookCount++] = hook;
+	hookBitmap[hook.address >> 5] |= (1u << (hook.address & 31));
+	return true;
+}
+
+bool addBreakpoint(uint16_t address){
+	struct Hook_t hook = {address, HOOK_BREAKPOINT, 0, 0};
+	return addHook(hook);
+}
+
+bool addHle(uint16_t address, const char* routineName){
+	int routine = findHleRoutine(routineName);
+	if (routine < 0){
+		printf("Unknown HLE routine %s\n", routineName);
+		return false;
+	}
+	struct Hook_t hook = {address, HOOK_HLE, routine, 0};
+	return addHook(hook);
+}
+
+bool addMemo(uint16_t address){
+	struct Hook_t hook = {address, HOOK_MEMO, 0, 0};
+	if (!addHook(hook)){
+		return false;
+	}
+	watchRamPages();
+	return true;
+}
+
+// Parses "rNh"/"rNl" into the register encoding used by getRegRef8
+int parseReg8(const char* name){
+	if ((name[0] != 'r' && name[0] != 'R') || name[1] < '0' || name[1] > '7'){
+		return -1;
+	}
+	switch(name[2]){
+		case 'h':
+		case 'H':{
+			return name[1] - '0';
 		}
-		if (getMemory16(TCNT_ADDRESS) == getMemory16(0xf0f8)){ // TCNT == GRA
-			if (*TimerW.TCRW & CCLR){
-				setMemory16(TCNT_ADDRESS, 0);
-			}
-			*TimerW.TSRW |= 0x1; // IMFA
-			if (*TimerW.TIERW & 0x1){ // IMIEA - Interrupt enabled A
-				if (!flags.I){
-					interruptSavedAddress = pc;
-					interruptSavedFlags = flags;
-					flags.I = true;
-					pc = VECTOR_TIMER_W;
-					sleep = false;
-				}
-			}
+		case 'l':
+		case 'L':{
+			return (name[1] - '0') | 0x8;
 		}
 	}
-
-	// have to do this so that we don't count the instructions from the first cycle the timer is on
-	// since it should count in parallell to CPU execution
-	TimerB.on = (*CKSTPR1 & TB1CKSTP) && (*TimerB.TMB1 & TMB_COUNTING);
-	TimerW.on = (*CKSTPR2 & TWCKSTP) && (*TimerW.TMRW & CTS);
+	return -1;
 }
 
-int runNextInstruction(uint64_t* cycleCount){
-	if (!sleep){
-		// Skip certain instructions
-		if (pc == 0x336){ // Factory Tests
-			pc += 4;
-			printInstruction("SKIP 0336 jsr factoryTestPerformIfNeeded:24\n");
-			return 0;
-		} if (pc == 0x350){ // Check battery
-			pc += 4;
-			printInstruction("SKIP 350 jsr checkBatteryForBelowGivenLevel:24\n");
-			*RL[0] = 0;
-			return 0;
+// File format, one hook per line, '#' starts a comment:
+//   skip   ADDRESS BYTES
+//   reg8   ADDRESS REGISTER VALUE     (REGISTER is r0h..r7l)
+//   input  ADDRESS PORT
+//   poke8  ADDRESS TARGET VALUE
+//   poke16 ADDRESS TARGET VALUE
+//   break  ADDRESS
+//   hle    ADDRESS ROUTINE            (ROUTINE is a name from hleRoutines)
+//   memo   ADDRESS
+bool loadHooks(const char* fileName){
+	FILE* hooksFile = fopen(fileName, "r");
+	if (!hooksFile){
+		return false;
+	}
+	char line[256];
+	int lineNumber = 0;
+	while(fgets(line, sizeof(line), hooksFile)){
+		lineNumber += 1;
+		char* comment = strchr(line, '#');
+		if (comment){
+			*comment = '\0';
 		}
-		if (pc == 0x7700) { // SLEEP during accelerometer, maybe needs an acc IRQ to work properly
-			pc += 2;
-			return 0;
+		char type[16];
+		char registerName[8];
+		char routineName[32];
+		unsigned int address = 0, target = 0, value = 0;
+		struct Hook_t hook = {0};
+		bool valid = false;
+		if (sscanf(line, "%15s", type) != 1){
+			continue; // Empty line
 		}
-		if (pc == 0x9b84) { // Every time the ROM needs to read the current keys, pop an input from the input queue
-			if (!isEmpty(&inputQueue)){
-				setMemory8(0xffde, popElement(&inputQueue));
+		// hook.target and hook.address are only filled in once the whole line parsed
+		if (strcmp(type, "skip") == 0){
+			if (sscanf(line, "%*s %x %u", &address, &value) == 2){
+				hook = (struct Hook_t){address, HOOK_SKIP, 0, value};
+				valid = true;
+			}
+		} else if (strcmp(type, "reg8") == 0){
+			if (sscanf(line, "%*s %x %7s %i", &address, registerName, &value) == 3 && parseReg8(registerName) >= 0){
+				hook = (struct Hook_t){address, HOOK_SET_REG8, parseReg8(registerName), value};
+				valid = true;
+			}
+		} else if (strcmp(type, "input") == 0){
+			if (sscanf(line, "%*s %x %x", &address, &target) == 2){
+				hook = (struct Hook_t){address, HOOK_INPUT, target, 0};
+				valid = true;
+			}
+		} else if (strcmp(type, "poke8") == 0 || strcmp(type, "poke16") == 0){
+			if (sscanf(line, "%*s %x %x %i", &address, &target, &value) == 3){
+				hook = (struct Hook_t){address, (type[4] == '8') ? HOOK_POKE8 : HOOK_POKE16, target, value};
+				valid = true;
+			}
+		} else if (strcmp(type, "break") == 0){
+			if (sscanf(line, "%*s %x", &address) == 1){
+				hook = (struct Hook_t){address, HOOK_BREAKPOINT, 0, 0};
+				valid = true;
+			}
+		} else if (strcmp(type, "hle") == 0){
+			if (sscanf(line, "%*s %x %31s", &address, routineName) == 2 && findHleRoutine(routineName) >= 0){
+				hook = (struct Hook_t){address, HOOK_HLE, findHleRoutine(routineName), 0};
+				valid = true;
+			}
+		} else if (strcmp(type, "memo") == 0){
+			if (sscanf(line, "%*s %x", &address) == 1){
+				hook = (struct Hook_t){address, HOOK_MEMO, 0, 0};
+				valid = true;
 			}
 		}
-		uint16_t* currentInstruction = (uint16_t*)(memory + pc);
-		// IMPROVEMENT: maybe just use pointers to the ROM, left this way cause it seems cleaner
-		uint16_t ab = (*currentInstruction << 8) | (*currentInstruction >> 8); // 0xbHbL aHaL -> aHaL bHbL
-
-		uint8_t a = ab >> 8;
-		uint8_t aH = (a >> 4) & 0xF; 
-		uint8_t aL = a & 0xF;
-
-		uint8_t b = ab & 0xFF;
-		uint8_t bH = (b >> 4) & 0xF;
-		uint8_t bL = b & 0xF;
-
-		uint16_t cd = (*(currentInstruction + 1) << 8) | (*(currentInstruction + 1) >> 8);
-		uint8_t c = cd >> 8;
-		uint8_t cH = (c >> 4) & 0xF; 
-		uint8_t cL = c & 0xF;
-
-		uint8_t d = cd & 0xFF;
-		uint8_t dH = (d >> 4) & 0xF;
-		uint8_t dL = d & 0xF;
-
-		uint16_t ef = (*(currentInstruction + 2) << 8) | (*(currentInstruction + 2) >> 8);
-		uint8_t e = ef >> 8;
-		uint8_t eH = (e >> 4) & 0xF; 
-		uint8_t eL = e & 0xF;
-
-		uint8_t f = ef & 0xFF;
-		uint8_t fH = (f >> 4) & 0xF;
-		uint8_t fL = f & 0xF;
-
-		uint32_t cdef = cd << 16 | ef;                     
-
-		if (pc == 0x79b8) { // Hack some watts in
-			setMemory16(0xf78e, STARTING_WATTS);
-		}		
-		if (pc == 0x9e76) { // Breakpoint for debugging
-			int x = 3;
+		if (!valid || !addHook(hook)){
+			printf("%s:%d: invalid hook\n", fileName, lineNumber);
 		}
-		switch(aH){
-			case 0x0:{
-				switch(aL){
-					case 0x0:{
-					printInstruction("%04x - NOP\n", pc);
-					}break;
-					case 0x1:{
-						switch(bH){ // NOTE. we're ignoring bL here, might not be necesary
-							case 0x0:{ // Lots of MOV.l type instructions and push.l + pop.l
-								switch(c){
-									case 0x6B:{
-										switch(dH){
-											case 0x0:{ // MOV.l @aa:16, Rd
-												uint32_t address = (ef & 0x0000FFFF) | 0x00FF0000; 
-												uint32_t value = getMemory32(address);
-
-												struct RegRef32 Rd = getRegRef32(dL);
-
-												setFlagsMOV(value, 32);
-												*Rd.ptr = value;
-
-												printInstruction("%04x - MOV.l @%x:16, ER%d\n", pc, address, Rd.idx); 
-												printRegistersState();
-
-											}break;
-
-											case 0x8:{ // MOV.l Rs, @aa:16 
-												uint32_t address = (cdef & 0x0000FFFF) | 0x00FF0000; 
-
-												struct RegRef32 Rs = getRegRef32(dL);
-
-												uint32_t value = *Rs.ptr;
-												setFlagsMOV(value, 32);
-												setMemory32(address, value);
-
-												printInstruction("%04x - MOV.l ER%d,@%x:16 \n", pc, Rs.idx, address); 
-												printMemory(address, 4);
-												printRegistersState();
-
-											}break;
-											default:{
-												return 1;
-											} break;
-										}
-										pc += 4;
-
-
-									}break;
-									case 0x6D:{ // MOV.l @ERs+, ERd --- MOV.l ERs, @-ERd
-										char incOrDec = (dH & 0b1000) ? '-' : '+';
-
-										if (incOrDec == '+'){
-											struct RegRef32 Rs = getRegRef32(dH);
-											struct RegRef32 Rd = getRegRef32(dL);
-
-											uint32_t value = getMemory32(*Rs.ptr);
-
-											*Rs.ptr += 4;
-
-											setFlagsMOV(value, 32);
-											*Rd.ptr = value;
-
-											printInstruction("%04x - MOV.l @ER%d+, ER%d\n", pc, Rs.idx, Rd.idx); 
-
-										} else{
-											struct RegRef32 Rs = getRegRef32(dL);
-											struct RegRef32 Rd = getRegRef32(dH);
-
-											*Rd.ptr -= 4;
-
-											uint32_t value = *Rs.ptr;
-											setMemory32(*Rd.ptr, value);
-											setFlagsMOV(value, 32);
-
-											printInstruction("%04x - MOV.l ER%d, @-ER%d, \n", pc, Rs.idx, Rd.idx); 
-											printMemory(*Rd.ptr, 4);
-
-										}
-										printRegistersState();
-										pc +=2;
-
-
-									} break;
-									case 0x6F:{ 
-										uint16_t disp = ef;
-										bool msbDisp = disp & 0x8000;
-										uint32_t signExtendedDisp = msbDisp ? (0xFFFF0000 | disp) : disp;
-
-										if (!(dH & 0b1000)){ // From memory @(d:16, ERs), ERd
-											struct RegRef32 Rs = getRegRef32(dH);
-											struct RegRef32 Rd = getRegRef32(dL);
+	}
+	fclose(hooksFile);
+	return true;
+}
 
-											uint32_t value = getMemory32(*Rs.ptr + signExtendedDisp); 
-											*Rd.ptr = value;
-											setFlagsMOV(value, 32);
-
-											printInstruction("%04x - MOV.l @(%d:16, ER%d), ER%d\n", pc, disp, Rs.idx, Rd.idx); 
-
-										} else{ // To memory  ERs, @(d:16,ERd) 
-											struct RegRef32 Rs = getRegRef32(dL);
-											struct RegRef32 Rd = getRegRef32(dH);
-
-											uint32_t value = *Rs.ptr;
-											setFlagsMOV(value, 32);
-
-
-											setMemory32(*Rd.ptr + signExtendedDisp, value);
-											printInstruction("%04x - MOV.l ER%d,@(%d:16, ER%d)\n", pc, Rs.idx, disp, Rd.idx); 
-											printMemory(*Rd.ptr + signExtendedDisp, 4);
-										}
-										printRegistersState();
-										pc+=4;
-									} break;
-									case 0x69:{ 
-										if (!(dH & 0x8)){ // MOV.L @ERs, ERd
-											struct RegRef32 Rs = getRegRef32(dH);
-											struct RegRef32 Rd = getRegRef32(dL);
-
-											uint32_t value = getMemory32(*Rs.ptr);
-
-											setFlagsMOV(value, 32);
-											*Rd.ptr = value;
-
-											printInstruction("%04x - MOV.l @ER%d, ER%d\n", pc, Rs.idx, Rd.idx ); 
-											printRegistersState();
-										} else{ // MOV.l ERs, @ERd 
-											struct RegRef32 Rs = getRegRef32(dL);
-											struct RegRef32 Rd = getRegRef32(dH);
-											uint32_t value = *Rs.ptr;
-											setFlagsMOV(value, 32);
-											setMemory32(*Rd.ptr, value);
-											printInstruction("%04x - MOV.l ER%d, @ER%d, \n", pc, Rs.idx, Rd.idx);
-											printMemory(*Rd.ptr, 4);
-										}
-										pc += 2;
-									}break;
-									case 0x66:{ // AND.L Rs, ERd
-										struct RegRef32 Rs = getRegRef32(dH);
-										struct RegRef32 Rd = getRegRef32(dL);
-
-										uint32_t value = *Rs.ptr;
-										uint32_t newValue = value & *Rd.ptr;
-
-										setFlagsMOV(newValue, 32);
-										*Rd.ptr = newValue;
-
-										printInstruction("%04x - AND.l R%d, ER%d\n", pc, Rs.idx, Rd.idx ); 
-										printRegistersState();
-
-										pc += 2;
-									}break;
-									case 0x64:{ // OR.L Rs, ERd
-										struct RegRef32 Rs = getRegRef32(dH);
-										struct RegRef32 Rd = getRegRef32(dL);
-
-										uint32_t value = *Rs.ptr;
-										uint32_t newValue = value | *Rd.ptr;
-
-										setFlagsMOV(newValue, 32);
-										*Rd.ptr = newValue;
-
-									printInstruction("%04x - OR.l R%d, ER%d\n", pc, Rs.idx, Rd.idx ); 
-										printRegistersState();
-
-										pc += 2;
-									}break;
-									case 0x65:{ // XOR.L Rs, ERd
-										struct RegRef32 Rs = getRegRef32(dH);
-										struct RegRef32 Rd = getRegRef32(dL);
-
-										uint32_t value = *Rs.ptr;
-										uint32_t newValue = value ^ *Rd.ptr;
-
-										setFlagsMOV(newValue, 32);
-										*Rd.ptr = newValue;
-
-										printInstruction("%04x - XOR.l R%d, ER%d\n", pc, Rs.idx, Rd.idx ); 
-										printRegistersState();
-
-										pc += 2;
-									}break;
-									default:{
-										return 1;
-									} break;
-
-
-								}
-
-							}break;
-							case 0x4:{
-								pc+=2;
-								if (bL == 0x0 && cH == 0x6){
-									switch(cL){
-										case 0x9:
-										case 0xB:
-										case 0xD:
-										case 0xF:{
-											uint8_t mostSignificantBit = dH >> 7;
-											if (mostSignificantBit == 0x1){
-												printInstruction("%04x - STC\n", pc);// Unused in the ROM
-											}else{
-												printInstruction("%04x - LDC\n", pc); // Unused in the ROM
-											}
-										}break;
-										default:{
-											return 1;
-										} break;
-
-									}
-								}
-							}break;
-							case 0x8:{
-								sleep = true;
-								printInstruction("%04x - SLEEP\n", pc); 
-							}break;
-							case 0xC:{
-								if (bL == 0x0 && cH == 0x5){
-									switch(cL){
-										case 0x0:{ // MULXS B Rs, Rd
-											struct RegRef8 Rs = getRegRef8(dH);
-											struct RegRef16 Rd = getRegRef16(dL);
-											int8_t lowerBitsRd = *Rd.ptr & 0x00FF;
-											*Rd.ptr = (int16_t)*Rs.ptr * (int16_t)lowerBitsRd; 
-											flags.Z = (*Rd.ptr == 0) ? 1 : 0;
-											flags.N = (*Rd.ptr & 0x8000) ? 1 : 0;
-
-											printInstruction("%04x - MULXS B r%d%c, %c%d\n", pc, Rs.idx, Rs.loOrHiReg, Rd.loOrHiReg, Rd.idx);
-											printRegistersState();
-											pc += 2;
-										} break;
-										case 0x2:{
-											// MULXS W Rs, Rd
-											struct RegRef16 Rs = getRegRef16(dH);
-											struct RegRef32 Rd = getRegRef32(dL);
-											int16_t lowerBitsRd = *Rd.ptr & 0x0000FFFF;
-											*Rd.ptr = (int32_t)*Rs.ptr * (int32_t)lowerBitsRd;
-											flags.Z = (*Rd.ptr == 0) ? 1 : 0;
-											flags.N = (*Rd.ptr & 0x80000000) ? 1 : 0;
-
-											printInstruction("%04x - MULXS W %c%d, er%d\n", pc, Rs.loOrHiReg, Rs.idx, Rd.idx);
-											printRegistersState();
-											pc += 2;
-										}break;
-										default:{
-											return 1;
-										} break;
-
-									}
-								};
-							}break;
-							case 0xD:{
-								if (bL == 0x0 && cH == 0x5){
-									switch(cL){ // TODO replace with if, and see if merging it with C & F makes it more readable
-										case 0x1:{ // DIVXS B Rs, Rd
-											struct RegRef8 Rs = getRegRef8(dH);
-											struct RegRef16 Rd = getRegRef16(dL);
-											int8_t quotient = (int16_t)*Rd.ptr / (int8_t)*Rs.ptr;
-											int8_t remainder = (int16_t)*Rd.ptr % (int8_t)*Rs.ptr; // Following C99 rules for the sign of quotient and remainder, the actual behaviour isnt really documented in the H800 manual
-											*Rd.ptr = (remainder << 8) | quotient;
-
-											flags.Z = (*Rs.ptr == 0) ? 1 : 0;
-											flags.N = (((int16_t)quotient) > 0) ? 0 : 1;
-
-											printInstruction("%04x - DIVXS B r%d%c, %c%d\n", pc, Rs.idx, Rs.loOrHiReg, Rd.loOrHiReg, Rd.idx);
-											printRegistersState();
-											pc += 2;
-										} break;
-										case 0x3:{ // DIVXS W Rs, Rd
-											struct RegRef16 Rs = getRegRef16(dH);
-											struct RegRef32 Rd = getRegRef32(dL);
-											int16_t quotient = (int32_t)*Rd.ptr / (int16_t)*Rs.ptr;
-											int16_t remainder = (int32_t)*Rd.ptr % (int16_t)*Rs.ptr; 
-											*Rd.ptr = (remainder << 16) | quotient;
-
-											flags.Z = (*Rs.ptr == 0) ? 1 : 0;
-											flags.N = (quotient & 0x80000000) ? 1 : 0;
-
-											printInstruction("%04x - DIVXU W %c%d, er%d\n", pc, Rs.loOrHiReg, Rs.idx, Rd.idx);
-											printRegistersState();
-											pc += 2;
-										}break;
-										default:{
-											return 1;
-										} break;
-
-									}
-								};
-							}break;
-							case 0xF:{
-								pc+=2;
-								if (bL == 0x0 && cH == 0x6){
-									switch(cL){ // TODO replace with if, and see if merging it with C & F makes it more readable
-										case 0x4:{
-											printInstruction("%04x - OR\n", pc);
-											return 1; // UNIMPLEMENTED
-										}break;
-										case 0x5:{
-											printInstruction("%04x - XOR\n", pc);
-											return 1; // UNIMPLEMENTED
-										}break;
-										case 0x6:{
-											printInstruction("%04x - AND\n", pc);
-											return 1; // UNIMPLEMENTED
-										}break;
-										default:{
-											return 1;
-										} break;
-
-									}
-								};
-							}break;
-
-							default:{
-								printInstruction("???\n");
-								return 1; // UNIMPLEMENTED
-							}break;
-
-						}
-					}break;
-					case 0x2:{
-						printInstruction("%04x - STC\n", pc); // Unused in the ROM
-						return 1; // UNIMPLEMENTED
-					}break;
-					case 0x3:{ // LDC.B Rs, CCR
-						struct RegRef8 Rs = getRegRef8(bL);
-						uint8_t value = *Rs.ptr;
-						setFlags(value);
-						printInstruction("%04x - LDC.B r%d%c, CCR\n", pc, Rs.idx, Rs.loOrHiReg);
-						printRegistersState();
-					}break;
-					case 0x4:{
-						printInstruction("%04x - ORC\n", pc);
-						return 1; // UNIMPLEMENTED
-					}break;
-					case 0x5:{
-						printInstruction("%04x - XORC\n", pc);
-						return 1; // UNIMPLEMENTED
-					}break;
-					case 0x6:{
-						printInstruction("%04x - ANDC\n", pc);
-						return 1; // UNIMPLEMENTED
-					}break;
-					case 0x7:{ // LDC.B #xx:8, CCR
-						uint8_t value = b;
-						setFlags(value);
-						printInstruction("%04x - LDC.B #%x:8, CCR\n", pc, value);
-						printRegistersState();
-					}break;
-					case 0x8:{ // ADD.B Rs, Rd
-						struct RegRef8 Rs = getRegRef8(bH);
-						struct RegRef8 Rd = getRegRef8(bL);
-
-						setFlagsADD(*Rd.ptr, *Rs.ptr, 8);
-						*Rd.ptr += *Rs.ptr;
-
-						printInstruction("%04x - ADD.b R%d%c,R%d%c\n", pc, Rs.idx, Rs.loOrHiReg, Rd.idx, Rd.loOrHiReg); 
-						printRegistersState();
-					}break;
-					case 0x9:{ // ADD.W Rs, Rd
-					struct RegRef16 Rs = getRegRef16(bH);
-					struct RegRef16 Rd = getRegRef16(bL);
-
-						setFlagsADD(*Rd.ptr, *Rs.ptr, 16);
-
-						*Rd.ptr += *Rs.ptr;
-						printInstruction("%04x - ADD.w %c%d,%c%d\n", pc, Rs.loOrHiReg, Rs.idx, Rd.loOrHiReg,  Rd.idx); 
-						printRegistersState();
-
-					}break;
-					case 0xA:{
-						switch(bH){
-							case 0x0:{ // INC.b Rd
-								struct RegRef8 Rd = getRegRef8(bL);
-								setFlagsINC(*Rd.ptr, 1, 8);
-								*Rd.ptr += 1;
-								printInstruction("%04x - INC.b r%d%c\n", pc, Rd.idx, Rd.loOrHiReg);
-								printRegistersState();
-							}break;
-							case 0x8:
-							case 0x9:
-							case 0xA:
-							case 0xB:
-							case 0xC:
-							case 0xD:
-							case 0xE:
-							case 0xF:{ // ADD.l ERs, ERd
-								struct RegRef32 Rs = getRegRef32(bH);
-								struct RegRef32 Rd = getRegRef32(bL);
-
-								setFlagsADD(*Rd.ptr, *Rs.ptr, 32);
-
-								*Rd.ptr += *Rs.ptr;
-								printInstruction("%04x - ADD.l ER%d, ER%d\n", pc, Rs.idx,  Rd.idx); 
-								printRegistersState();
-							}break;
-							default:{
-								return 1;
-							} break;
-						}
-					}break;
-					case 0xB:{ // ADDS and INC
-						switch(bH){
-							case 0x0:{ // ADDS.l #1, ERd
-								struct RegRef32 Rd = getRegRef32(bL);
-								*Rd.ptr += 1;
-								printInstruction("%04x - ADDS.l #1, ER%d\n", pc, Rd.idx);
-							}break;
-							case 0x8:{ // ADDS.l #2, ERd
-								struct RegRef32 Rd = getRegRef32(bL);
-								*Rd.ptr += 2;
-								printInstruction("%04x - ADDS.l #2, ER%d\n", pc, Rd.idx);
-							}break;
-							case 0x9:{ // ADDS.l #4, ERd
-								struct RegRef32 Rd = getRegRef32(bL);
-								*Rd.ptr += 4;
-								printInstruction("%04x - ADDS.l #4, ER%d\n", pc, Rd.idx);
-							}break;
-							case 0x5:{ // INC.w #1, Rd
-								struct RegRef16 Rd = getRegRef16(bL);
-								setFlagsINC(*Rd.ptr, 1, 16); 
-								*Rd.ptr += 1;
-								printInstruction("%04x - INC.w #1, %c%d\n", pc, Rd.loOrHiReg, Rd.idx);
-							}break;
-							case 0x7:{ // INC.l #1, ERd
-								struct RegRef32 Rd = getRegRef32(bL);
-								setFlagsINC(*Rd.ptr, 1, 32);
-								*Rd.ptr += 1;
-								printInstruction("%04x - INC.l #1, ER%d\n", pc, Rd.idx);
-							} break;
-							case 0xD:{ // INC.w #2, Rd
-								struct RegRef16 Rd = getRegRef16(bL);
-								setFlagsINC(*Rd.ptr, 2, 16);
-								*Rd.ptr += 2;
-								printInstruction("%04x - INC.w #2, %c%d\n", pc, Rd.loOrHiReg, Rd.idx);
-							}break;
-							case 0xF:{ // INC.l #2, ERd
-								struct RegRef32 Rd = getRegRef32(bL);
-								setFlagsINC(*Rd.ptr, 2, 32);
-								*Rd.ptr += 2;
-								printInstruction("%04x - INC.l #2, ER%d\n", pc, Rd.idx);
-							}break;
-							default:{
-								return 1;
-							} break;
-						}
-						printRegistersState();
-					}break;
-					case 0xC:{ // MOV.B Rs, Rd
-						struct RegRef8 Rs = getRegRef8(bH);
-						struct RegRef8 Rd = getRegRef8(bL);
-
-						setFlagsMOV(*Rs.ptr, 8);
-						*Rd.ptr = *Rs.ptr;
-
-						printInstruction("%04x - MOV.b R%d%c,R%d%c\n", pc, Rs.idx, Rs.loOrHiReg, Rd.idx, Rd.loOrHiReg); 
-						printRegistersState();
-
-					}break;
-					case 0xD:{ // MOV.W Rs, Rd
-					struct RegRef16 Rs = getRegRef16(bH);
-					struct RegRef16 Rd = getRegRef16(bL);
-
-						setFlagsMOV(*Rs.ptr, 16);
-
-						*Rd.ptr = *Rs.ptr;
-						printInstruction("%04x - MOV.w %c%d,%c%d\n", pc, Rs.loOrHiReg, Rs.idx, Rd.loOrHiReg,  Rd.idx); 
-						printRegistersState();
-
-					}break;
-					case 0xE:{
-						printInstruction("%04x - ADDX\n", pc);
-						return 1; // UNIMPLEMENTED
-					}break;
-					case 0xF:{
-						switch(bH){
-							case 0x0:{
-								printInstruction("%04x - DAA\n", pc);
-								return 1; // UNIMPLEMENTED
-							}break;
-							case 0x8:
-							case 0x9:
-							case 0xA:
-							case 0xB:
-							case 0xC:
-							case 0xD:
-							case 0xE:
-							case 0xF:{// MOV.l ERs, ERd
-								struct RegRef32 Rs = getRegRef32(bH);
-								struct RegRef32 Rd = getRegRef32(bL);
-
-								setFlagsMOV(*Rs.ptr, 32);
-
-								*Rd.ptr = *Rs.ptr;
-								printInstruction("%04x - MOV.l ER%d, ER%d\n", pc, Rs.idx,  Rd.idx); 
-								printRegistersState();
-							}break;
-							default:{
-								return 1;
-							} break;
-						}
-					}break;
-					default:{
-						return 1;
-					} break;
+void onBreakpoint(uint16_t address){
+	printf("Breakpoint at %04x\n", address); // Set a debugger breakpoint here to stop on the ROM address
+}
 
+// Runs every hook registered for the current pc. Returns true if one of them skipped the instruction,
+// in which case 'cycles' gets the cycles to charge for it.
+bool runHooks(bool instrumented, uint32_t* cycles){
+	uint16_t address = pc;
+	bool skipped = false;
+	int first = 0;
+	if (hookResumeIndex >= 0){
+		first = hookResumeAddress == address ? hookResumeIndex : 0; // The hooks before it already ran on the fast core
+		hookResumeIndex = -1;
+	}
+	for(int i = first; i < hookCount; i++){
+		struct Hook_t* hook = &hooks[i];
+		if (hook->address != address){
+			continue;
+		}
+		switch(hook->type){
+			case HOOK_SKIP:{
+				pc += hook->value;
+				skipped = true;
+				if (instrumented){
+					printInstruction("%04x - SKIP %d bytes\n", address, hook->value);
 				}
 			}break;
-			case 0x1:{
-				switch(aL){
-					case 0x0:{
-						switch(bH){
-							case 0x0:{ // SHLL.b Rd
-								struct RegRef8 Rd = getRegRef8(bL);
-								flags.C = *Rd.ptr & 0x80;
-								*Rd.ptr = (*Rd.ptr << 1);
-								setFlagsMOV(*Rd.ptr, 8);
-								printInstruction("%04x - SHLL.b r%d%c\n", pc, Rd.idx, Rd.loOrHiReg);
-							}break;
-							case 0x1:{ // SHLL.w Rd
-								struct RegRef16 Rd = getRegRef16(bL);
-								flags.C = *Rd.ptr & 0x8000;
-								*Rd.ptr = (*Rd.ptr << 1);
-								setFlagsMOV(*Rd.ptr, 16);
-								printInstruction("%04x - SHLL.w %c%d\n", pc, Rd.loOrHiReg, Rd.idx);
-							} break;
-							case 0x3:{ // SHLL.l Rd
-								struct RegRef32 Rd = getRegRef32(bL);
-								flags.C = *Rd.ptr & 0x80000000;
-								*Rd.ptr = (*Rd.ptr << 1);
-								setFlagsMOV(*Rd.ptr, 32);
-								printInstruction("%04x - SHLL.l er%d\n", pc, Rd.idx);
-							}break;
-							case 0x8:{ // SHAL.b Rd -- These differ in their treatment of the V flag
-								struct RegRef8 Rd = getRegRef8(bL);
-								flags.C = *Rd.ptr & 0x80;
-								*Rd.ptr = (*Rd.ptr << 1);
-								setFlagsMOV(*Rd.ptr, 8);
-								flags.V = flags.C && !(*Rd.ptr & 0x80);
-								printInstruction("%04x - SHAL.b r%d%c\n", pc, Rd.idx, Rd.loOrHiReg);
-							}break;
-							case 0x9:{ // SHAL.w Rd
-								struct RegRef16 Rd = getRegRef16(bL);
-								flags.C = *Rd.ptr & 0x8000;
-								*Rd.ptr = (*Rd.ptr << 1);
-								setFlagsMOV(*Rd.ptr, 16);
-								flags.V = flags.C && !(*Rd.ptr & 0x8000);
-								printInstruction("%04x - SHAL.w %c%d\n", pc, Rd.loOrHiReg, Rd.idx);
-							}break;
-							case 0xB:{ // SHAL.l Rd
-								struct RegRef32 Rd = getRegRef32(bL);
-								flags.C = *Rd.ptr & 0x80000000;
-								*Rd.ptr = (*Rd.ptr << 1);
-								setFlagsMOV(*Rd.ptr, 32);
-								flags.V = flags.C && !(*Rd.ptr & 0x80000000);
-								printInstruction("%04x - SHAL.l er%d\n", pc, Rd.idx);
-							}break;
-							default:{
-								return 1;
-							} break;
-						}
-						printRegistersState();
-					}break;
-					case 0x1:{
-						switch(bH){
-							case 0x0:{ // SHLR.b Rd
-								struct RegRef8 Rd = getRegRef8(bL);
-								flags.C = *Rd.ptr & 0x1;
-								*Rd.ptr = (*Rd.ptr >> 1);
-								setFlagsMOV(*Rd.ptr, 8);
-								printInstruction("%04x - SHLR.b r%d%c\n", pc, Rd.idx, Rd.loOrHiReg);
-							}break;
-							case 0x1:{ // SHLR.w Rd
-								struct RegRef16 Rd = getRegRef16(bL);
-								flags.C = *Rd.ptr & 0x1;
-								*Rd.ptr = (*Rd.ptr >> 1);
-								setFlagsMOV(*Rd.ptr, 16);
-								printInstruction("%04x - SHLR.w %c%d\n", pc, Rd.loOrHiReg, Rd.idx);
-							} break;
-							case 0x3:{ // SHLR.l Rd
-								struct RegRef32 Rd = getRegRef32(bL);
-								flags.C = *Rd.ptr & 0x1;
-								*Rd.ptr = (*Rd.ptr >> 1);
-								setFlagsMOV(*Rd.ptr, 32);
-								printInstruction("%04x - SHLR.l er%d\n", pc, Rd.idx);
-							}break;
-							case 0x8:{ // SHAR.b Rd - Unused in the ROM
-								return 1;
-							}break;
-							case 0x9:{ // SHAR.w Rd
-								struct RegRef16 Rd = getRegRef16(bL);
-								flags.C = *Rd.ptr & 0x1;
-								*Rd.ptr = (*Rd.ptr >> 1) | (*Rd.ptr & 0x8000);
-								setFlagsMOV(*Rd.ptr, 16);
-								printInstruction("%04x - SHAR.w %c%d\n", pc, Rd.loOrHiReg, Rd.idx);
-							}break;
-							case 0xB:{ // SHAR.l Rd
-								struct RegRef32 Rd = getRegRef32(bL);
-								flags.C = *Rd.ptr & 0x1;
-								*Rd.ptr = (*Rd.ptr >> 1) | (*Rd.ptr & 0x80000000);
-								setFlagsMOV(*Rd.ptr, 32);
-								printInstruction("%04x - SHAR.l er%d\n", pc, Rd.idx);
-							}break;
-							default:{
-								return 1;
-							} break;
-						}
-						printRegistersState();
-					}break;
-					case 0x2:{
-						switch(bH){
-							case 0x0:{ // ROTXL.b Rd
-								struct RegRef8 Rd = getRegRef8(bL);
-								bool oldCarry = flags.C;
-								flags.C = *Rd.ptr & 0x80;
-								*Rd.ptr = (*Rd.ptr << 1) | oldCarry;
-								setFlagsMOV(*Rd.ptr, 8);
-								printInstruction("%04x - ROTXL.b r%d%c\n", pc, Rd.idx, Rd.loOrHiReg);
-							} break;
-							case 0x1:{ // ROTXL.w Rd
-								struct RegRef16 Rd = getRegRef16(bL);
-								bool oldCarry = flags.C;
-								flags.C = *Rd.ptr & 0x8000;
-								*Rd.ptr = (*Rd.ptr << 1) | oldCarry;
-								setFlagsMOV(*Rd.ptr, 16);
-								printInstruction("%04x - ROTXL.w %c%d\n", pc, Rd.loOrHiReg, Rd.idx);
-							} break;
-							case 0x3:{ // ROTXL.l Rd
-								struct RegRef32 Rd = getRegRef32(bL);
-								bool oldCarry = flags.C;
-								flags.C = *Rd.ptr & 0x80000000;
-								*Rd.ptr = (*Rd.ptr << 1) | oldCarry;
-								setFlagsMOV(*Rd.ptr, 32);
-								printInstruction("%04x - ROTXL.l er%d\n", pc, Rd.idx);
-							}break;
-							case 0x8:{ // ROTL.b Rd
-								struct RegRef8 Rd = getRegRef8(bL);
-								flags.C = *Rd.ptr & 0x80;
-								*Rd.ptr = (*Rd.ptr << 1) | flags.C;
-								setFlagsMOV(*Rd.ptr, 8);
-								printInstruction("%04x - ROTL.b r%d%c\n", pc, Rd.idx, Rd.loOrHiReg);
-							} break;
-							case 0x9:{ // ROTL.w Rd
-								struct RegRef16 Rd = getRegRef16(bL);
-								flags.C = *Rd.ptr & 0x8000;
-								*Rd.ptr = (*Rd.ptr << 1) | flags.C;
-								setFlagsMOV(*Rd.ptr, 16);
-								printInstruction("%04x - ROTL.w %c%d\n", pc, Rd.loOrHiReg, Rd.idx);
-							} break;
-							case 0xB:{ // ROTL.l Rd
-								struct RegRef32 Rd = getRegRef32(bL);
-								flags.C = *Rd.ptr & 0x80000000;
-								*Rd.ptr = (*Rd.ptr << 1) | flags.C;
-								setFlagsMOV(*Rd.ptr, 32);
-								printInstruction("%04x - ROTL.l er%d\n", pc, Rd.idx);
-							}break;
-							default:{
-								return 1;
-							} break;
-						}
-						printRegistersState();
-					}break;
-					case 0x3:{ // ROTR and ROTXR - Unused in the ROM
-						return 1;
-					}break;
-					case 0x4:{ // OR.B Rs, Rd
-						struct RegRef8 Rs = getRegRef8(bH);
-						struct RegRef8 Rd = getRegRef8(bL);
-
-						uint8_t newValue = *Rs.ptr | *Rd.ptr;
-
-						setFlagsMOV(newValue, 8);
-						*Rd.ptr = newValue;
-
-						printInstruction("%04x - OR.b R%d%c,R%d%c\n", pc, Rs.idx, Rs.loOrHiReg, Rd.idx, Rd.loOrHiReg); 
-						printRegistersState();
-					}break;
-					case 0x5:{ // XOR.B Rs, Rd
-						struct RegRef8 Rs = getRegRef8(bH);
-						struct RegRef8 Rd = getRegRef8(bL);
-
-						uint8_t newValue = *Rs.ptr ^ *Rd.ptr;
-
-						setFlagsMOV(newValue, 8);
-						*Rd.ptr = newValue;
-
-						printInstruction("%04x - XOR.b R%d%c,R%d%c\n", pc, Rs.idx, Rs.loOrHiReg, Rd.idx, Rd.loOrHiReg); 
-						printRegistersState();
-					}break;
-					case 0x6:{ // AND.B Rs, Rd
-						struct RegRef8 Rs = getRegRef8(bH);
-						struct RegRef8 Rd = getRegRef8(bL);
-
-						uint8_t newValue = *Rs.ptr & *Rd.ptr;
-
-						setFlagsMOV(newValue, 8);
-						*Rd.ptr = newValue;
-
-						printInstruction("%04x - AND.b R%d%c,R%d%c\n", pc, Rs.idx, Rs.loOrHiReg, Rd.idx, Rd.loOrHiReg); 
-						printRegistersState();
-					}break;
-					case 0x7:{
-						switch(bH){
-							case 0x0:{ // NOT.b Rd
-								struct RegRef8 Rd = getRegRef8(bL);
-								*Rd.ptr = ~*Rd.ptr;
-								setFlagsMOV(*Rd.ptr, 8);
-								printInstruction("%04x - NOT.b r%d%c\n", pc, Rd.idx, Rd.loOrHiReg); 
-								printRegistersState();
-							} break;
-							case 0x1:{
-								// NOT.w Rd
-								struct RegRef16 Rd = getRegRef16(bL);
-								*Rd.ptr = ~*Rd.ptr;
-								setFlagsMOV(*Rd.ptr, 16);
-								printInstruction("%04x - NOT.w %c%d\n", pc, Rd.loOrHiReg, Rd.idx); 
-								printRegistersState();
-							} break;
-							case 0x3:{ // NOT.l Rd
-								printInstruction("%04x - NOT.l\n", pc);
-								return 1; // Unused in the ROM
-							}break;
-							case 0x5:{ // EXTU.w Rd
-								struct RegRef16 Rd = getRegRef16(bL);
-								*Rd.ptr = *Rd.ptr & 0x00FF;
-								setFlagsMOV(*Rd.ptr, 16);
-								printInstruction("%04x - EXTU.w %c%d\n", pc, Rd.loOrHiReg, Rd.idx);
-								printRegistersState();
-							} break;
-							case 0x7:{ // EXTU.l Rd
-								struct RegRef32 Rd = getRegRef32(bL);
-								*Rd.ptr = *Rd.ptr & 0x0000FFFF;
-								setFlagsMOV(*Rd.ptr, 32);
-								printInstruction("%04x - EXTU.l er%d\n", pc, Rd.idx);
-								printRegistersState();
-							}break;
-							case 0x8:{ // NEG.b Rd -- TODO: Untested
-								struct RegRef8 Rd = getRegRef8(bL);
-
-								setFlagsSUB(0, *Rd.ptr, 8);
-								if (*Rd.ptr != 0x80){
-									*Rd.ptr = (int8_t)0 - (int8_t)*Rd.ptr;
-								}
-								printInstruction("%04x - NEG.b r%d%c\n", pc, Rd.idx, Rd.loOrHiReg); 
-								printRegistersState();
-
-							} break;
-							case 0x9:{ // NEG.w Rd
-								struct RegRef16 Rd = getRegRef16(bL);
-
-								setFlagsSUB(0, *Rd.ptr, 16);
-								if (*Rd.ptr != 0x8000){
-									*Rd.ptr = (int16_t)0 - (int16_t)*Rd.ptr;
-								}
-								printInstruction("%04x - NEG.w %c%d\n", pc, Rd.loOrHiReg, Rd.idx); 
-								printRegistersState();
-
-							} break;
-							case 0xB:{ // NEG.l Rd
-								printInstruction("%04x - NEG.l\n", pc);
-								return 1; // Unused in the ROM
-							}break;
-							case 0xD:{ // EXTS.w Rd
-								struct RegRef16 Rd = getRegRef16(bL);
-								bool sign = *Rd.ptr & 0x80;
-								if (sign == 0){
-									*Rd.ptr = *Rd.ptr & 0x00FF;
-								} else{
-									*Rd.ptr = (*Rd.ptr & 0x00FF) | 0xFF00;
-								}
-								setFlagsMOV(*Rd.ptr, 16);
-								printInstruction("%04x - EXTS.w %c%d\n", pc, Rd.loOrHiReg, Rd.idx);
-								printRegistersState();
-							} break;
-							case 0xF:{ // EXTS.l Rd
-								struct RegRef32 Rd = getRegRef32(bL);
-								bool sign = *Rd.ptr & 0x8000;
-								if (sign == 0){
-									*Rd.ptr = *Rd.ptr & 0x0000FFFF;
-								} else{
-									*Rd.ptr = (*Rd.ptr & 0x0000FFFF) | 0xFFFF0000;
-								}
-								setFlagsMOV(*Rd.ptr, 32);
-								printInstruction("%04x - EXTS.l er%d\n", pc, Rd.idx);
-								printRegistersState();
-							}break;
-							default:{
-								return 1;
-							} break;
-
-						}
-					}break;
-					case 0x8:{ // SUB.b Rs, Rd
-						struct RegRef8 Rs = getRegRef8(bH);
-						struct RegRef8 Rd = getRegRef8(bL);
-
-						setFlagsSUB(*Rd.ptr, *Rs.ptr, 8);
-						*Rd.ptr -= *Rs.ptr;
-
-						printInstruction("%04x - SUB.b R%d%c,R%d%c\n", pc, Rs.idx, Rs.loOrHiReg, Rd.idx, Rd.loOrHiReg); 
-						printRegistersState();
-
-					}break;
-					case 0x9:{ // SUB.W Rs, Rd
-
-					struct RegRef16 Rs = getRegRef16(bH);
-					struct RegRef16 Rd = getRegRef16(bL);
-
-						setFlagsSUB(*Rd.ptr, *Rs.ptr, 16);
-
-						*Rd.ptr -= *Rs.ptr;
-						printInstruction("%04x - SUB.w %c%d,%c%d\n", pc, Rs.loOrHiReg, Rs.idx, Rd.loOrHiReg,  Rd.idx); 
-						printRegistersState();
-
-					}break;
-					case 0xA:{
-						switch(bH){
-							case 0x0:{ // DEC.b Rd
-								struct RegRef8 Rd = getRegRef8(bL);
-								setFlagsINC(*Rd.ptr, -1, 8);
-								*Rd.ptr -= 1;
-								printInstruction("%04x - DEC.b r%d%c\n", pc, Rd.idx, Rd.loOrHiReg);
-								printRegistersState();
-							}break;
-							case 0x8:
-							case 0x9:
-							case 0xA:
-							case 0xB:
-							case 0xC:
-							case 0xD:
-							case 0xE:
-							case 0xF:{ // SUB.l ERs, ERd
-								struct RegRef32 Rs = getRegRef32(bH);
-								struct RegRef32 Rd = getRegRef32(bL);
-
-								setFlagsSUB(*Rd.ptr, *Rs.ptr, 32);
-
-								*Rd.ptr -= *Rs.ptr;
-								printInstruction("%04x - SUB.l ER%d, ER%d\n", pc, Rs.idx,  Rd.idx); 
-								printRegistersState();
-							}break;
-							default:{
-								return 1;
-							} break;
-
-						}
-					}break;
-					case 0xB:{
-						switch(bH){
-							case 0x0:{ // SUBS #1, ERd
-								struct RegRef32 Rd = getRegRef32(bL);
-
-								*Rd.ptr -= 1;
-								printInstruction("%04x - SUBS #1, ER%d\n", pc, Rd.idx); 
-								printRegistersState();
-							}break;
-							case 0x8:{ // SUBS #2, ERd
-								struct RegRef32 Rd = getRegRef32(bL);
-
-								*Rd.ptr -= 2;
-								printInstruction("%04x - SUBS #2, ER%d\n", pc, Rd.idx); 
-								printRegistersState();
-							}break;
-							case 0x9:{ // SUBS #4, ERd
-								struct RegRef32 Rd = getRegRef32(bL);
-
-								*Rd.ptr -= 4;
-								printInstruction("%04x - SUBS #4, ER%d\n", pc, Rd.idx); 
-								printRegistersState();
-							}break;
-							case 0x5:{ // DEC.w #1, Rd
-								struct RegRef16 Rd = getRegRef16(bL);
-								setFlagsINC(*Rd.ptr, -1, 16);
-								*Rd.ptr -= 1;
-								printInstruction("%04x - DEC.w #1, %c%d\n", pc, Rd.loOrHiReg, Rd.idx);
-								printRegistersState();
-							}break;
-							case 0x7:{ // DEC.l #1, ERd
-								struct RegRef32 Rd = getRegRef32(bL);
-								setFlagsINC(*Rd.ptr, -1, 32);
-								*Rd.ptr -= 1;
-								printInstruction("%04x - DEC.l #1, ER%d\n", pc, Rd.idx);
-								printRegistersState();
-							}break;
-							case 0xD:{ // DEC.w #2, Rd
-								struct RegRef16 Rd = getRegRef16(bL);
-								setFlagsINC(*Rd.ptr, -2, 16);
-								*Rd.ptr -= 2;
-								printInstruction("%04x - DEC.w #2, %c%d\n", pc, Rd.loOrHiReg, Rd.idx);
-								printRegistersState();
-							}break;
-							case 0xF:{ // DEC.l #2, ERd
-								struct RegRef32 Rd = getRegRef32(bL);
-								setFlagsINC(*Rd.ptr, -2, 32);
-								*Rd.ptr -= 2;
-								printInstruction("%04x - DEC.l #2, ER%d\n", pc, Rd.idx);
-								printRegistersState();
-							}break;
-							default:{
-								return 1;
-							} break;
-						}
-					}break;
-					case 0xC:{ // CMP.b Rs, Rd
-						struct RegRef8 Rs = getRegRef8(bH);
-						struct RegRef8 Rd = getRegRef8(bL);
-
-						setFlagsSUB(*Rd.ptr, *Rs.ptr, 8);
-
-						printInstruction("%04x - SUB.b R%d%c,R%d%c\n", pc, Rs.idx, Rs.loOrHiReg, Rd.idx, Rd.loOrHiReg); 
-						printRegistersState();
-
-					}break;
-					case 0xD:{ // CMP.W Rs, Rd
-					struct RegRef16 Rs = getRegRef16(bH);
-					struct RegRef16 Rd = getRegRef16(bL);
-						setFlagsSUB(*Rd.ptr, *Rs.ptr, 16);
-
-						printInstruction("%04x - CMP.w %c%d,%c%d\n", pc, Rs.loOrHiReg, Rs.idx, Rd.loOrHiReg,  Rd.idx); 
-						printRegistersState();
-					}break;
-					case 0xE:{ // SUBX Rs, Rd
-						struct RegRef8 Rs = getRegRef8(bH);
-						struct RegRef8 Rd = getRegRef8(bL);
-
-						setFlagsSUB(*Rd.ptr, *Rs.ptr + flags.C, 8); // NOTE: didn't check edge cases (Rs + flag OV)
-						*Rd.ptr -= *Rs.ptr;
-						*Rd.ptr -= flags.C;
-
-						printInstruction("%04x - SUBX R%d%c,R%d%c\n", pc, Rs.idx, Rs.loOrHiReg, Rd.idx, Rd.loOrHiReg); 
-						printRegistersState();
-					}break;
-					case 0xF:{
-						switch(bH){
-							case 0x0:{
-								printInstruction("%04x - DAS\n", pc);
-								return 1; // UNIMPLEMENTED
-							}break;
-							case 0x8:
-							case 0x9:
-							case 0xA:
-							case 0xB:
-							case 0xC:
-							case 0xD:
-							case 0xE:
-							case 0xF:{ // CMP.l ERs, ERd
-								struct RegRef32 Rs = getRegRef32(bH);
-								struct RegRef32 Rd = getRegRef32(bL);
-
-								setFlagsSUB(*Rd.ptr, *Rs.ptr, 32);
-
-								printInstruction("%04x - CMP.l ER%d, ER%d\n", pc, Rs.idx,  Rd.idx); 
-								printRegistersState();
-							}break;
-							default:{
-								return 1;
-							} break;
-						}
-					}break;
-					default:{
-						return 1;
-					} break;
+			case HOOK_SET_REG8:{
+				*getRegRef8(hook->target).ptr = hook->value;
+			}break;
+			case HOOK_INPUT:{
+				if (!isEmpty(&inputQueue)){
+					setMemory8(hook->target, popElement(&inputQueue));
 				}
 			}break;
-
-			case 0x2:{ // MOV.B @aa:8, Rd
-				uint32_t address = (b & 0x000000FF) | 0x00FFFF00; // Upper 16 bits assumed to be 1
-				uint8_t value = getMemory8(address);
-
-				struct RegRef8 Rd = getRegRef8(aL);
-				setFlagsMOV(value, 8);
-				*Rd.ptr = value;
-
-				printInstruction("%04x - MOV.b @%x:8, R%d%c\n", pc, address, Rd.idx, Rd.loOrHiReg); 
-				printRegistersState();
-
-
+			case HOOK_POKE8:{
+				setMemory8(hook->target, hook->value);
 			}break;
-			case 0x3:{ // MOV.B Rs, @aa:8 
-				uint32_t address = (b & 0x000000FF) | 0x00FFFF00; // Upper 16 bits assumed to be 1
-
-				struct RegRef8 Rs = getRegRef8(aL);
-				uint8_t value = *Rs.ptr;
-				setFlagsMOV(value, 8);
-				setMemory8(address, value);
-
-				printInstruction("%04x - MOV.b R%d%c,@%x:8 \n", pc, Rs.idx, Rs.loOrHiReg, address); 
-				printMemory(address, 1);
-				printRegistersState();
-
-
-
+			case HOOK_POKE16:{
+				setMemory16(hook->target, hook->value);
 			}break;
-			case 0x4:{
-				int8_t disp = b;
-
-				switch(aL){
-					case 0x0:{ // BRA d:8
-						printInstruction("%04x - BRA %d:8\n", pc, disp);
-						pc += disp; 
-					}break;
-					case 0x1:{ // Unused in the ROM
-						printInstruction("%04x - BRN %d:8\n", pc, disp);
-						return 1; // UNIMPLEMENTED
-					}break;
-					case 0x2:{
-						printInstruction("%04x - BHI %d:8\n", pc, disp);
-						if(!(flags.C | flags.Z)){
-							pc += disp;
-						}
-					}break;
-					case 0x3:{
-						printInstruction("%04x - BLS %d:8\n", pc, disp);
-						if((flags.C | flags.Z)){
-							pc += disp;
-						}
-					}break;
-					case 0x4:{
-						printInstruction("%04x - BCC %d:8\n", pc, disp);
-						if(!(flags.C)){
-							pc += disp;
-						}
-					}break;
-					case 0x5:{
-						printInstruction("%04x - BCS %d:8\n", pc, disp);
-						if(flags.C){
-							pc += disp;
-						}
-					}break;
-					case 0x6:{
-						printInstruction("%04x - BNE %d:8\n", pc, disp);
-						if(!(flags.Z)){
-							pc += disp;
-						}
-					}break;
-					case 0x7:{
-						printInstruction("%04x - BEQ %d:8\n", pc, disp);
-						if(flags.Z){
-							pc += disp;
-						}
-					}break;
-					case 0x8:{
-						printInstruction("%04x - BVC %d:8\n", pc, disp);
-						if(!(flags.V)){
-							pc += disp;
-						}
-					}break;
-					case 0x9:{
-						printInstruction("%04x - BVS %d:8\n", pc, disp);
-						if(flags.V){
-							pc += disp;
-						}
-					}break;
-					case 0xA:{
-						printInstruction("%04x - BPL %d:8\n", pc, disp);
-						if(!(flags.N)){
-							pc += disp;
-						}
-					}break;
-					case 0xB:{
-						printInstruction("%04x - BMI %d:8\n", pc, disp);
-						if(flags.N){
-							pc += disp;
-						}
-					}break;
-					case 0xC:{
-						printInstruction("%04x - BGE %d:8\n", pc, disp);
-						if(!(flags.N ^ flags.V)){
-							pc += disp;
-						}
-					}break;
-					case 0xD:{
-						printInstruction("%04x - BLT %d:8\n", pc, disp);
-						if((flags.N ^ flags.V)){
-							pc += disp;
-						}
-
-					}break;
-					case 0xE:{
-						printInstruction("%04x - BGT %d:8\n", pc, disp);
-					if(!(flags.Z | (flags.N ^ flags.V))){
-							pc += disp;
-						}
-
-					}break;
-					case 0xF:{
-						printInstruction("%04x - BLE %d:8\n", pc, disp);
-						if(flags.Z | (flags.N ^ flags.V)){
-							pc += disp;
-						}
-					}break;
-					default:{
-						return 1;
-					} break;
+			case HOOK_BREAKPOINT:{
+				if (instrumented){
+					onBreakpoint(address);
 				}
 			}break;
-			case 0x5:{
-				switch(aL){
-					case 0x0:{ // MULXU B Rs, Rd
-						struct RegRef8 Rs = getRegRef8(bH);
-					struct RegRef16 Rd = getRegRef16(bL);
-						uint8_t lowerBitsRd = *Rd.ptr & 0x00FF;
-						*Rd.ptr = *Rs.ptr * lowerBitsRd;
-						printInstruction("%04x - MULXU B r%d%c, %c%d\n", pc, Rs.idx, Rs.loOrHiReg, Rd.loOrHiReg, Rd.idx);
-						printRegistersState();
-					} break;
-					case 0x2:{// MULXU W Rs, Rd
-					struct RegRef16 Rs = getRegRef16(bH);
-					struct RegRef32 Rd = getRegRef32(bL);
-						uint16_t lowerBitsRd = *Rd.ptr & 0x0000FFFF;
-						*Rd.ptr = *Rs.ptr * lowerBitsRd;
-
-						printInstruction("%04x - MULXU W %c%d, er%d\n", pc, Rs.loOrHiReg, Rs.idx, Rd.idx);
-						printRegistersState();
-					}break;
-					case 0x1:{ // DIVXU B Rs, Rd
-						struct RegRef8 Rs = getRegRef8(bH);
-					struct RegRef16 Rd = getRegRef16(bL);
-						uint8_t quotient = *Rd.ptr / *Rs.ptr;
-						uint8_t remainder = *Rd.ptr % *Rs.ptr; 
-						*Rd.ptr = (remainder << 8) | quotient;
-
-						flags.Z = (*Rs.ptr == 0) ? 1 : 0;
-						flags.N = (*Rs.ptr & 0x8000) ? 1 : 0;
-
-						printInstruction("%04x - DIVXU B r%d%c, %c%d\n", pc, Rs.idx, Rs.loOrHiReg, Rd.loOrHiReg, Rd.idx);
-						printRegistersState();
-
-
-					} break;
-					case 0x3:{ // DIVXU W Rs, Rd
-					struct RegRef16 Rs = getRegRef16(bH);
-					struct RegRef32 Rd = getRegRef32(bL);
-						uint16_t quotient = *Rd.ptr / *Rs.ptr;
-						uint16_t remainder = *Rd.ptr % *Rs.ptr; 
-						*Rd.ptr = (remainder << 16) | quotient;
-
-						flags.Z = (*Rs.ptr == 0) ? 1 : 0;
-						flags.N = (*Rs.ptr & 0x80000000) ? 1 : 0;
-
-						printInstruction("%04x - DIVXU W %c%d, er%d\n", pc, Rs.loOrHiReg, Rs.idx, Rd.idx);
-						printRegistersState();
-
-					}break;
-					case 0x4:{ // RTS
-					printInstruction("%04x - RTS\n", pc);
-						pc = getMemory16(*SP) - 2;
-						*SP += 2;
-						printRegistersState();
-					}break;
-					case 0x5:{ // BSR d:8
-						int8_t disp = b;
-						printInstruction("%04x - BSR @%d:8\n", pc, disp);
-						*SP -= 2;
-						setMemory16(*SP, pc + 2);
-
-						pc = pc + disp; // No need to increment pc by 2 since we're always doing that at the end of the loop
-
-						printMemory(*SP, 2);
-						printRegistersState();
-					}break;
-					case 0xC:{ // BSR d:16
-						int16_t disp = cd; 
-						printInstruction("%04x - BSR @%d:16\n", pc, disp);
-						*SP -= 2;
-						setMemory16(*SP, pc + 4);
-
-						pc = pc + 2 + disp; // Increment pc by 2 since we need the next instruction (pc + 4) and we're already adding 2 at the end of the loop.
-
-						printMemory(*SP, 2);
-						printRegistersState();
-					}break;
-					case 0x6:{
-						pc = interruptSavedAddress - 2; // -2?
-						flags = interruptSavedFlags;
-						printInstruction("%04x - RTE\n", pc);
-					}break;
-					case 0x7:{
-						printInstruction("%04x - TRAPA\n", pc);
-						return 1; // UNIMPLEMENTED
-					}break;
-					case 0x8:{
-						int16_t disp = cd;
-						switch(bH){
-							case 0x0:{
-								printInstruction("%04x - BRA %d:16\n", pc, disp);
-								pc += 2 + disp;
-							}break;
-							case 0x1:{ // Unused in the ROM
-								printInstruction("%04x - BRN %d:16\n", pc, disp);
-							}break;
-							case 0x2:{
-								printInstruction("%04x - BHI %d:16\n", pc, disp);
-								if(!(flags.C | flags.Z)){
-									pc += 2 + disp;
-								}else{
-									pc += 2;
-								}
-							}break;
-							case 0x3:{
-								printInstruction("%04x - BLS %d:16\n", pc, disp);
-								if(flags.C | flags.Z){
-									pc += 2 + disp;
-								}else{
-									pc += 2;
-								}
-
-							}break;
-							case 0x4:{
-								printInstruction("%04x - BCC %d:16\n", pc, disp);
-								if(!flags.C){
-									pc += 2 + disp;
-								}else{
-									pc += 2;
-								}
-
-							}break;
-							case 0x5:{
-								printInstruction("%04x - BCS %d:16\n", pc, disp);
-								if(flags.C){
-									pc += 2 + disp;
-								}else{
-									pc += 2;
-								}
-
-							}break;
-							case 0x6:{
-								printInstruction("%04x - BNE %d:16\n", pc, disp);
-								if(!flags.Z){
-									pc += 2 + disp;
-								}else{
-									pc += 2;
-								}
-
-							}break;
-							case 0x7:{
-								printInstruction("%04x - BEQ %d:16\n", pc, disp);
-								if(flags.Z){
-									pc += 2 + disp;
-								}else{
-									pc += 2;
-								}
-
-							}break;
-							case 0x8:{
-								printInstruction("%04x - BVC %d:16\n", pc, disp);
-								if(!flags.V){
-									pc += 2 + disp;
-								}else{
-									pc += 2;
-								}
-
-							}break;
-							case 0x9:{
-								printInstruction("%04x - BVS %d:16\n", pc, disp);
-								if(flags.V){
-									pc += 2 + disp;
-								}else{
-									pc += 2;
-								}
-
-							}break;
-							case 0xA:{
-								printInstruction("%04x - BPL %d:16\n", pc, disp);
-								if(!flags.N){
-									pc += 2 + disp;
-								}else{
-									pc += 2;
-								}
-
-							}break;
-							case 0xB:{
-								printInstruction("%04x - BMI %d:16\n", pc, disp);
-								if(flags.N){
-									pc += 2 + disp;
-								}else{
-									pc += 2;
-								}
-
-							}break;
-							case 0xC:{
-								printInstruction("%04x - BGE %d:16\n", pc, disp);
-								if(!(flags.N ^ flags.V)){
-									pc += 2 + disp;
-								}else{
-									pc += 2;
-								}
-
-							}break;
-							case 0xD:{
-								printInstruction("%04x - BLT %d:16\n", pc, disp);
-								if(flags.N ^ flags.V){
-									pc += 2 + disp;
-								}else{
-									pc += 2;
-								}
-
-							}break;
-							case 0xE:{
-								printInstruction("%04x - BGT %d:16\n", pc, disp);
-								if(!(flags.Z | (flags.N ^ flags.V))){
-									pc += 2 + disp;
-								}else{
-									pc += 2;
-								}
-
-							}break;
-							case 0xF:{
-								printInstruction("%04x - BLE %d:16\n", pc, disp);
-								if((flags.Z | (flags.N ^ flags.V))){
-									pc += 2 + disp;
-								}else{
-									pc += 2;
-								}
-
-							}break;
-							default:{
-								return 1;
-							} break;
-						}				
-					}break;
-					case 0x9:{ // JMP @ERn
-					struct RegRef32 Er = getRegRef32(bH);
-						printInstruction("%04x - JMP @ER%d\n", pc, Er.idx);
-						pc = (*Er.ptr & 0x0000FFFF) - 2; // Sub 2 cause we're incrementing 2 at the end of the loop
-					}break;
-					case 0xA:{ // JMP @aa:24
-						uint32_t address = (b << 16) | cd;
-						printInstruction("%04x - JMP @0x%04x:24\n", pc, address);
-						pc = address - 2; // Sub 2 cause we're incrementing 2 at the end of the loop
-					}break;
-					case 0xB:{ // JMP @@aa:8 - UNUSED IN THE ROM, left unimplemented.
-						printInstruction("%04x - ????\n", pc);
-					}break;
-					case 0xD:{ // JSR @ERn
-					struct RegRef32 Er = getRegRef32(bH);
-
-						*SP -= 2;
-						setMemory16(*SP, pc + 2);
-
-						printInstruction("%04x - JSR @ER%d\n", pc, Er.idx);
-						pc = (*Er.ptr & 0x0000FFFF) - 2; // Sub 2 cause we're incrementing 2 at the end of the loop
-
-						printMemory(*SP, 2);
-						printRegistersState();
-					}break;
-					case 0xE:{ // JSR @aa:24
-						uint32_t address = (b << 16) | cd;
-
-						*SP -= 2;
-						setMemory16(*SP, pc + 4);
-
-						printInstruction("%04x - JSR @0x%04x:24\n", pc, address);
-						pc = address - 2; // Sub 2 cause we're incrementing 2 at the end of the loop
-
-						printMemory(*SP, 2);
-						printRegistersState();
-
-					}break;
-					case 0xF:{ // JSR @@aa:24 - UNUSED IN THE ROM, left unimplemented.
-						printInstruction("%04x - ????\n", pc);
-					}break;
-					default:{
-						return 1;
-					} break;
-
+			case HOOK_HLE:{
+				if (instrumented && hleValidating){
+					startHleValidation(hook->target); // Let the ROM code run, compare once it returns
 				}
-			}break;
-			case 0x6:{
-				switch(aL){
-					case 0x0:{ // BSET Rn, Rd
-
-						struct RegRef8 Rd = getRegRef8(bL);		
-						struct RegRef8 Rn = getRegRef8(bH);		
-						int bitToSet = *Rn.ptr;
-
-						*Rd.ptr = *Rd.ptr | (1 << bitToSet);
-
-						printInstruction("%04x - BSET r%d%c, r%d%c\n", pc, Rn.idx, Rn.loOrHiReg, Rd.idx, Rd.loOrHiReg);
-						printRegistersState();
-					}break;
-					case 0x1:{
-						printInstruction("%04x - BNOT\n", pc);
-						return 1; // UNUSED IN THE ROM
-					}break;
-					case 0x2:{ // BCLR Rn, Rd
-						struct RegRef8 Rd = getRegRef8(bL);		
-						struct RegRef8 Rn = getRegRef8(bH);		
-						int bitToClear = *Rn.ptr;
-
-						*Rd.ptr = *Rd.ptr & ~(1 << bitToClear);
-
-						printInstruction("%04x - BCLR r%d%c, r%d%c\n", pc, Rn.idx, Rn.loOrHiReg, Rd.idx, Rd.loOrHiReg);
-						printRegistersState();
-					}break;
-					case 0x3:{
-						printInstruction("%04x - BTST\n", pc);
-						return 1; // UNIMPLEMENTED
-					}break;
-					case 0x4:{ // OR.w Rs, Rd
-					struct RegRef16 Rd = getRegRef16(bL);
-					struct RegRef16 Rs = getRegRef16(bH);
-						uint16_t newValue = *Rs.ptr | *Rd.ptr;
-						setFlagsMOV(newValue, 16);
-						*Rd.ptr = newValue;
-
-						printInstruction("%04x - OR.w %c%d,%c%d\n", pc, Rs.loOrHiReg, Rs.idx, Rd.loOrHiReg,  Rd.idx); 
-						printRegistersState();
-					}break;
-					case 0x5:{ // XOR.w Rs, Rd
-					struct RegRef16 Rd = getRegRef16(bL);
-					struct RegRef16 Rs = getRegRef16(bH);
-						uint16_t newValue = *Rs.ptr ^ *Rd.ptr;
-						setFlagsMOV(newValue, 16);
-						*Rd.ptr = newValue;
-
-						printInstruction("%04x - XOR.w %c%d,%c%d\n", pc, Rs.loOrHiReg, Rs.idx, Rd.loOrHiReg,  Rd.idx); 
-						printRegistersState();
-					}break;
-					case 0x6:{ // AND.w Rs, Rd
-					struct RegRef16 Rd = getRegRef16(bL);
-					struct RegRef16 Rs = getRegRef16(bH);
-						uint16_t newValue = *Rs.ptr & *Rd.ptr;
-						setFlagsMOV(newValue, 16);
-						*Rd.ptr = newValue;
-
-						printInstruction("%04x - AND.w %c%d,%c%d\n", pc, Rs.loOrHiReg, Rs.idx, Rd.loOrHiReg,  Rd.idx); 
-						printRegistersState();
-					}break;
-					case 0x7:{ // BST #xx:3, Rd
-						uint8_t mostSignificantBit = bH >> 7;
-						if (mostSignificantBit == 0x1){
-							printInstruction("%04x - BIST\n", pc);
-						}else{
-							uint8_t bitToSet = bH;
-							struct RegRef8 Rd = getRegRef8(bL);
-							if (flags.C == 0){
-								setMemory8(*Rd.ptr, getMemory8(*Rd.ptr) & ~(1 << bitToSet));
-							} else{
-								setMemory8(*Rd.ptr, getMemory8(*Rd.ptr) | (1 << bitToSet));
-							}
-							printInstruction("%04x - BST #%d, R%d%c\n", pc, bitToSet, Rd.idx, Rd.loOrHiReg);
-						}					
-					}break;
-					case 0x8:{ 
-						if(!(b & 0x80)){ // MOV.B @ERs, Rd
-							struct RegRef32 Rs = getRegRef32(bH);
-							struct RegRef8 Rd = getRegRef8(bL);
-
-							uint8_t value = getMemory8(*Rs.ptr);
-
-							setFlagsMOV(value, 8);
-							*Rd.ptr = value;
-
-							printInstruction("%04x - MOV.b @ER%d, R%d%c\n", pc, Rs.idx, Rd.idx, Rd.loOrHiReg); 
-						} else{// MOV.B Rs, @ERd 
-							struct RegRef8 Rs = getRegRef8(bL);
-							struct RegRef32 Rd = getRegRef32(bH);
-
-							uint8_t value = *Rs.ptr;
-
-							setFlagsMOV(value, 8);
-							setMemory8(*Rd.ptr, value);
-							printInstruction("%04x - MOV.b R%d%c, @ER%d, \n", pc, Rs.idx, Rs.loOrHiReg, Rd.idx);
-							printMemory(*Rd.ptr, 1);
-						}
-						printRegistersState();
-					}break;
-					case 0x9:{ 
-						if(!(b & 0x80)){ // MOV.w @ERs, Rd
-							struct RegRef32 Rs = getRegRef32(bH);
-							struct RegRef16 Rd = getRegRef16(bL);
-							uint16_t value = getMemory16(*Rs.ptr);
-							setFlagsMOV(value, 16);
-							*Rd.ptr = value;
-							printInstruction("%04x - MOV.w @ER%d, %c%d\n", pc, Rs.idx, Rd.loOrHiReg, Rd.idx ); 
-						} else{ // MOV.w Rs, @ERd 
-							struct RegRef16 Rs = getRegRef16(bL);
-							struct RegRef32 Rd = getRegRef32(bH);
-							uint16_t value = *Rs.ptr;
-							setFlagsMOV(value, 16);
-							setMemory16(*Rd.ptr, value);
-							printInstruction("%04x - MOV.w R%d%c, @ER%d, \n", pc, Rs.idx, Rs.loOrHiReg, Rd.idx);
-							printMemory(*Rd.ptr, 2);
-						}
-						printRegistersState();
-
-					} break;
-					case 0xA:{ 
-						switch(bH){
-							case 0x0:{ // MOV.B @aa:16, Rd
-								uint32_t address = (cd & 0x0000FFFF) | 0x00FF0000; // Upper 16 bits assumed to be 1
-								uint8_t value = getMemory8(address);
-
-								struct RegRef8 Rd = getRegRef8(bL);
-
-								setFlagsMOV(value, 8);
-								*Rd.ptr = value;
-
-
-								if(address == 0xfff0e9){ // SSSRDR
-									*SSU.SSSR = clearBit8(*SSU.SSSR, 1);
-								}
-
-								printInstruction("%04x - MOV.b @%x:16, R%d%c\n", pc, address, Rd.idx, Rd.loOrHiReg); 
-								printRegistersState();
-
-							}break;
-
-							case 0x8:{ // MOV.B Rs, @aa:16 
-								uint32_t address = (cd & 0x0000FFFF) | 0x00FF0000; // Upper 16 bits assumed to be 1
-
-								struct RegRef8 Rs = getRegRef8(bL);
-
-								uint8_t value = *Rs.ptr;
-								setFlagsMOV(value, 8);
-								setMemory8(address, value);
-
-								if(address == 0xfff0eb){ // SSSTDR
-									*SSU.SSSR = clearBit8(*SSU.SSSR, 2); // TDRE
-									*SSU.SSSR = clearBit8(*SSU.SSSR, 3); // TEND
-								} else if(address == 0xfff0d1){ // TMRB_TCB1_TLB1
-									TimerB.TLBvalue = value; // TODO (if handling custom ROMs) add these checks in the other MOVs 
-								}
-
-								printInstruction("%04x - MOV.b R%d%c,@%x:16 \n", pc, Rs.idx, Rs.loOrHiReg, address); 
-								printMemory(address, 1);
-								printRegistersState();
-
-							}break;
-							default:{
-								return 1;
-							} break;
-						}
-						pc+=2;
-
-					}break;
-					case 0xB:{
-						switch(bH){
-							case 0x0:{ // MOV.w @aa:16, Rd
-								uint32_t address = (cd & 0x0000FFFF) | 0x00FF0000; // Upper 16 bits assumed to be 1
-								uint16_t value = getMemory16(address);
-
-								struct RegRef16 Rd = getRegRef16(bL);
-
-								setFlagsMOV(value, 16);
-								*Rd.ptr = value;
-
-								printInstruction("%04x - MOV.w @%x:16, %c%d\n", pc, address, Rd.loOrHiReg, Rd.idx); 
-								printRegistersState();
-
-							}break;
-
-							case 0x8:{ // MOV.w Rs, @aa:16 
-								uint32_t address = (cd & 0x0000FFFF) | 0x00FF0000; // Upper 16 bits assumed to be 1
-
-								struct RegRef16 Rs = getRegRef16(bL);
-
-								uint16_t value = *Rs.ptr;
-								setFlagsMOV(value, 16);
-								setMemory16(address, value);
-
-								printInstruction("%04x - MOV.w %c%d,@%x:16 \n", pc, Rs.loOrHiReg, Rs.idx, address); 
-								printMemory(address, 2);
-								printRegistersState();
-
-							}break;
-							default:{
-								return 1;
-							} break;
-						}
-						pc+=2;
-
-					}break;
-					case 0xC:{ // MOV.B @ERs+, Rd --- MOV.B Rs, @-ERd
-						char incOrDec = (bH & 0b1000) ? '-' : '+';
-
-						if (incOrDec == '+'){
-							struct RegRef32 Rs = getRegRef32(bH);
-							struct RegRef8 Rd = getRegRef8(bL);
-
-							uint8_t value = getMemory8(*Rs.ptr);
-
-							*Rs.ptr += 1;
-
-							setFlagsMOV(value, 8);
-							*Rd.ptr = value;
-
-							printInstruction("%04x - MOV.b @ER%d+, R%d%c\n", pc, Rs.idx, Rd.idx, Rd.loOrHiReg); 
-
-						} else{
-							struct RegRef32 Rd = getRegRef32(bH);
-							struct RegRef8 Rs = getRegRef8(bL);
-
-							*Rd.ptr -= 1;
-
-
-							uint8_t value = *Rs.ptr;
-							setMemory8(*Rs.ptr, value);
-							setFlagsMOV(value, 8);
-
-							printInstruction("%04x - MOV.b R%d%c, @-ER%d, \n", pc, Rs.idx, Rs.loOrHiReg, Rd.idx); 
-							printMemory(*Rd.ptr, 1);
-
-						}
-						printRegistersState();
-
-
-
-					}break;
-					case 0xD:{ // MOV.w @ERs+, Rd --- MOV.w Rs, @-ERd
-						char incOrDec = (bH & 0b1000) ? '-' : '+';
-
-						if (incOrDec == '+'){
-							struct RegRef32 Rs = getRegRef32(bH);
-							struct RegRef16 Rd = getRegRef16(bL);
-
-							uint16_t value = getMemory16(*Rs.ptr);
-
-							*Rs.ptr += 2;
-
-							setFlagsMOV(value, 16);
-							*Rd.ptr = value;
-
-							printInstruction("%04x - MOV.w @ER%d+, %c%d\n", pc, Rs.idx, Rd.loOrHiReg, Rd.idx); 
-
-						} else{
-							struct RegRef32 Rd = getRegRef32(bH);
-							struct RegRef16 Rs = getRegRef16(bL);
-
-							*Rd.ptr -= 2;
-
-							uint16_t value = *Rs.ptr;
-							setMemory16(*Rd.ptr, value);
-							setFlagsMOV(value, 16);
-
-							printInstruction("%04x - MOV.w %c%d, @-ER%d, \n", pc, Rs.loOrHiReg, Rs.idx, Rd.idx); 
-							printMemory(*Rd.ptr, 2);
-						}
-						printRegistersState();
-					} break;
-					case 0xE:{ 
-						struct RegRef8 Rd = getRegRef8(bL);
-					struct RegRef32 Rs = getRegRef32(bH);
-
-						uint16_t disp = cd;
-						bool msbDisp = disp & 0x8000;
-						uint32_t signExtendedDisp = msbDisp ? (0xFFFF0000 | disp) : disp;
-
-						if (!(bH & 0b1000)){ // From memory MOV.B @(d:16, ERs), Rd
-							uint8_t value = getMemory8(*Rs.ptr + signExtendedDisp);
-							*Rd.ptr = value;
-							setFlagsMOV(value, 8);
-
-							printInstruction("%04x - MOV.b @(%d:16, ER%d), R%d%c\n", pc, disp, Rs.idx, Rd.idx, Rd.loOrHiReg); 
-
-						} else{ // To memory MOV.B Rs, @(d:16, ERd)
-							uint8_t value = *Rd.ptr;
-							setFlagsMOV(value, 8);
-							setMemory8(*Rs.ptr + signExtendedDisp, value);
-							printInstruction("%04x - MOV.b R%d%c, @(%d:16, ER%d), \n", pc, Rd.idx, Rd.loOrHiReg, disp, Rs.idx); 
-							printMemory(*Rs.ptr + signExtendedDisp, 1);
-						}
-						printRegistersState();
-						pc+=2;
-					}break;
-					case 0xF:{ 
-						struct RegRef16 Rd = getRegRef16(bL);
-					struct RegRef32 Rs = getRegRef32(bH);
-						uint16_t disp = cd;
-						bool msbDisp = disp & 0x8000;
-						uint32_t signExtendedDisp = msbDisp ? (0xFFFF0000 | disp) : disp;
-
-						if (!(bH & 0b1000)){ // From memory MOV.W @(d:16, ERs), Rd
-							uint16_t value = getMemory16(*Rs.ptr + signExtendedDisp);
-							*Rd.ptr = value;
-							setFlagsMOV(value, 16);
-
-							printInstruction("%04x - MOV.w @(%d:16, ER%d), %c%d\n", pc, disp, Rs.idx, Rd.loOrHiReg, Rd.idx); 
-
-						} else{ // To memory MOV.W Rs, @(d:16, ERd)
-							uint16_t value = *Rd.ptr;
-							setFlagsMOV(value, 16);
-							setMemory16(*Rs.ptr + signExtendedDisp, value);
-							printInstruction("%04x - MOV.w %c%d, @(%d:16, ER%d), \n", pc, Rd.loOrHiReg, Rd.idx, disp, Rs.idx); 
-							printMemory(*Rs.ptr + signExtendedDisp, 2);
-						}
-						printRegistersState();
-						pc+=2;
-
-
-					}break;
-					default:{
-						return 1;
-					} break;
+				else{
+					*cycles += runHleRoutine(hook->target);
+					skipped = true;
+					if (instrumented){
+						printInstruction("%04x - HLE %s\n", address, hleRoutines[hook->target].name);
+					}
 				}
+				return skipped; // pc is the caller's now, the rest of the hooks don't apply
 			}break;
-			case 0x7:{
-				uint8_t mostSignificantBit = bH >> 7;
-				switch(aL){
-					case 0x0:{ // BSET #xx:3, Rd
-
-						struct RegRef8 Rd = getRegRef8(bL);		
-
-						int bitToSet = bH;
-
-						*Rd.ptr = *Rd.ptr | (1 << bitToSet);
-
-						printInstruction("%04x - BSET #%d, r%d%c\n", pc, bitToSet, Rd.idx, Rd.loOrHiReg);
-						printRegistersState();
-					}break;
-					case 0x1:{
-						return 1; // UNUSED IN THE ROM
-						printInstruction("%04x - BNOT\n", pc);
-					}break;
-					case 0x2:{ // BCLR #xx:3, Rd
-
-						struct RegRef8 Rd = getRegRef8(bL);		
-
-						int bitToClear = bH;
-
-						*Rd.ptr = *Rd.ptr & ~(1 << bitToClear);
-
-						printInstruction("%04x - BCLR #%d, r%d%c\n", pc, bitToClear, Rd.idx, Rd.loOrHiReg);
-						printRegistersState();
-					}break;
-					case 0x3:{
-						struct RegRef8 Rd = getRegRef8(bL);
-						int bitToTest = bH;
-					flags.Z = !(*Rd.ptr & (1<<bitToTest));
-						printInstruction("%04x - BTST #%d, r%d%c\n", pc, bitToTest, Rd.idx, Rd.loOrHiReg);
-					}break;
-					case 0x4:{
-						if (mostSignificantBit == 0x1){
-							printInstruction("%04x - BIOR\n", pc);
-							return 1; // UNIMPLEMENTED
-						}else{
-							printInstruction("%04x - BOR\n", pc);
-							return 1; // UNIMPLEMENTED
-						}
-					}break;
-					case 0x5:{
-						if (mostSignificantBit == 0x1){
-							printInstruction("%04x - BIXOR\n", pc);
-							return 1; // UNIMPLEMENTED
-						}else{
-							printInstruction("%04x - BXOR\n", pc);
-							return 1; // UNIMPLEMENTED
-						}
-					}break;
-					case 0x6:{
-						if (mostSignificantBit == 0x1){
-							printInstruction("%04x - BIAND\n", pc);
-							return 1; // UNIMPLEMENTED
-						}else{
-							printInstruction("%04x - BAND\n", pc);
-							return 1; // UNIMPLEMENTED
-						}
-					}break;
-					case 0x7:{
-						if (mostSignificantBit == 0x1){
-							printInstruction("%04x - BILD\n", pc);
-						}else{ // BLD #xx:3, Rd
-							struct RegRef8 Rd = getRegRef8(bL);		
-
-							int bitToLoad = bH;
-
-							flags.C = *Rd.ptr & (1 << bitToLoad);
-
-							printInstruction("%04x - BLD #%d, r%d%c\n", pc, bitToLoad, Rd.idx, Rd.loOrHiReg);
-							printRegistersState();
-						}					
-					}break;
-					case 0x8:{
-					printInstruction("%04x - MOV\n", pc);
-						return 1; // UNIMPLEMENTED
-					}break;
-					case 0x9:{ // XXX.w #xx:16, Rd
-					struct RegRef16 Rd = getRegRef16(bL);
-						switch(bH){ 
-							case 0x0:{ // MOV.w #xx:16, Rd
-								setFlagsMOV(cd, 16);
-								*Rd.ptr = cd;
-								printInstruction("%04x - MOV.w 0x%x,%c%d\n", pc, cd, Rd.loOrHiReg,  Rd.idx); 
-							}break;
-							case 0x1:{ // ADD.w #xx:16, Rd
-								setFlagsADD(*Rd.ptr, cd, 16);
-								*Rd.ptr += cd;
-								printInstruction("%04x - ADD.w 0x%x,%c%d\n", pc, cd, Rd.loOrHiReg,  Rd.idx); 
-							}break;
-							case 0x2:{ // CMP.w #xx:16, Rd
-								setFlagsSUB(*Rd.ptr, cd, 16);
-								printInstruction("%04x - CMP.w 0x%x,%c%d\n", pc, cd, Rd.loOrHiReg,  Rd.idx); 
-							}break;
-							case 0x3:{ // SUB.w #xx:16, Rd
-								setFlagsSUB(*Rd.ptr, cd, 16);
-								*Rd.ptr -= cd;
-								printInstruction("%04x - SUB.w 0x%x,%c%d\n", pc, cd, Rd.loOrHiReg,  Rd.idx); 
-							}break;
-							case 0x4:{ // OR.w #xx:16, Rd
-								uint16_t value = cd;
-								uint16_t newValue = cd | *Rd.ptr;
-								setFlagsMOV(newValue, 16);
-								*Rd.ptr = newValue;
-								printInstruction("%04x - OR.w 0x%x,%c%d\n", pc, cd, Rd.loOrHiReg,  Rd.idx); 
-							}break;
-							case 0x5:{ // XOR.w #xx:16, Rd
-								uint16_t value = cd;
-								uint16_t newValue = cd ^ *Rd.ptr;
-								setFlagsMOV(newValue, 16);
-								*Rd.ptr = newValue;
-								printInstruction("%04x - XOR.w 0x%x,%c%d\n", pc, cd, Rd.loOrHiReg,  Rd.idx); 
-							}break;
-							case 0x6:{ // AND.w #xx:16, Rd
-								uint16_t value = cd;
-								uint16_t newValue = cd & *Rd.ptr;
-								setFlagsMOV(newValue, 16);
-								*Rd.ptr = newValue;
-								printInstruction("%04x - AND.w 0x%x,%c%d\n", pc, cd, Rd.loOrHiReg,  Rd.idx); 
-							}break;
-							default:{
-								return 1;
-							} break;
-						}
-						printRegistersState();
-						pc+=2;
-					}break;
-					case 0xA:{ // XXX.l #xx:32, ERd
-					struct RegRef32 Rd = getRegRef32(bL);
-						switch(bH){ 
-							case 0x0:{ // MOV.l #xx:32, ERd
-								setFlagsMOV(cdef, 32);
-								*Rd.ptr = cdef;
-								printInstruction("%04x - MOV.l 0x%04x, ER%d\n", pc, cdef,  Rd.idx); 
-							}break;
-							case 0x1:{ // ADD.l #xx:32, ERd
-								setFlagsADD(*Rd.ptr, cdef, 32);
-								*Rd.ptr += cdef;
-								printInstruction("%04x - ADD.l 0x%04x, ER%d\n", pc, cdef,  Rd.idx); 
-							}break;
-							case 0x2:{
-								// CMP.l #xx:32, ERd
-								setFlagsSUB(*Rd.ptr, cdef, 32);
-								printInstruction("%04x - CMP.l 0x%04x, ER%d\n", pc, cdef,  Rd.idx); 
-							}break;
-							case 0x3:{ // SUB.l #xx:32, ERd
-								setFlagsSUB(*Rd.ptr, cdef, 32);
-								*Rd.ptr -= cdef;
-								printInstruction("%04x - SUB.l 0x%04x, ER%d\n", pc, cdef,  Rd.idx); 
-							}break;
-							case 0x4:{ // OR.l #xx:32, ERd
-								uint32_t newValue = cdef | *Rd.ptr;
-								setFlagsMOV(newValue, 32);
-								*Rd.ptr = newValue;
-								printInstruction("%04x - OR.l 0x%04x, ER%d\n", pc, cdef,  Rd.idx); 
-							}break;
-							case 0x5:{ // XOR.l #xx:32, ERd
-								uint32_t newValue = cdef ^ *Rd.ptr;
-								setFlagsMOV(newValue, 32);
-								*Rd.ptr = newValue;
-								printInstruction("%04x - XOR.l 0x%04x, ER%d\n", pc, cdef,  Rd.idx); 
-							}break;
-							case 0x6:{ // AND.l #xx:32, ERd
-								uint32_t newValue = cdef & *Rd.ptr;
-								setFlagsMOV(newValue, 32);
-								*Rd.ptr = newValue;
-								printInstruction("%04x - AND.l 0x%04x, ER%d\n", pc, cdef,  Rd.idx); 
-							}break;
-							default:{
-								return 1;
-							} break;
-						}
-						printRegistersState();
-						pc+=4;
-					}break;
-					case 0xB:{
-						printInstruction("%04x - EEPMOV\n", pc);
-						return 1; // UNIMPLEMENTED
-					}break;
-					case 0xC:{
-						uint8_t mostSignificantBit = dH >> 7;
-						switch(c){
-							case 0x77:{
-								// BLD #xx:3, @ERd
-								struct RegRef32 Rd = getRegRef32(bH);		
-								int bitToLoad = dH;
-								printInstruction("%04x - BLD #%d, @ER%d\n", pc, bitToLoad, Rd.idx);
-								flags.C = getMemory8(*Rd.ptr) & (1 << bitToLoad);
-								printRegistersState();
-								pc+=2;
-
-							}break;
-							default:{
-								return 1;
-							} break;
-
-						}
-					} break;
-					case 0xE:{
-						if (cH == 0x6){
-							switch(cL){
-								case 0x3:{
-									printInstruction("%04x - BTST\n", pc);
-									return 1; // UNIMPLEMENTED
-								}break;
-								default:{
-									return 1;
-								} break;
-							}
-						}else if (cH == 0x7){
-							uint8_t mostSignificantBit = dH >> 7;
-							switch(cL){
-								case 0x3:{
-									printInstruction("%04x - BTST\n", pc);
-									return 1; // UNIMPLEMENTED
-								}break;
-								case 0x4:{
-									if (mostSignificantBit == 0x1){
-										printInstruction("%04x - BIOR\n", pc);
-										return 1; // UNIMPLEMENTED
-									}else{
-										printInstruction("%04x - BOR\n", pc);
-										return 1; // UNIMPLEMENTED
-									}
-								}break;
-								case 0x5:{
-									if (mostSignificantBit == 0x1){
-										printInstruction("%04x - BXOR\n", pc);
-										return 1; // UNIMPLEMENTED
-									}else{
-										printInstruction("%04x - BIXOR\n", pc);
-										return 1; // UNIMPLEMENTED
-									}
-								}break;
-								case 0x6:{
-									if (mostSignificantBit == 0x1){
-										printInstruction("%04x - BIAND\n", pc);
-										return 1; // UNIMPLEMENTED
-									}else{
-										printInstruction("%04x - BAND\n", pc);
-										return 1; // UNIMPLEMENTED
-									}
-								}break;
-								case 0x7:{
-									if (mostSignificantBit == 0x1){
-										printInstruction("%04x - BILD\n", pc);
-									}else{ // BLD #xx:3, @ERd
-										int bitToLoad = dH;
-										uint32_t address = (0x0000FF00) | b;
-										printInstruction("%04x - BLD #%d, @0x%x:8\n", pc, bitToLoad, address);
-										flags.C =  getMemory8(address) & (1 << bitToLoad);
-									}
-								}break;
-								default:{
-									return 1;
-								} break;
-							}
-
-
-						}
-						pc+=2; 
-					}break;
-					case 0xD:{
-					struct RegRef32 Rd = getRegRef32(bH);		
-						switch(c){
-							case 0x70:{ // BSET #xx:3, @ERd
-								int bitToSet = dH;
-								printInstruction("%04x - BSET #%d, @ER%d\n", pc, bitToSet, Rd.idx);
-								setMemory8(*Rd.ptr, getMemory8(*Rd.ptr) | (1 << bitToSet));
-							}break;
-							case 0x60:{ // BSET Rn, @ERd
-								struct RegRef8 Rn = getRegRef8(dH);		
-								int bitToSet = *Rn.ptr;
-								printInstruction("%04x - BSET r%d%c, @ER%d\n", pc, Rn.idx, Rn.loOrHiReg, Rd.idx);
-								setMemory8(*Rd.ptr, getMemory8(*Rd.ptr) | (1 << bitToSet));
-							}break;
-							case 0x71:{ // BNOT #xx:3, @ERd
-								int bitToInvert = dH;
-								bool bitValue = getMemory8(*Rd.ptr) & bitToInvert;
-								if (bitValue == 1){
-									setMemory8(*Rd.ptr, getMemory8(*Rd.ptr) & ~(1 << bitToInvert));
-								} else{
-									setMemory8(*Rd.ptr, getMemory8(*Rd.ptr) | (1 << bitToInvert));
-								}
-								printInstruction("%04x - BNOT #%d, @ER%d\n", pc, bitToInvert, Rd.idx);
-							}break;
-							case 0x72:{ // BCLR #xx:3, @ERd
-								int bitToClear = dH;
-								printInstruction("%04x - BCLR #%d, @ER%d\n", pc, bitToClear, Rd.idx);
-								setMemory8(*Rd.ptr, getMemory8(*Rd.ptr) & ~(1 << bitToClear));
-							}break;
-							case 0x62:{ // BCLR Rn, @ERd
-								struct RegRef8 Rn = getRegRef8(dH);		
-								int bitToClear = *Rn.ptr;
-								printInstruction("%04x - BCLR r%d%c, @ER%d\n", pc, Rn.idx, Rn.loOrHiReg, Rd.idx);
-								setMemory8(*Rd.ptr, getMemory8(*Rd.ptr) & ~(1 << bitToClear));
-							}break;
-							case 0x67:{ // BST ##xx:3, @ERd
-								int bitToSet = dH;
-								if (flags.C == 0){
-									setMemory8(*Rd.ptr, getMemory8(*Rd.ptr) & ~(1 << bitToSet));
-								} else{
-								setMemory8(*Rd.ptr, getMemory8(*Rd.ptr) | (1 << bitToSet));
-								}
-								printInstruction("%04x - BST #%d, @ER%d\n", pc, bitToSet, Rd.idx);
-							}break;
-							default:{
-								return 1;
-							} break;
-						}
-						printMemory(*Rd.ptr, 1);
-						printRegistersState();
-						pc+=2;
-					}break;
-					case 0xF:{
-						uint32_t address = (0x0000FF00) | b;
-						switch(c){
-							case 0x70:{ // BSET #xx:3, @aa:8
-								int bitToSet = dH;
-								printInstruction("%04x - BSET #%d, @0x%x:8\n", pc, bitToSet, address);
-								setMemory8(address, getMemory8(address) | (1 << bitToSet));
-							}break;
-							case 0x60:{ // BSET Rn, @aa:8
-								struct RegRef8 Rn = getRegRef8(dH);		
-								int bitToSet = *Rn.ptr;
-								printInstruction("%04x - BSET r%d%c, @0x%x:8\n", pc, Rn.idx, Rn.loOrHiReg, address);
-								setMemory8(address, getMemory8(address) | (1 << bitToSet));
-							}break;
-							case 0x72:{ // BCLR #xx:3, @aa:8
-								int bitToClear = dH;
-								printInstruction("%04x - BCLR #%d, @0x%x:8\n", pc, bitToClear, address);
-								setMemory8(address, getMemory8(address) & ~(1 << bitToClear));
-							}break;
-							case 0x62:{ // BCLR Rn, @aa:8
-								struct RegRef8 Rn = getRegRef8(dH);		
-								int bitToClear = *Rn.ptr;
-								printInstruction("%04x - BCLR r%d%c, @0x%x:8\n", pc, Rn.idx, Rn.loOrHiReg, address);
-								setMemory8(address, getMemory8(address) & ~(1 << bitToClear));
-
-							}break;
-							case 0x67:{ // BST - Unused in the ROM
-								return 1;
-							} break;
-							default:{
-								return 1;
-							} break;
-						}
-						printMemory(address, 1);
-						pc+=2;
-					} break;
-					default:{
-						return 1;
-					} break;
+			case HOOK_MEMO:{
+				struct MemoRoutine_t* routine = &memoRoutines[hook->target];
+				if (routine->impure || memoRecording.active){
+					break;
+				}
+				if (memoLookup(routine, cycles)){
+					if (instrumented){
+						printInstruction("%04x - MEMO hit\n", address);
+					}
+					return true;
+				}
+				startMemoRecording(routine);
+				if (!instrumented){
+					// Nothing ran yet, the instrumented core takes it from the routine's first instruction and the hook after this one
+					hookResumeIndex = i + 1;
+					hookResumeAddress = address;
+					return true;
 				}
 			}break;
-			case 0x8:{ // ADD.B #xx:8, Rd
-				struct RegRef8 Rd = getRegRef8(aL);
-
-				uint8_t value = (bH << 4) | bL;
-
-				setFlagsADD(*Rd.ptr, value, 8);
-				*Rd.ptr += value;
-
-				printInstruction("%04x - ADD.b 0x%x,R%d%c\n", pc, value, Rd.idx, Rd.loOrHiReg); //Note: Dmitry's dissasembler sometimes outputs address in decimal (0xdd) not sure why
-				printRegistersState();
-			}break;
-			case 0x9:{
-				printInstruction("%04x - ADDX\n", pc);
-				return 1; // UNIMPLEMENTED
-			}break;
-
-			case 0xA:{ // CMP.B #xx:8, Rd
-				struct RegRef8 Rd = getRegRef8(aL);
-
-				uint8_t value = (bH << 4) | bL;
-
-				setFlagsSUB(*Rd.ptr, value, 8);
-
-				printInstruction("%04x - CMP.b 0x%x,R%d%c\n", pc, value, Rd.idx, Rd.loOrHiReg); 
-				printRegistersState();
-
-			}break;
-
-			case 0xB:{
-				printInstruction("%04x - SUBX\n", pc);
-				return 1; // UNIMPLEMENTED
-			}break;
-
-			case 0xC:{ // OR.b #xx:8, Rd
-				struct RegRef8 Rd = getRegRef8(aL);
-
-				uint8_t value = b;
-				uint8_t newValue = value | *Rd.ptr;
-				setFlagsMOV(newValue, 8);
-				*Rd.ptr = newValue;
-
-				printInstruction("%04x - OR.b 0x%x,R%d%c\n", pc, value, Rd.idx, Rd.loOrHiReg); 
-				printRegistersState();
-			}break;
-
-			case 0xD:{ // XOR.b #xx:8, Rd
-				struct RegRef8 Rd = getRegRef8(aL);
-
-				uint8_t value = b;
-				uint8_t newValue = value ^ *Rd.ptr;
-				setFlagsMOV(newValue, 8);
-				*Rd.ptr = newValue;
+		}
+	}
+	return skipped;
+}
 
-				printInstruction("%04x - XOR.b 0x%x,R%d%c\n", pc, value, Rd.idx, Rd.loOrHiReg); 
-				printRegistersState();
-			}break;
+void enterInterrupt(uint16_t vector){
+	interruptSavedAddress = pc;
+	interruptSavedFlags = flags;
+	flags.I = true;
+	pendingInterrupts = 0;
+	pc = vector;
+	sleep = false;
+	interruptsTaken += 1;
+}
 
-			case 0xE:{ // AND #xx:8, Rd
-				struct RegRef8 Rd = getRegRef8(aL);
+static const uint16_t interruptVectors[] = {VECTOR_IRQ0, VECTOR_RTC_QUARTER_SEC, VECTOR_RTC_HALF_SEC, VECTOR_RTC_EVERY_SEC, VECTOR_TIMER_B1};
 
-				uint8_t value = b;
-				uint8_t newValue = value & *Rd.ptr;
-				setFlagsMOV(newValue, 8);
-				*Rd.ptr = newValue;
+// Takes the highest priority interrupt in pendingInterrupts, which must not be 0
+void takePendingInterrupt(){
+	int source = countTrailingZeros(pendingInterrupts);
+	enterInterrupt(interruptVectors[source]);
+	if (source == INTERRUPT_IRQ0){
+		addElement(&inputQueue, ENTER);
+		addElement(&inputQueue, 0);
+	}
+}
 
-				printInstruction("%04x - AND.b 0x%x,R%d%c\n", pc, value, Rd.idx, Rd.loOrHiReg); 
-				printRegistersState();
-			}break;
+void runSubClock(){
+	if (!isEmpty(&keyQueue)){
+		processKeys();
+	}
+	// Timer handling
+	if (TimerB.on && ((subClockCyclesEllapsed % 256) == 0)){ // TODO(custom ROMs): parameterize frequency
+		if(++(*TimerB.TCB1) == 0){
+			*IRQ_IRR2 |= IRRTB1;
+			updatePendingInterrupts();
+			*TimerB.TCB1 = TimerB.TLBvalue;
+		}
+	}
+	if (TimerW.on){ // Count every subclock
+		if(*TimerW.TMRW & CTS){
+			setMemory16(TCNT_ADDRESS, getMemory16(TCNT_ADDRESS) + 1); 
+		}
+		if (getMemory16(TCNT_ADDRESS) == getMemory16(0xf0f8)){ // TCNT == GRA
+			if (*TimerW.TCRW & CCLR){
+				setMemory16(TCNT_ADDRESS, 0);
+			}
+			*TimerW.TSRW |= 0x1; // IMFA
+			if (*TimerW.TIERW & 0x1){ // IMIEA - Interrupt enabled A
+				if (!flags.I){
+					enterInterrupt(VECTOR_TIMER_W);
+				}
+			}
+		}
+	}
 
-			case 0xF:{ // MOV.B #xx:8, Rd
-				struct RegRef8 Rd = getRegRef8(aL);
+	// have to do this so that we don't count the instructions from the first cycle the timer is on
+	// since it should count in parallell to CPU execution
+	TimerB.on = (*CKSTPR1 & TB1CKSTP) && (*TimerB.TMB1 & TMB_COUNTING);
+	TimerW.on = (*CKSTPR2 & TWCKSTP) && (*TimerW.TMRW & CTS);
+}
 
-				uint8_t value = b;
+// Lets 'cycles' pass for everything that isn't the CPU
+int advanceClock(uint64_t* cycleCount, uint32_t cycles){
+	cyclesRun += cycles;
+	if (cyclesRun >= SSU.completionCycle){
+		if (!ssuTransferByte()){
+			return 1;
+		}
+	}
+	for(uint32_t i = 0; i < cycles; i++){
+		*cycleCount += 1;
+		if ((*cycleCount % (SYSTEM_CLOCK_CYCLES_PER_SECOND / SUB_CLOCK_CYCLES_PER_SECOND)) == 0){ 
+			subClockCyclesEllapsed += 1;
+			runSubClock();
+		}
+	}
+	return 0;
+}
 
-				setFlagsMOV(value, 8);
-				*Rd.ptr = value;
+// States taken by every instruction, from the H8/300H manual's execution state tables (normal mode, all memory is
+// on-chip so every access takes 2 states). Indexed by the first opcode byte, which picks the form and addressing
+// mode of everything but the 0x01 prefixed instructions. 0 marks the prefix.
+static const uint8_t opcodeStates[256] = {
+	 2, 0, 2, 2,  2, 2, 2, 2,  2, 2, 2, 2,  2, 2, 2, 2, // 0x0_: register ALU, MOV, CCR
+	 2, 2, 2, 2,  2, 2, 2, 2,  2, 2, 2, 2,  2, 2, 2, 2, // 0x1_: shifts, rotates, register ALU
+	 4, 4, 4, 4,  4, 4, 4, 4,  4, 4, 4, 4,  4, 4, 4, 4, // 0x2_: MOV.B @aa:8, Rd
+	 4, 4, 4, 4,  4, 4, 4, 4,  4, 4, 4, 4,  4, 4, 4, 4, // 0x3_: MOV.B Rs, @aa:8
+	 4, 4, 4, 4,  4, 4, 4, 4,  4, 4, 4, 4,  4, 4, 4, 4, // 0x4_: Bcc d:8, taken or not
+	14,14,22,22,  8, 6,10,14,  6, 4, 6, 8,  8, 6, 8, 8, // 0x5_: MULXU, DIVXU, RTS, BSR, RTE, TRAPA, Bcc d:16, JMP, JSR
+	 2, 2, 2, 2,  2, 2, 2, 2,  4, 4, 6, 6,  6, 6, 6, 6, // 0x6_: register bit ops, MOV.B/W @ERs, @aa:16, @ERs+/@-ERd, @(d:16,ERs)
+	 2, 2, 2, 2,  2, 2, 2, 2, 10, 4, 6, 8,  6, 8, 6, 8, // 0x7_: register bit ops, MOV @(d:24,ERs), #xx:16, #xx:32, EEPMOV (+4 per byte), memory bit ops
+	 2, 2, 2, 2,  2, 2, 2, 2,  2, 2, 2, 2,  2, 2, 2, 2, // 0x8_ - 0xF_: #xx:8 ALU and MOV
+	 2, 2, 2, 2,  2, 2, 2, 2,  2, 2, 2, 2,  2, 2, 2, 2,
+	 2, 2, 2, 2,  2, 2, 2, 2,  2, 2, 2, 2,  2, 2, 2, 2,
+	 2, 2, 2, 2,  2, 2, 2, 2,  2, 2, 2, 2,  2, 2, 2, 2,
+	 2, 2, 2, 2,  2, 2, 2, 2,  2, 2, 2, 2,  2, 2, 2, 2,
+	 2, 2, 2, 2,  2, 2, 2, 2,  2, 2, 2, 2,  2, 2, 2, 2,
+	 2, 2, 2, 2,  2, 2, 2, 2,  2, 2, 2, 2,  2, 2, 2, 2,
+	 2, 2, 2, 2,  2, 2, 2, 2,  2, 2, 2, 2,  2, 2, 2, 2,
+};
+
+// 0x0100 (MOV.L), 0x01C0 (MULXS), 0x01D0 (DIVXS) and 0x01F0 (AND/OR/XOR.L) take the second word's first byte as
+// their opcode, indexed by it. The other 0x01 prefixes (SLEEP, LDC/STC, unimplemented) take 2.
+static const uint8_t longOpcodeStates[256] = {
+	[0x50] = 16, [0x51] = 16, [0x52] = 24, [0x53] = 24, // MULXS.B, DIVXS.B, MULXS.W, DIVXS.W
+	[0x64] = 4, [0x65] = 4, [0x66] = 4, // OR.L, XOR.L, AND.L
+	[0x69] = 8, [0x6B] = 10, [0x6D] = 10, [0x6F] = 10, [0x78] = 14, // MOV.L @ERs, @aa:16, @ERs+/@-ERd, @(d:16,ERs), @(d:24,ERs)
+};
+
+static inline uint32_t instructionStates(uint8_t a, uint8_t b, uint8_t c){
+	if (a != 0x01){
+		return opcodeStates[a];
+	}
+	uint8_t bH = b >> 4; // Like the decoder, which ignores bL
+	if ((bH == 0x0 || bH == 0xC || bH == 0xD || bH == 0xF) && longOpcodeStates[c]){
+		return longOpcodeStates[c];
+	}
+	return 2;
+}
 
-				printInstruction("%04x - MOV.b 0x%x,R%d%c\n", pc, value, Rd.idx, Rd.loOrHiReg); 
-				printRegistersState();
-			}break;
+#define INSTRUMENTED 0
+#define CORE_FUNCTION executeFastInstruction
+#include "cpu.c"
+#undef INSTRUMENTED
+#undef CORE_FUNCTION
+
+#define INSTRUMENTED 1
+#define CORE_FUNCTION executeInstrumentedInstruction
+#include "cpu.c"
+#undef INSTRUMENTED
+#undef CORE_FUNCTION
+
+// Sampling profiler, finds where the ROM spends its time awake (e.g. routines worth an HLE replacement)
+#define PROFILE_SAMPLE_CYCLES 997 // Prime, so samples don't lock onto loops
+#define PROFILE_TOP_COUNT 64
+static bool profiling;
+static uint64_t nextProfileSample;
+static uint32_t pcSamples[MEM_SIZE];
+static uint32_t sleepSamples;
+
+void setProfiling(bool enabled){
+	profiling = enabled;
+	nextProfileSample = cyclesRun;
+}
 
-			default:{
-				printInstruction("???\n");
-				return 1; // UNIMPLEMENTED
-			} break;
-		}
+int compareSampleCounts(const void* a, const void* b){
+	uint32_t countA = pcSamples[*(const uint16_t*)a];
+	uint32_t countB = pcSamples[*(const uint16_t*)b];
+	return (countA < countB) - (countA > countB);
+}
 
-		// SSU cleanup
-		if((getMemory8(PORT9)) & ACCEL_PIN){ 
-			accel.buffer.state = ACCEL_GETTING_ADDRESS;
-			accel.buffer.offset = 0x0;
-		}
+bool dumpProfile(const char* fileName){
+	FILE* profileFile = fopen(fileName, "w");
+	if (!profileFile){
+		printf("Can't open %s for writing\n", fileName);
+		return false;
+	}
+	uint64_t awakeSamples = 0;
+	uint16_t* addresses = malloc(MEM_SIZE * sizeof(uint16_t));
+	for(uint32_t i = 0; i < MEM_SIZE; i++){
+		addresses[i] = i;
+		awakeSamples += pcSamples[i];
+	}
+	qsort(addresses, MEM_SIZE, sizeof(uint16_t), compareSampleCounts);
+	fprintf(profileFile, "%llu samples awake, %u asleep, one every %d cycles\n", (unsigned long long)awakeSamples, sleepSamples, PROFILE_SAMPLE_CYCLES);
+	for(int i = 0; i < PROFILE_TOP_COUNT && pcSamples[addresses[i]]; i++){
+		fprintf(profileFile, "%04x %10u %6.2f%%\n", addresses[i], pcSamples[addresses[i]], 100.0 * pcSamples[addresses[i]] / awakeSamples);
+	}
+	free(addresses);
+	fclose(profileFile);
+	return true;
+}
 
-		if((getMemory8(PORT1)) & EEPROM_PIN){ // TODO: can be optimized by checking when the pin gets sets instead of all the time
-			eeprom.buffer.state = EEPROM_EMPTY;
-			eeprom.buffer.offset = 0x0;
-			eeprom.buffer.offset = 0x0;
-		}
-		pc+=2;
-
-	}
-	// Interrupt handling
-	// Note: Remember to check priorities when adding interrupt types here
-	// TODO: this doesnt follow this rule: 3.8.4 Conflict between Interrupt Generation and Disabling
-	if (!flags.I){
-		if ((*IRQ_IRR1 & IRRI0) && (*IRQ_IENR1 & IEN0)){
-			interruptSavedAddress = pc;
-			interruptSavedFlags = flags;
-			flags.I = true;
-			pc = VECTOR_IRQ0;
-			addElement(&inputQueue, ENTER);
-			addElement(&inputQueue, 0);
-			sleep = false;
+int runInstrumentedInstruction(uint64_t* cycleCount){
+	if (profiling && cyclesRun >= nextProfileSample){
+		if (sleep){
+			sleepSamples += 1;
 		}
-		else if (*IRQ_IENR1 & IENRTC){
-			if (*RTCFLG & _025SEIFG){
-				interruptSavedAddress = pc;
-				interruptSavedFlags = flags;
-				flags.I = true;
-				pc = VECTOR_RTC_QUARTER_SEC;
-				sleep = false;
-			}
-			else if (*RTCFLG & _05SEIFG){
-				interruptSavedAddress = pc;
-				interruptSavedFlags = flags;
-				flags.I = true;
-				pc = VECTOR_RTC_HALF_SEC;
-				sleep = false;
-			}
-			else if (*RTCFLG & _1SEIFG){
-				interruptSavedAddress = pc;
-				interruptSavedFlags = flags;
-				flags.I = true;
-				pc = VECTOR_RTC_EVERY_SEC;
-				sleep = false;
-			}
+		else{
+			pcSamples[pc] += 1;
 		}
-		else if ((*IRQ_IRR2 & IRRTB1) && (*IRQ_IENR2 & IENTB1)){
-			interruptSavedAddress = pc;
-			interruptSavedFlags = flags;
-			flags.I = true;
-			pc = VECTOR_TIMER_B1;
-			sleep = false;
-		}
-		
+		nextProfileSample = cyclesRun + PROFILE_SAMPLE_CYCLES;
 	}
 
-	// Clock handling
-	uint32_t cyclesEllapsed = 2; // TODO: determine based on instruction type
-	for(uint32_t i = 0; i < cyclesEllapsed; i++){
-		*cycleCount += 1;
-		// SSU
-		if ((*cycleCount % 4) == 0){ // TODO(Custom ROMs): Parameterize 
-			if (~*SSU.SSER & TE){ // TE == 0
-				*SSU.SSSR |= TDRE; // Set TDRE
-			}
-
-			if ((*SSU.SSER & (TE | RE)) == (TE | RE)){ // Transmission and recieve enabled
-				if(~*SSU.SSSR & TDRE){ 
-					// Here we'll start the transmission that'll take 8 cycles. But for now it happens instantly.
-					// Accelerometer
-					// TODO: check all the RDRF | TDRE stuff once we begin sampling the accel, it's proablby wrong the way its coded now
-					if(~(getMemory8(PORT9)) & ACCEL_PIN){ // TODO: find more readable way to deal with pins
-						switch(accel.buffer.state){
-							case ACCEL_GETTING_ADDRESS:{
-								accel.buffer.address = *SSU.SSTDR & 0x0F; // The "&" removes 0x80 (RW flag, not part of the address)
-								accel.buffer.offset = 0;
-								accel.buffer.state = ACCEL_GETTING_BYTES;
-								*SSU.SSSR = *SSU.SSSR | RDRF; 
-							}break;
-							case ACCEL_GETTING_BYTES:{
-								*SSU.SSRDR = accel.memory[(accel.buffer.address) + accel.buffer.offset]; 
-								accel.buffer.offset += 1;
-								*SSU.SSSR = *SSU.SSSR | RDRF; 
-								*SSU.SSSR = *SSU.SSSR | TDRE; 
-								*SSU.SSSR = *SSU.SSSR | TEND; 
-							}break;
-						}
-					}
-					// EEPROM
-					else if(~(getMemory8(PORT1)) & EEPROM_PIN){ 
-						bool ssuOpFinished = false;
-						SSU.progress += 1;
-						if (SSU.progress == 7){
-							SSU.progress = 0;
-							ssuOpFinished = true;
-						}
-						if (ssuOpFinished){
-							switch(eeprom.buffer.state){
-								case EEPROM_EMPTY:{
-									switch(*SSU.SSTDR){
-										case 0x3:{ // READ - read from memory
-											eeprom.buffer.state = EEPROM_GETTING_ADDRESS_HI;
-										} break;
-										case 0x5:{ // RDSR - read status register
-											eeprom.buffer.state = EEPROM_GETTING_STATUS_REGISTER;
-										} break;
-									}
-								} break;
-								case EEPROM_GETTING_STATUS_REGISTER:{
-									*SSU.SSRDR = eeprom.status; 
-									*SSU.SSSR = *SSU.SSSR | TEND;
-								} break;
-								case EEPROM_GETTING_ADDRESS_HI:{
-									eeprom.buffer.hiAddress = *SSU.SSTDR;
-									eeprom.buffer.state = EEPROM_GETTING_ADDRESS_LO;
-								} break;
-
-								case EEPROM_GETTING_ADDRESS_LO:{
-									eeprom.buffer.loAddress = *SSU.SSTDR;
-									eeprom.buffer.state = EEPROM_GETTING_BYTES;
-								} break;
-
-								case EEPROM_GETTING_BYTES:{
-									*SSU.SSRDR = eeprom.memory[((eeprom.buffer.hiAddress << 8) | eeprom.buffer.loAddress) + eeprom.buffer.offset];
-									eeprom.buffer.offset  = (eeprom.buffer.offset + 1);
-									*SSU.SSSR = *SSU.SSSR | TEND; 
-									
-								} break;
-							}
-							*SSU.SSSR = *SSU.SSSR | RDRF; // Wait for rx
-							*SSU.SSSR = *SSU.SSSR | TDRE;
-					}
-				}
-			}
-			}
-			else if (*SSU.SSER & TE){ 
-				if(~*SSU.SSSR & TDRE){ 
-					// Accelerometer
-					if(~(getMemory8(PORT9)) & ACCEL_PIN){ 
-						switch(accel.buffer.state){
-							case ACCEL_GETTING_ADDRESS:{
-								accel.buffer.address = *SSU.SSTDR;
-								accel.buffer.state = ACCEL_GETTING_BYTES;
-								*SSU.SSSR = *SSU.SSSR | RDRF; 
-							}break;
-							case ACCEL_GETTING_BYTES:{
-								accel.memory[accel.buffer.address] = *SSU.SSTDR;
-								*SSU.SSSR = *SSU.SSSR | RDRF; 
-								*SSU.SSSR = *SSU.SSSR | TDRE; 
-								*SSU.SSSR = *SSU.SSSR | TEND; 
-							}break;
-						}
-					}
-					// EEPROM
-					if(~(getMemory8(PORT1)) & EEPROM_PIN){ 
-						bool ssuOpFinished = false;
-						SSU.progress += 1;
-						if (SSU.progress == 7){
-							SSU.progress = 0;
-							ssuOpFinished = true;
-						}
-						if (ssuOpFinished){
-							switch (eeprom.buffer.state) {
-								case EEPROM_EMPTY:{
-									switch(*SSU.SSTDR){
-										case 0x6:{ // WREN - write enable
-											eeprom.status |= 0x2; // WEL - write enable latch. Note: I dont see any WRDI or WRSR instructions in the ROM that disable this latch, could cause issues later on
-											*SSU.SSSR = *SSU.SSSR | TEND;
-										}break;
-										case 0x2: { // WRITE
-											eeprom.buffer.state = EEPROM_GETTING_ADDRESS_HI;
-										}break;
-									}
-
-								} break;
-								case EEPROM_GETTING_ADDRESS_HI:{
-									eeprom.buffer.hiAddress = *SSU.SSTDR;
-									eeprom.buffer.state = EEPROM_GETTING_ADDRESS_LO;
-								} break;
-
-								case EEPROM_GETTING_ADDRESS_LO:{
-									eeprom.buffer.loAddress = *SSU.SSTDR;
-									eeprom.buffer.state = EEPROM_GETTING_BYTES;
-								} break;
-
-								case EEPROM_GETTING_BYTES:{
-									eeprom.memory[((eeprom.buffer.hiAddress << 8) | eeprom.buffer.loAddress) + eeprom.buffer.offset] = *SSU.SSTDR;
-									eeprom.buffer.offset = (eeprom.buffer.offset + 1) % EEPROM_PAGE_SIZE;
-									*SSU.SSSR = *SSU.SSSR | TEND;
-								} break;
-
-								default:{
-									return 1; // Invalid state
-								}
-							}
-							*SSU.SSSR = *SSU.SSSR | TDRE; 
-						}
-					}
+	bool traced = traceEnabled && !sleep;
+	if (traced){
+		uint32_t registers[8];
+		getRegisters(registers);
+		traceBeginInstruction(pc, memory + pc, cyclesRun, registers, getFlags());
+	}
 
-					// LCD
-					if((getMemory8(PORT1)) & LCD_DATA_PIN){ 
-						bool ssuOpFinished = false;
-						SSU.progress += 1;
-						if (SSU.progress == 7){
-							SSU.progress = 0;
-							ssuOpFinished = true;
-						}
-						if(ssuOpFinished){
-							size_t lcdMemIndex = (lcd.currentPage * LCD_WIDTH * LCD_BYTES_PER_STRIPE) + lcd.currentColumn*LCD_BYTES_PER_STRIPE + lcd.currentByte;
-							assert(lcdMemIndex < LCD_MEM_SIZE);
-							lcd.memory[lcdMemIndex] = *SSU.SSTDR;	
-							if (lcd.currentByte == 1){
-							lcd.currentColumn = (lcd.currentColumn + 1);
-							}
-							lcd.currentByte = (lcd.currentByte + 1) % 2;
-							*SSU.SSSR = *SSU.SSSR | TDRE; 
-							*SSU.SSSR = *SSU.SSSR | TEND;
-						}
-					}
-					else if(~(getMemory8(PORT1)) & LCD_PIN){
-						switch(lcd.state){
-							case LCD_EMPTY:{
-								switch(*SSU.SSTDR){
-									case 0x00:
-									case 0x01:
-									case 0x02:
-									case 0x03:
-									case 0x04:
-									case 0x05:
-									case 0x06:
-									case 0x07:
-									case 0x08:
-									case 0x09:
-									case 0x0A:
-									case 0x0B:
-									case 0x0C:
-									case 0x0D:
-									case 0x0E:
-									case 0x0F:{
-										lcd.currentColumn = (*SSU.SSTDR & 0xF) | (lcd.currentColumn & 0xF0); // Set lower column address
-										lcd.currentByte = 0;
-									}break;
-									case 0x10:
-									case 0x11:
-									case 0x12:
-									case 0x13:
-									case 0x14:
-									case 0x15:
-									case 0x16:
-									case 0x17:{
-										lcd.currentColumn = ((*SSU.SSTDR & 0b111) << 4) | (lcd.currentColumn & 0xF); // Set upper column address
-										lcd.currentByte = 0;
-									} break;
-									case 0xB0:
-									case 0xB1:
-									case 0xB2:
-									case 0xB3:
-									case 0xB4:
-									case 0xB5:
-									case 0xB6:
-									case 0xB7:
-									case 0xB8:
-									case 0xB9:
-									case 0xBA:
-									case 0xBB:
-									case 0xBC:
-									case 0xBD:
-									case 0xBE:
-									case 0xBF:{
-										lcd.currentPage = *SSU.SSTDR & 0xF;
-									}break;
-									case 0x81:{
-										lcd.state = LCD_READING_CONTRAST;
-									} break;
-									default:{
-										// We'll ignore most commands
-									} break;
-								}
-							} break;
-							case LCD_READING_CONTRAST:{
-								lcd.contrast = *SSU.SSTDR;
-								lcd.state = LCD_EMPTY;
-							}break;
-
-						}
-					*SSU.SSSR = *SSU.SSSR | TDRE; 
-					*SSU.SSSR = *SSU.SSSR | TEND;
-					}
-				}
-			}
-			else if (*SSU.SSER & RE){ 
-				return 1; // TODO: Check if this mode is used in the ROM
-			}
-		}
+	int error = executeInstrumentedInstruction(cycleCount);
+	if (hleCheck.pending){
+		checkHleValidation();
+	}
+	if (memoRecording.active){
+		checkMemoRecording();
+	}
 
-		if ((*cycleCount % (SYSTEM_CLOCK_CYCLES_PER_SECOND / SUB_CLOCK_CYCLES_PER_SECOND)) == 0){ 
-			subClockCyclesEllapsed += 1;
-			runSubClock();
+	if (traced){
+		uint32_t registers[8];
+		getRegisters(registers);
+		traceEndInstruction(registers, getFlags());
+	}
+	if (error){
+		printf("Can't execute instruction at %04x\n", pc);
+		if (traceEnabled && dumpTrace("trace.bin")){
+			printf("Trace written to trace.bin\n");
 		}
 	}
-	
-	return 0;	
+	return error;
+}
+
+int (*runNextInstruction)(uint64_t* cycleCount) = executeFastInstruction;
+
+void setInstrumentation(bool enabled){
+	runNextInstruction = enabled ? runInstrumentedInstruction : executeFastInstruction;
+}
+
+void setPrintState(bool enabled){
+	printingState = enabled;
 }
 
 void initWalker(){
+#ifdef INIT_EEPROM
+	initWalkerFromFiles("rom.bin", NULL);
+#else
+	initWalkerFromFiles("rom.bin", "eeprom.bin");
+#endif
+}
+
+bool initWalkerFromFiles(const char* romPath, const char* eepromPath){
 	memset(&inputQueue, 0 , sizeof(inputQueue));
+	memset(&keyQueue, 0 , sizeof(keyQueue));
+
+	hookCount = 0;
+	hookResumeIndex = -1;
+	memset(hookBitmap, 0, sizeof(hookBitmap));
+	memoRoutineCount = 0;
+	memoRecording.active = false;
+	memset(memoPageGenerations, 0, sizeof(memoPageGenerations));
+	if (!loadHooks("hooks.cfg")){
+		for(size_t i = 0; i < sizeof(defaultHooks)/sizeof(defaultHooks[0]); i++){
+			addHook(defaultHooks[i]);
+		}
+	}
 	int entry = 0x02C4;
 
 	sleep = false;
+	cyclesRun = 0;
 	uint64_t subClockCyclesEllapsed = 0;
 	
-	memory = malloc(MEM_SIZE);
+	if (!memory){
+		memory = mapAddressSpace(MEM_SIZE);
+		if (!memory){
+			printf("Can't reserve the emulated address space");
+			exit(1);
+		}
+	}
 	memset(memory, 0, MEM_SIZE);
+
+	memset(mmioPages, 0, sizeof(mmioPages));
+	memset(pageMmio, 0, sizeof(pageMmio));
+	uint32_t mirrors[3] = {0, MEM_SIZE, ADDRESS_SPACE_SIZE - MEM_SIZE};
+	for(int i = 0; i < 3; i++){
+		pageMmio[(mirrors[i] + 0xF000) >> 8] = 1;
+		pageMmio[(mirrors[i] + 0xFF00) >> 8] = 2;
+	}
+	setMmioHandlers(SSRDR_ADDRESS, readSSRDR, NULL);
+	setMmioHandlers(SSTDR_ADDRESS, NULL, writeSSTDR);
+	setMmioHandlers(SSER_ADDRESS, NULL, writeSSERorSSSR);
+	setMmioHandlers(SSSR_ADDRESS, NULL, writeSSERorSSSR);
+	setMmioHandlers(TLB1_ADDRESS, NULL, writeTLB1);
+	setMmioHandlers(IENR1_ADDRESS, NULL, writeInterruptEnable);
+	setMmioHandlers(IENR2_ADDRESS, NULL, writeInterruptEnable);
+	setMmioHandlers(IRR1_ADDRESS, NULL, writeInterruptFlags);
+	setMmioHandlers(IRR2_ADDRESS, NULL, writeInterruptFlags);
+	setMmioHandlers(RTCFLG_ADDRESS, NULL, writeInterruptFlags);
+	if (memoRoutineCount){
+		watchRamPages();
+	}
 	
 	memset(&eeprom, 0, sizeof(eeprom));
 	eeprom.memory = malloc(EEPROM_SIZE);
 	memset(eeprom.memory, 0xFF, EEPROM_SIZE);
 
-#ifndef INIT_EEPROM
-	FILE *eepromFile = fopen("eeprom.bin", "r");
-	fread(eeprom.memory, 1, 64* 1024, eepromFile);
-	fclose(eepromFile);
-#endif
+	if (eepromPath){
+		FILE *eepromFile = fopen(eepromPath, "rb");
+		if(!eepromFile){
+			printf("Can't find eeprom %s\n", eepromPath);
+			return false;
+		}
+		fread(eeprom.memory, 1, EEPROM_SIZE, eepromFile);
+		fclose(eepromFile);
+	}
 
 	memset(&accel, 0, sizeof(accel));
-	accel.memory = malloc(29);
-	memset(accel.memory, 0, 29);
+	accel.memory = malloc(ACCEL_MEM_SIZE);
+	memset(accel.memory, 0, ACCEL_MEM_SIZE);
 	accel.memory[0] = 0x2; // Chip id
 
 	memset(&lcd, 0, sizeof(lcd));
 	lcd.contrast = 20;
 	lcd.state = LCD_EMPTY;
 	lcd.memory = malloc(LCD_MEM_SIZE);
-
-	FILE* romFile = fopen("rom.bin","r");
+	memset(lcd.memory, 0, LCD_MEM_SIZE);
+	memset(lcd.dirtySpans, 0xFF, sizeof(lcd.dirtySpans)); // Nothing decoded yet
+	lcd.changed = true;
+	lcd.currentBuffer = 1; // The first quarter second flips it to 0
+	lastDirtyBuffer = -1;
+	initLcdDecoder(&lcdDecoder, palette);
+
+	FILE* romFile = fopen(romPath, "rb");
 	if(!romFile){
-		printf("Can't find rom");
+		printf("Can't find rom %s\n", romPath);
+		return false;
 	}
 
 	fseek (romFile , 0 , SEEK_END);
@@ -2875,6 +1370,11 @@ void initWalker(){
 	SSU.SSRDR = &memory[0xF0E9]; 
 	SSU.SSTDR = &memory[0xF0EB]; 
 	SSU.SSTRSR = 0x0; 
+	SSU.completionCycle = SSU_IDLE;
+	SSU.deviceCount = 0;
+	attachSsuDevice(&accelDevice);
+	attachSsuDevice(&eepromDevice);
+	attachSsuDevice(&lcdDevice);
 
 	*SSU.SSRDR = 0x0; 
 	*SSU.SSTDR = 0x0;
@@ -2934,33 +1434,40 @@ void initWalker(){
 	setMemory8(0xFFFA, 0b00000100);
 
 	// Init Interrupt stuff
-	IRQ_IENR1 = &memory[0xfff3];
+	IRQ_IENR1 = &memory[IENR1_ADDRESS];
 	*IRQ_IENR1 = 0;
-	IRQ_IENR2 = &memory[0xfff4];
+	IRQ_IENR2 = &memory[IENR2_ADDRESS];
 	*IRQ_IENR2 = 0;
-	IRQ_IRR1 = &memory[0xfff6];
+	IRQ_IRR1 = &memory[IRR1_ADDRESS];
 	*IRQ_IRR1 = 0;
-	IRQ_IRR2 = &memory[0xfff7];
+	IRQ_IRR2 = &memory[IRR2_ADDRESS];
 	*IRQ_IRR2 = 0;
-	RTCFLG = &memory[0xf067];
+	RTCFLG = &memory[RTCFLG_ADDRESS];
 	*RTCFLG = 0;
+	updatePendingInterrupts();
 	interruptSavedAddress = 0;
 
 	quartersEllapsed = 0;
 	pc = entry;
-
+	return true;
 }
 
 void halfRTCInterrupt(){
-	*RTCFLG |= _05SEIFG ;
+	*RTCFLG |= _05SEIFG;
+	updatePendingInterrupts();
 }
 
 void secondRTCInterrupt(){
-	*RTCFLG |= _1SEIFG ;
+	*RTCFLG |= _1SEIFG;
+	updatePendingInterrupts();
 }
 
 void quarterRTCInterrupt(){
-	*RTCFLG |= _025SEIFG ;
+	if (!lcd.startLineSet){ // Legacy guess at which buffer is on screen
+		lcd.currentBuffer = !lcd.currentBuffer;
+	}
+	*RTCFLG |= _025SEIFG;
+	updatePendingInterrupts();
 	quartersEllapsed += 1;
 	if((quartersEllapsed % 2) == 0){
 		halfRTCInterrupt();
@@ -3,6 +3,8 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+#include "lcdDecode.h"
+
 #define SYSTEM_CLOCK_CYCLES_PER_SECOND 3686400 /* 3.6864 MHz */
 #define SUB_CLOCK_CYCLES_PER_SECOND 32768 /* 32.768 KHz */
 
@@ -13,8 +15,28 @@
 #define LCD_WIDTH 96
 #define LCD_HEIGHT 64
 
-void initWalker(); // Must be called once before the main loop
-int runNextInstruction(uint64_t* cycleCount); // Must be called once every main loop iteration and given a cycleCount variable defined globally
+void initWalker(); // Must be called once before the main loop. Loads rom.bin and eeprom.bin from the working directory
+bool initWalkerFromFiles(const char* romPath, const char* eepromPath); // Same as initWalker with explicit paths. A NULL eepromPath starts with a blank EEPROM. Returns false if a file can't be read
+extern int (*runNextInstruction)(uint64_t* cycleCount); // Must be called once every main loop iteration and given a cycleCount variable defined globally
 void fillVideoBuffer(uint32_t* videoBuffer);
-void setKeys(uint8_t input); // Must be called every time a key is pressed down. 'input' should be one of ENTER, LEFT or RIGHT
+void fillVideoBufferFormat(void* videoBuffer, enum LcdPixelFormat format, int stride); // fillVideoBuffer in any of the lcdDecode.h formats, rows 'stride' bytes apart (lcdFormatRowBytes(format, LCD_WIDTH) for a packed image)
+bool fillVideoBufferDirty(uint32_t* videoBuffer); // Same as fillVideoBuffer but only decodes what the ROM wrote since the last call. Returns false and leaves videoBuffer alone if the frame is the same as last time, so videoBuffer must keep the previous frame
+bool lcdChanged(); // The ROM wrote LCD data since the last fillVideoBuffer/fillVideoBufferDirty
+void setFrameCallback(void (*callback)()); // 'callback' runs on the emulation thread as soon as the ROM completes a frame (finishes a page sweep or switches the display start line). It can call fillVideoBuffer/fillVideoBufferDirty
+uint64_t getCycleCount(); // System clock cycles run since initWalker, never reset
+const uint32_t* getLcdPalette(); // The 4 colors of the palette indices fillVideoBuffer uses (0x00RRGGBB), lightest first
+uint16_t getPc(); // Address of the next instruction
+void getRegisters(uint32_t* registers); // Copies ER0-ER7 into 'registers'
+uint8_t getFlags(); // CCR as the CPU would push it
+void setKeys(uint8_t input); // Must be called every time a key is pressed down. 'input' should be one of ENTER, LEFT or RIGHT. Safe to call from a thread other than the one running the emulation
 void quarterRTCInterrupt();// Must be called once every quarter second
+bool loadHooks(const char* fileName); // Adds the hooks from a file with the same format as hooks.cfg, which initWalker loads from the working directory
+bool addBreakpoint(uint16_t address); // Calls onBreakpoint() every time the instrumented core reaches the ROM address
+bool addHle(uint16_t address, const char* routineName); // Same as an "hle" line in hooks.cfg: run the native routineName (see hle.c) instead of the ROM routine at address
+bool addMemo(uint16_t address); // Same as a "memo" line in hooks.cfg: cache the results of the pure ROM routine at address (see memo.c). Call after initWalker
+void setInstrumentation(bool enabled); // Switch runNextInstruction to the core with tracing, asserts and debug hooks compiled in. Off by default.
+void setTracing(bool enabled); // Instrumented core only: record every executed instruction in a binary trace ring, it gets dumped to trace.bin when an instruction fails
+void setPrintState(bool enabled); // Instrumented core only: print every instruction and memory access
+void setHleValidation(bool enabled); // Instrumented core only: run the ROM code behind every hle hook anyway and print how the native replacement's results and cycles differ
+void setProfiling(bool enabled); // Instrumented core only: sample pc every few thousand cycles
+bool dumpProfile(const char* fileName); // Writes the most sampled ROM addresses as text
@@ -3,14 +3,24 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "walker.h"
+#include "atomics.h"
+#include "tripleBuffer.h"
+#include "scaler.h"
 
 #define TICKS_PER_SEC 4 /* RTC/4 */
+#define SLICES_PER_TICK 16 // The emulation syncs with the wall clock every 1/64 s
+#define CYCLES_PER_SLICE (SYSTEM_CLOCK_CYCLES_PER_SECOND / TICKS_PER_SEC / SLICES_PER_TICK)
 static HCURSOR cursor;
 WINDOWPLACEMENT g_wpPrev = { sizeof(g_wpPrev) };
 
-static bool walkerRunning;
+#define WM_FRAME_READY (WM_APP + 0) // Posted by the emulation thread after publishing a frame
+
+static AtomicU32 walkerRunning; // Cleared by either thread to stop both
+static struct TripleBuffer frames;
+static HWND mainWindow;
 
 struct Vector2i {
     union {
@@ -40,7 +50,7 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
 			SetCursor(cursor);
 			} break;
 		case WM_CLOSE: {
-			walkerRunning = false;
+			atomicStore(&walkerRunning, false);
 			DestroyWindow(hwnd);
 		} break;
 		default: {
@@ -51,6 +61,64 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
 }
 
 
+static uint32_t screen[LCD_WIDTH * LCD_HEIGHT]; // Last frame, fillVideoBufferDirty only updates what changed
+
+// Frame callback, runs on the emulation thread as soon as the ROM finishes drawing. Also called every quarter second
+// for the parts of the screen the ROM updates without a full redraw. Nothing to convert or present while the screen is idle
+void presentFrame(){
+	if (fillVideoBufferDirty(screen)){
+		memcpy(getBackFrame(&frames), screen, sizeof(screen));
+		publishFrame(&frames);
+		PostMessage(mainWindow, WM_FRAME_READY, 0, 0);
+	}
+}
+
+// Runs the CPU in real time, in slices short enough that a frame shows up about when the ROM draws it. Talks to the
+// UI thread only through 'frames', the key queue behind setKeys and walkerRunning.
+DWORD WINAPI emulationThread(LPVOID parameter){
+	uint64_t cycleCount = 0;
+	uint32_t slices = 0;
+	// Timing
+	LARGE_INTEGER performanceFrequency;
+	QueryPerformanceFrequency(&performanceFrequency);
+
+	LARGE_INTEGER startPerformanceCount;
+	QueryPerformanceCounter(&startPerformanceCount);
+
+	while (atomicLoad(&walkerRunning)) {
+		bool error = runNextInstruction(&cycleCount);
+		if(error){
+			atomicStore(&walkerRunning, false);
+			PostMessage(mainWindow, WM_NULL, 0, 0); // Wake the UI thread up so it can quit
+		}
+		if (cycleCount >= CYCLES_PER_SLICE){
+			cycleCount -= CYCLES_PER_SLICE;
+			slices += 1;
+			if ((slices % SLICES_PER_TICK) == 0){
+				quarterRTCInterrupt();
+				presentFrame();
+			}
+
+			float desiredFrameTimeInS = 1.0f / (TICKS_PER_SEC * SLICES_PER_TICK);
+			LARGE_INTEGER endPerformanceCount;
+			QueryPerformanceCounter(&endPerformanceCount);
+			float elapsedSeconds = getEllapsedSeconds(endPerformanceCount, startPerformanceCount, performanceFrequency);
+#ifdef DISPLAY_FRAME_TIME
+			char str[20];
+			sprintf(str, "%f\n", elapsedSeconds);
+			OutputDebugStringA(str);
+#endif
+			if (elapsedSeconds < desiredFrameTimeInS) {
+				DWORD timeToSleep = (DWORD)(1000.0f * (desiredFrameTimeInS - elapsedSeconds));
+				Sleep(timeToSleep);
+				QueryPerformanceCounter(&endPerformanceCount);
+			}
+			startPerformanceCount = endPerformanceCount;
+		}
+	}
+	return 0;
+}
+
 // hInstance: handle to the .exe
 // hPrevInstance: not used since 16bit windows
 // WINAPI: calling convention, tells compiler order of parameters
@@ -59,6 +127,19 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine
 	struct Vector2i nativeRes = { LCD_WIDTH, LCD_HEIGHT };
 	int scalingFactor = 4;
 
+	// -filter NAME scales frames with the scaler before handing them to GDI, otherwise StretchDIBits does nearest scaling
+	enum ScaleFilter filter = SCALE_NEAREST;
+	bool filtering = false;
+	const char* filterOption = strstr(lpCmdLine, "-filter ");
+	if (filterOption){
+		char filterName[16] = {0};
+		sscanf(filterOption + strlen("-filter "), "%15s", filterName);
+		filtering = parseScaleFilter(filterName, &filter);
+		if (filtering && filter == SCALE_3X){
+			scalingFactor = 3;
+		}
+	}
+
 	//MMRESULT canQueryEveryMs = timeBeginPeriod(1);
 	//assert(canQueryEveryMs == TIMERR_NOERROR);
 
@@ -71,15 +152,13 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine
 	BITMAPINFOHEADER bmInfoHeader = {0};
 	bmInfoHeader.biSize = sizeof(bmInfoHeader);
 	bmInfoHeader.biCompression = BI_RGB;
-	bmInfoHeader.biWidth = nativeRes.width;
-	bmInfoHeader.biHeight = -nativeRes.height; // Negative means it'll be filled top-down
+	struct Vector2i bitmapRes = filtering ? screenRes : nativeRes;
+	bmInfoHeader.biWidth = bitmapRes.width;
+	bmInfoHeader.biHeight = -bitmapRes.height; // Negative means it'll be filled top-down
 	bmInfoHeader.biPlanes = 1;       // MSDN says it must be set to 1, legacy reasons
 	bmInfoHeader.biBitCount = 32;    // R+G+B+padding each 8bits
 	bitmapInfo.bmiHeader = bmInfoHeader;
 
-	void* bitMapMemory;
-	bitMapMemory = VirtualAlloc(0, nativeRes.width * nativeRes.height * 4 /*(4Bytes(32b) for color)*/, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
-
 	HRESULT init = CoInitializeEx(NULL, COINIT_APARTMENTTHREADED | COINIT_DISABLE_OLE1DDE);
 	assert(SUCCEEDED(init));
 	// Register the window class.
@@ -121,81 +200,74 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine
 		ShowWindow(hwnd, nShowCmd);
 		
 		initWalker();
-		walkerRunning = true;
-		uint64_t cycleCount = 0;
-		// Timing
-		LARGE_INTEGER performanceFrequency;
-		QueryPerformanceFrequency(&performanceFrequency);
-
-		LARGE_INTEGER startPerformanceCount;
-		QueryPerformanceCounter(&startPerformanceCount);
-
-		while (walkerRunning) {
-			uint8_t newInput = 0;
-			// Process Messages
-			MSG msg = {0};
-			while (PeekMessage(&msg, 0, 0, 0, PM_REMOVE))
-			{
-				WPARAM key = msg.wParam;
-				bool keyPressed = false;
-				switch (msg.message) {
-					case WM_KEYDOWN: {
-						bool wasDown = msg.lParam & (1 << 30);
-						if (!wasDown) {
-							if (key == VK_SPACE) {
-								newInput |= ENTER;
-								setKeys(newInput);
-							}
-							if (key == 'Z') {
-								newInput |= LEFT;
-								setKeys(newInput);
-							}
-							if (key == 'X') {
-								newInput |= RIGHT;
-								setKeys(newInput);
-							}
-						}
-					} break;
-					case WM_QUIT: {
-						walkerRunning = false;
-					} break;
-					default: {
-						TranslateMessage(&msg);
-						DispatchMessage(&msg);
-					} break;
-				}
-
-			}
-
-			bool error = runNextInstruction(&cycleCount);
-			if(error){
-				walkerRunning = false; 
-			}
-			if (cycleCount >= SYSTEM_CLOCK_CYCLES_PER_SECOND/TICKS_PER_SEC){
-				cycleCount -= SYSTEM_CLOCK_CYCLES_PER_SECOND/TICKS_PER_SEC;
-
-				quarterRTCInterrupt();
-
-				fillVideoBuffer(bitMapMemory);
-				StretchDIBits(windowDeviceContext, 0, 0, screenRes.width, screenRes.height, 0, 0, nativeRes.width, nativeRes.height, bitMapMemory, &bitmapInfo, DIB_RGB_COLORS, SRCCOPY);
+		if (strstr(lpCmdLine, "-trace")){
+			setInstrumentation(true);
+			setTracing(true);
+		}
+		if (strstr(lpCmdLine, "-print")){
+			setInstrumentation(true);
+			setPrintState(true);
+		}
+		if (strstr(lpCmdLine, "-validatehle")){
+			setInstrumentation(true);
+			setHleValidation(true);
+		}
+		bool profiling = strstr(lpCmdLine, "-profile");
+		if (profiling){
+			setInstrumentation(true);
+			setProfiling(true);
+		}
+		struct Scaler scaler;
+		uint32_t* scaledFrame = NULL;
+		if (filtering){
+			initScaler(&scaler, filter, scalingFactor, LCD_WIDTH, LCD_HEIGHT, getLcdPalette()[0]);
+			scaledFrame = malloc(screenRes.width * screenRes.height * sizeof(uint32_t));
+		}
+		initTripleBuffer(&frames);
+		mainWindow = hwnd;
+		setFrameCallback(presentFrame);
+		atomicStore(&walkerRunning, true);
+		HANDLE emulation = CreateThread(NULL, 0, emulationThread, NULL, 0, NULL);
 
-				float desiredFrameTimeInS = 1.0f / TICKS_PER_SEC;
-				LARGE_INTEGER endPerformanceCount;
-				QueryPerformanceCounter(&endPerformanceCount);
-				float elapsedSeconds = getEllapsedSeconds(endPerformanceCount, startPerformanceCount, performanceFrequency);
-#ifdef DISPLAY_FRAME_TIME
-				char str[20];
-				sprintf(str, "%f\n", elapsedSeconds);
-				OutputDebugStringA(str);
-#endif
-				if (elapsedSeconds < desiredFrameTimeInS) {
-					DWORD timeToSleep = (DWORD)(1000.0f * (desiredFrameTimeInS - elapsedSeconds));
-					Sleep(timeToSleep);
-					QueryPerformanceCounter(&endPerformanceCount);
-				}
-				startPerformanceCount = endPerformanceCount;
+		MSG msg = {0};
+		while (atomicLoad(&walkerRunning) && GetMessage(&msg, 0, 0, 0) > 0) {
+			WPARAM key = msg.wParam;
+			switch (msg.message) {
+				case WM_KEYDOWN: {
+					bool wasDown = msg.lParam & (1 << 30);
+					if (!wasDown) {
+						if (key == VK_SPACE) {
+							setKeys(ENTER);
+						}
+						if (key == 'Z') {
+							setKeys(LEFT);
+						}
+						if (key == 'X') {
+							setKeys(RIGHT);
+						}
+					}
+				} break;
+				case WM_FRAME_READY: {
+					uint32_t* frame = takeFrame(&frames);
+					if (frame) { // Several notifications can arrive for a single frame
+						if (filtering) {
+							scaleImage(&scaler, frame, LCD_WIDTH, scaledFrame, screenRes.width);
+							frame = scaledFrame;
+						}
+						StretchDIBits(windowDeviceContext, 0, 0, screenRes.width, screenRes.height, 0, 0, bitmapRes.width, bitmapRes.height, frame, &bitmapInfo, DIB_RGB_COLORS, SRCCOPY);
+					}
+				} break;
+				default: {
+					TranslateMessage(&msg);
+					DispatchMessage(&msg);
+				} break;
 			}
-
+		}
+		atomicStore(&walkerRunning, false);
+		WaitForSingleObject(emulation, INFINITE);
+		CloseHandle(emulation);
+		if (profiling){
+			dumpProfile("profile.txt");
 		}
 	}
 	return 0;
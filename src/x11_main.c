@@ -0,0 +1,372 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <sys/select.h>
+
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <X11/XKBlib.h>
+#include <X11/keysym.h>
+#include <X11/extensions/XShm.h>
+
+#include "walker.h"
+#include "atomics.h"
+#include "tripleBuffer.h"
+#include "scaler.h"
+
+// X11 frontend. Same split as win_main.c: the emulation thread runs the CPU in real time and publishes frames
+// through a triple buffer, the main thread handles X events and presents. The frame gets scaled straight into
+// an MIT-SHM image so the X server reads it without another copy through the socket.
+
+#define TICKS_PER_SEC 4 /* RTC/4 */
+#define SLICES_PER_TICK 16 // The emulation syncs with the wall clock every 1/64 s
+#define CYCLES_PER_SLICE (SYSTEM_CLOCK_CYCLES_PER_SECOND / TICKS_PER_SEC / SLICES_PER_TICK)
+
+static AtomicU32 walkerRunning; // Cleared by either thread to stop both
+static struct TripleBuffer frames;
+static int frameReadyPipe[2]; // The emulation thread writes a byte after publishing a frame
+
+struct Screen_t{
+	Display* display;
+	Window window;
+	GC gc;
+	XImage* image;
+	XShmSegmentInfo shmInfo;
+	bool shm;
+	int scale;
+	struct Scaler scaler;
+};
+
+static double getSeconds(){
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+static void sleepUntil(double deadline){
+	struct timespec wakeUp;
+	wakeUp.tv_sec = (time_t)deadline;
+	wakeUp.tv_nsec = (long)((deadline - (double)wakeUp.tv_sec) * 1e9);
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wakeUp, NULL) == EINTR);
+}
+
+static uint32_t screen[LCD_WIDTH * LCD_HEIGHT]; // Last frame, fillVideoBufferDirty only updates what changed
+
+// Frame callback, runs on the emulation thread as soon as the ROM finishes drawing. Also called every quarter second
+// for the parts of the screen the ROM updates without a full redraw. Nothing to convert or present while the screen is idle
+static void presentFrame(){
+	if (fillVideoBufferDirty(screen)){
+		memcpy(getBackFrame(&frames), screen, sizeof(screen));
+		publishFrame(&frames);
+		char notification = 0;
+		write(frameReadyPipe[1], &notification, 1); // Non blocking, a full pipe already means "frame ready"
+	}
+}
+
+// Syncs with the wall clock every slice, short enough that a frame shows up about when the ROM draws it
+static void* emulationThread(void* parameter){
+	(void)parameter; // The state is global
+	uint64_t cycleCount = 0;
+	uint64_t slices = 0;
+	double startTime = getSeconds();
+	while (atomicLoad(&walkerRunning)){
+		if (runNextInstruction(&cycleCount)){
+			atomicStore(&walkerRunning, false);
+		}
+		if (cycleCount >= CYCLES_PER_SLICE){
+			cycleCount -= CYCLES_PER_SLICE;
+			slices += 1;
+			if ((slices % SLICES_PER_TICK) == 0){
+				quarterRTCInterrupt();
+				presentFrame();
+			}
+
+			double now = getSeconds();
+			double deadline = startTime + (double)slices / (TICKS_PER_SEC * SLICES_PER_TICK);
+#ifdef DISPLAY_FRAME_TIME
+			printf("%f\n", now - (deadline - 1.0 / (TICKS_PER_SEC * SLICES_PER_TICK)));
+#endif
+			if (now < deadline){
+				sleepUntil(deadline);
+			}
+			else if (now - deadline > 1){
+				startTime += now - deadline; // Too far behind (suspended, debugger...), don't try to catch up
+			}
+		}
+	}
+	char notification = 0;
+	write(frameReadyPipe[1], &notification, 1); // Wake the main thread up so it notices
+	return NULL;
+}
+
+static bool shmAttachFailed;
+
+static int onShmAttachError(Display* display, XErrorEvent* event){
+	(void)display;
+	(void)event;
+	shmAttachFailed = true; // BadAccess from a server that can't see our segment
+	return 0;
+}
+
+// Falls back to a plain XImage when the server can't share memory with us (remote display)
+static bool createImage(struct Screen_t* screen, Visual* visual, int depth){
+	int width = LCD_WIDTH * screen->scale;
+	int height = LCD_HEIGHT * screen->scale;
+	screen->image = NULL;
+	screen->shm = XShmQueryExtension(screen->display);
+	if (screen->shm){
+		screen->image = XShmCreateImage(screen->display, visual, depth, ZPixmap, NULL, &screen->shmInfo, width, height);
+		screen->shm = screen->image != NULL;
+	}
+	if (screen->shm){
+		screen->shmInfo.shmid = shmget(IPC_PRIVATE, screen->image->bytes_per_line * height, IPC_CREAT | 0600);
+		screen->shm = screen->shmInfo.shmid >= 0;
+	}
+	if (screen->shm){
+		screen->shmInfo.shmaddr = shmat(screen->shmInfo.shmid, NULL, 0);
+		screen->shm = screen->shmInfo.shmaddr != (void*)-1;
+		if (screen->shm){
+			screen->image->data = screen->shmInfo.shmaddr;
+			screen->shmInfo.readOnly = False;
+			// The default handler would exit on the attach error, catch it instead
+			shmAttachFailed = false;
+			XSync(screen->display, False);
+			int (*previousHandler)(Display*, XErrorEvent*) = XSetErrorHandler(onShmAttachError);
+			screen->shm = XShmAttach(screen->display, &screen->shmInfo);
+			XSync(screen->display, False);
+			XSetErrorHandler(previousHandler);
+			screen->shm = screen->shm && !shmAttachFailed;
+			if (!screen->shm){
+				shmdt(screen->shmInfo.shmaddr);
+			}
+		}
+		shmctl(screen->shmInfo.shmid, IPC_RMID, NULL); // Goes away once both sides detach
+	}
+	if (screen->shm){
+		return true;
+	}
+	if (screen->image){
+		screen->image->data = NULL; // Never malloc'd, XDestroyImage mustn't free it
+		XDestroyImage(screen->image);
+	}
+	char* data = malloc(width * height * 4);
+	screen->image = XCreateImage(screen->display, visual, depth, ZPixmap, 0, data, width, height, 32, 0);
+	return screen->image != NULL;
+}
+
+static void scaleFrame(struct Screen_t* screen, const uint32_t* frame){
+	scaleImage(&screen->scaler, frame, LCD_WIDTH, (uint32_t*)screen->image->data, screen->image->bytes_per_line / 4);
+}
+
+static void present(struct Screen_t* screen){
+	int width = LCD_WIDTH * screen->scale;
+	int height = LCD_HEIGHT * screen->scale;
+	if (screen->shm){
+		XShmPutImage(screen->display, screen->window, screen->gc, screen->image, 0, 0, 0, 0, width, height, False);
+	}
+	else{
+		XPutImage(screen->display, screen->window, screen->gc, screen->image, 0, 0, 0, 0, width, height);
+	}
+	XSync(screen->display, False); // The server is done reading the image before the next frame gets scaled into it
+}
+
+static uint8_t keyForSym(KeySym sym){
+	switch (sym){
+		case XK_space: return ENTER;
+		case XK_z: return LEFT;
+		case XK_x: return RIGHT;
+	}
+	return 0;
+}
+
+int main(int argc, char** argv){
+	const char* romPath = "rom.bin";
+	const char* eepromPath = "eeprom.bin";
+	struct Screen_t screen = {0};
+	screen.scale = 0; // 4 unless -scale says otherwise, 3 for scale3x like the Windows frontend
+	enum ScaleFilter filter = SCALE_NEAREST;
+	bool tracing = false, printing = false, validatingHle = false, profiling = false;
+
+	for(int i = 1; i < argc; i++){
+		bool hasValue = i + 1 < argc;
+		if (strcmp(argv[i], "-rom") == 0 && hasValue){
+			romPath = argv[++i];
+		}
+		else if (strcmp(argv[i], "-eeprom") == 0 && hasValue){
+			eepromPath = argv[++i];
+			if (strcmp(eepromPath, "none") == 0){
+				eepromPath = NULL;
+			}
+		}
+		else if (strcmp(argv[i], "-scale") == 0 && hasValue){
+			screen.scale = atoi(argv[++i]);
+			if (screen.scale < 1){
+				screen.scale = 1;
+			}
+		}
+		else if (strcmp(argv[i], "-filter") == 0 && hasValue){
+			if (!parseScaleFilter(argv[++i], &filter)){
+				printf("Unknown filter %s, use nearest, scale2x, scale3x or lcd\n", argv[i]);
+				return 1;
+			}
+		}
+		else if (strcmp(argv[i], "-trace") == 0){
+			tracing = true;
+		}
+		else if (strcmp(argv[i], "-print") == 0){
+			printing = true;
+		}
+		else if (strcmp(argv[i], "-validatehle") == 0){
+			validatingHle = true;
+		}
+		else if (strcmp(argv[i], "-profile") == 0){
+			profiling = true;
+		}
+		else{
+			printf("Usage: %s [-rom PATH] [-eeprom PATH|none] [-scale N] [-filter nearest|scale2x|scale3x|lcd] [-trace] [-print] [-validatehle] [-profile]\n", argv[0]);
+			return 1;
+		}
+	}
+	if (screen.scale == 0){
+		screen.scale = filter == SCALE_3X ? 3 : 4;
+	}
+	if (!initWalkerFromFiles(romPath, eepromPath)){
+		return 1;
+	}
+	// The gaps show the LCD's background
+	if (!initScaler(&screen.scaler, filter, screen.scale, LCD_WIDTH, LCD_HEIGHT, getLcdPalette()[0])){
+		printf("-scale %d doesn't work with that filter, it has to be a multiple of %d\n", screen.scale, filter == SCALE_3X ? 3 : 2);
+		return 1;
+	}
+
+	screen.display = XOpenDisplay(NULL);
+	if (!screen.display){
+		printf("Can't open the X display\n");
+		return 1;
+	}
+	int screenNumber = DefaultScreen(screen.display);
+	XVisualInfo visualInfo;
+	if (!XMatchVisualInfo(screen.display, screenNumber, 24, TrueColor, &visualInfo) || visualInfo.red_mask != 0xFF0000 || visualInfo.blue_mask != 0xFF){
+		printf("Needs a 24 bit RGB display\n");
+		return 1;
+	}
+	int width = LCD_WIDTH * screen.scale;
+	int height = LCD_HEIGHT * screen.scale;
+	XSetWindowAttributes attributes = {0};
+	attributes.colormap = XCreateColormap(screen.display, RootWindow(screen.display, screenNumber), visualInfo.visual, AllocNone);
+	attributes.event_mask = ExposureMask | KeyPressMask | KeyReleaseMask;
+	screen.window = XCreateWindow(screen.display, RootWindow(screen.display, screenNumber), 0, 0, width, height, 0,
+		visualInfo.depth, InputOutput, visualInfo.visual, CWColormap | CWEventMask | CWBorderPixel, &attributes);
+	XStoreName(screen.display, screen.window, "PokeStroller");
+	XSizeHints sizeHints = {0}; // Not resizable, like the Windows frontend
+	sizeHints.flags = PMinSize | PMaxSize;
+	sizeHints.min_width = sizeHints.max_width = width;
+	sizeHints.min_height = sizeHints.max_height = height;
+	XSetWMNormalHints(screen.display, screen.window, &sizeHints);
+	Atom deleteWindow = XInternAtom(screen.display, "WM_DELETE_WINDOW", False);
+	XSetWMProtocols(screen.display, screen.window, &deleteWindow, 1);
+	XkbSetDetectableAutoRepeat(screen.display, True, NULL); // Held keys send presses only, no fake releases
+	screen.gc = XCreateGC(screen.display, screen.window, 0, NULL);
+	if (!createImage(&screen, visualInfo.visual, visualInfo.depth)){
+		printf("Can't create the image\n");
+		return 1;
+	}
+	memset(screen.image->data, 0, screen.image->bytes_per_line * height);
+	XMapWindow(screen.display, screen.window);
+
+	if (tracing){
+		setInstrumentation(true);
+		setTracing(true);
+	}
+	if (printing){
+		setInstrumentation(true);
+		setPrintState(true);
+	}
+	if (validatingHle){
+		setInstrumentation(true);
+		setHleValidation(true);
+	}
+	if (profiling){
+		setInstrumentation(true);
+		setProfiling(true);
+	}
+	initTripleBuffer(&frames);
+	setFrameCallback(presentFrame);
+	if (pipe(frameReadyPipe) != 0){
+		printf("Can't create a pipe\n");
+		return 1;
+	}
+	fcntl(frameReadyPipe[0], F_SETFL, O_NONBLOCK);
+	fcntl(frameReadyPipe[1], F_SETFL, O_NONBLOCK);
+	atomicStore(&walkerRunning, true);
+	pthread_t emulation;
+	pthread_create(&emulation, NULL, emulationThread, NULL);
+
+	uint8_t keysDown = 0;
+	int connection = ConnectionNumber(screen.display);
+	while (atomicLoad(&walkerRunning)){
+		while (XPending(screen.display)){
+			XEvent event;
+			XNextEvent(screen.display, &event);
+			switch (event.type){
+				case KeyPress:{
+					uint8_t key = keyForSym(XLookupKeysym(&event.xkey, 0));
+					if (key && !(keysDown & key)){
+						setKeys(key);
+					}
+					keysDown |= key;
+				} break;
+				case KeyRelease:{
+					keysDown &= ~keyForSym(XLookupKeysym(&event.xkey, 0));
+				} break;
+				case Expose:{
+					present(&screen);
+				} break;
+				case ClientMessage:{
+					if ((Atom)event.xclient.data.l[0] == deleteWindow){
+						atomicStore(&walkerRunning, false);
+					}
+				} break;
+			}
+		}
+		// Sleep until there's an X event or a new frame
+		fd_set readable;
+		FD_ZERO(&readable);
+		FD_SET(connection, &readable);
+		FD_SET(frameReadyPipe[0], &readable);
+		int highest = connection > frameReadyPipe[0] ? connection : frameReadyPipe[0];
+		if (select(highest + 1, &readable, NULL, NULL, NULL) < 0 && errno != EINTR){
+			break;
+		}
+		if (FD_ISSET(frameReadyPipe[0], &readable)){
+			char notifications[16];
+			while (read(frameReadyPipe[0], notifications, sizeof(notifications)) > 0);
+			uint32_t* frame = takeFrame(&frames);
+			if (frame){
+				scaleFrame(&screen, frame);
+				present(&screen);
+			}
+		}
+	}
+	atomicStore(&walkerRunning, false);
+	pthread_join(emulation, NULL);
+	if (profiling){
+		dumpProfile("profile.txt");
+	}
+
+	if (screen.shm){
+		XShmDetach(screen.display, &screen.shmInfo);
+		shmdt(screen.shmInfo.shmaddr);
+	}
+	XCloseDisplay(screen.display);
+	return 0;
+}